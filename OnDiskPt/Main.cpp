@@ -46,6 +46,8 @@ int main (int argc, char * const argv[])
 
   if (argc != 8) {
     std::cerr << "Usage: " << argv[0] << " numSourceFactors numTargetFactors numScores tableLimit sortScoreIndex inputPath outputPath" << std::endl;
+    std::cerr << "sortScoreIndex may instead be comma separated weights, one per score, to sort by the weighted log score." << std::endl;
+    std::cerr << "The decoder then reads only table-limit rules when its weights are a multiple of these." << std::endl;
     return 1;
   }
 
@@ -53,8 +55,15 @@ int main (int argc, char * const argv[])
                           , numTargetFactors	= Moses::Scan<int>(argv[2])
                               , numScores				= Moses::Scan<int>(argv[3])
                                   , tableLimit				= Moses::Scan<int>(argv[4]);
-  TargetPhraseCollection::s_sortScoreInd			= Moses::Scan<int>(argv[5]);
-  assert(TargetPhraseCollection::s_sortScoreInd < numScores);
+  const string sortBy = argv[5];
+  if (sortBy.find(',') == string::npos) {
+    TargetPhraseCollection::s_sortScoreInd = Moses::Scan<int>(sortBy);
+    assert(TargetPhraseCollection::s_sortScoreInd < numScores);
+  } else {
+    TargetPhraseCollection::s_sortWeights = Moses::Tokenize<float>(sortBy, ",");
+    UTIL_THROW_IF2(TargetPhraseCollection::s_sortWeights.size() != (size_t) numScores,
+                   "Got " << TargetPhraseCollection::s_sortWeights.size() << " sort weights for " << numScores << " scores");
+  }
 
   const string filePath 	= argv[6]
                             ,destPath	= argv[7];
@@ -63,6 +72,7 @@ int main (int argc, char * const argv[])
 
   OnDiskWrapper onDiskWrapper;
   onDiskWrapper.BeginSave(destPath, numSourceFactors, numTargetFactors, numScores);
+  onDiskWrapper.SetSortWeights(TargetPhraseCollection::s_sortWeights);
 
   PhraseNode &rootNode = onDiskWrapper.GetRootSourceNode();
   size_t lineNum = 0;
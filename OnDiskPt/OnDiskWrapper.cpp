@@ -25,6 +25,7 @@
 #include "OnDiskWrapper.h"
 #include "moses/Factor.h"
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/string_stream.hh"
 
 using namespace std;
@@ -56,22 +57,20 @@ void OnDiskWrapper::BeginLoad(const std::string &filePath)
   m_rootSourceNode = new PhraseNode(rootFilePos, *this);
 }
 
-bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
+void OnDiskWrapper::MapForLoad(const std::string &fileName, util::scoped_memory &to)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileSource.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/Source.dat");
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetInd.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetInd.dat");
+  util::scoped_fd file(util::OpenReadOrThrow(fileName.c_str()));
+  uint64_t size = util::SizeOrThrow(file.get());
+  // Every data file starts with a reserved byte, so it can't be empty.
+  UTIL_THROW_IF(!size, util::FileOpenException, "File " << fileName << " is empty");
+  util::MapRead(util::LAZY, file.get(), 0, size, to);
+}
 
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  UTIL_THROW_IF(!m_fileTargetColl.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/TargetColl.dat");
+bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
+{
+  MapForLoad(filePath + "/Source.dat", m_memSource);
+  MapForLoad(filePath + "/TargetInd.dat", m_memTargetInd);
+  MapForLoad(filePath + "/TargetColl.dat", m_memTargetColl);
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   UTIL_THROW_IF(!m_fileVocab.is_open(),
@@ -99,6 +98,12 @@ bool OnDiskWrapper::LoadMisc()
   while(m_fileMisc.getline(line, 100000)) {
     vector<string> tokens;
     Moses::Tokenize(tokens, line);
+    if (!tokens.empty() && tokens[0] == "SortWeights") {
+      for (size_t i = 1; i < tokens.size(); ++i) {
+        m_sortWeights.push_back(Moses::Scan<float>(tokens[i]));
+      }
+      continue;
+    }
     UTIL_THROW_IF2(tokens.size() != 2, "Except key value. Found " << line);
 
 
@@ -196,6 +201,13 @@ void OnDiskWrapper::SaveMisc()
   m_fileMisc << "NumTargetFactors " << m_numTargetFactors << endl;
   m_fileMisc << "NumScores " << m_numScores << endl;
   m_fileMisc << "RootNodeOffset " << m_rootSourceNode->GetFilePos() << endl;
+  if (!m_sortWeights.empty()) {
+    m_fileMisc << "SortWeights";
+    for (size_t i = 0; i < m_sortWeights.size(); ++i) {
+      m_fileMisc << " " << m_sortWeights[i];
+    }
+    m_fileMisc << endl;
+  }
 }
 
 size_t OnDiskWrapper::GetSourceWordSize() const
@@ -18,11 +18,13 @@
  License along with this library; if not, write to the Free Software
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***********************************************************************/
+#include <cassert>
 #include <string>
 #include <fstream>
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "moses/Word.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -38,14 +40,23 @@ protected:
   Vocab m_vocab;
   std::string m_filePath;
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
-  std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
+  std::fstream m_fileMisc, m_fileVocab, m_fileTarget;
+  // Only open between BeginSave() and EndSave().
+  std::fstream m_fileSource, m_fileTargetInd, m_fileTargetColl;
+
+  // When loading, the data files are mapped read-only instead of opened as
+  // streams, so nodes and target phrases are read without seeking and any
+  // number of threads can read at once.
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
 
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
 
   std::map<std::string, uint64_t> m_miscInfo;
+  std::vector<float> m_sortWeights;
 
   void SaveMisc();
+  void MapForLoad(const std::string &fileName, util::scoped_memory &to);
   bool OpenForLoad(const std::string &filePath);
   bool LoadMisc();
 
@@ -71,19 +82,35 @@ public:
   size_t GetSourceWordSize() const;
   size_t GetTargetWordSize() const;
 
+  // Data files being written, for saving only.  A loaded table reads them
+  // through the Get*Memory() functions below.
   std::fstream &GetFileSource() {
+    assert(m_fileSource.is_open());
     return m_fileSource;
   }
   std::fstream &GetFileTargetInd() {
+    assert(m_fileTargetInd.is_open());
     return m_fileTargetInd;
   }
   std::fstream &GetFileTargetColl() {
+    assert(m_fileTargetColl.is_open());
     return m_fileTargetColl;
   }
   std::fstream &GetFileVocab() {
     return m_fileVocab;
   }
 
+  // Loaded data at a file position.  Safe to call from several threads.
+  const char *GetSourceMemory(uint64_t filePos) const {
+    return static_cast<const char*>(m_memSource.get()) + filePos;
+  }
+  const char *GetTargetIndMemory(uint64_t filePos) const {
+    return static_cast<const char*>(m_memTargetInd.get()) + filePos;
+  }
+  const char *GetTargetCollMemory(uint64_t filePos) const {
+    return static_cast<const char*>(m_memTargetColl.get()) + filePos;
+  }
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
@@ -107,6 +134,15 @@ public:
 
   uint64_t GetMisc(const std::string &key) const;
 
+  // Weights the target phrase collections were sorted by, if not by a
+  // single score.  Saved in Misc.dat.
+  const std::vector<float> &GetSortWeights() const {
+    return m_sortWeights;
+  }
+  void SetSortWeights(const std::vector<float> &weights) {
+    m_sortWeights = weights;
+  }
+
   Word *ConvertFromMoses(const std::vector<Moses::FactorType> &factorsVec
                          , const Moses::Word &origWord) const;
 
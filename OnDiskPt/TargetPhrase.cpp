@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "moses/Util.h"
 #include "moses/TargetPhrase.h"
@@ -319,44 +320,37 @@ Moses::TargetPhrase *TargetPhrase::ConvertToMoses(const std::vector<Moses::Facto
   return ret;
 }
 
-uint64_t TargetPhrase::ReadOtherInfoFromFile(uint64_t filePos, std::fstream &fileTPColl)
+uint64_t TargetPhrase::ReadOtherInfoFromMemory(const char *mem)
 {
-  assert(filePos == (uint64_t)fileTPColl.tellg());
-
   uint64_t memUsed = 0;
-  fileTPColl.read((char*) &m_filePos, sizeof(uint64_t));
+  m_filePos = ((const uint64_t*) mem)[0];
   memUsed += sizeof(uint64_t);
   assert(m_filePos != 0);
 
-  memUsed += ReadAlignFromFile(fileTPColl);
-  assert((memUsed + filePos) == (uint64_t)fileTPColl.tellg());
+  memUsed += ReadAlignFromMemory(mem + memUsed);
 
-  memUsed += ReadScoresFromFile(fileTPColl);
-  assert((memUsed + filePos) == (uint64_t)fileTPColl.tellg());
+  memUsed += ReadScoresFromMemory(mem + memUsed);
 
   // sparse features
-  memUsed += ReadStringFromFile(fileTPColl, m_sparseFeatures);
+  memUsed += ReadStringFromMemory(mem + memUsed, m_sparseFeatures);
 
   // properties
-  memUsed += ReadStringFromFile(fileTPColl, m_property);
+  memUsed += ReadStringFromMemory(mem + memUsed, m_property);
 
   return memUsed;
 }
 
-uint64_t TargetPhrase::ReadStringFromFile(std::fstream &fileTPColl, std::string &outStr)
+uint64_t TargetPhrase::ReadStringFromMemory(const char *mem, std::string &outStr)
 {
   uint64_t bytesRead = 0;
 
-  uint64_t strSize;
-  fileTPColl.read((char*) &strSize, sizeof(uint64_t));
+  uint64_t strSize = ((const uint64_t*) mem)[0];
   bytesRead += sizeof(uint64_t);
 
   if (strSize) {
-    char *mem = (char*) malloc(strSize + 1);
-    mem[strSize] = '\0';
-    fileTPColl.read(mem, strSize);
-    outStr = string(mem);
-    free(mem);
+    // Stop at a null, as constructing from a C string would.
+    const char *str = mem + bytesRead;
+    outStr.assign(str, std::find(str, str + strSize, '\0'));
 
     bytesRead += strSize;
   }
@@ -364,31 +358,27 @@ uint64_t TargetPhrase::ReadStringFromFile(std::fstream &fileTPColl, std::string
   return bytesRead;
 }
 
-uint64_t TargetPhrase::ReadFromFile(std::fstream &fileTP)
+uint64_t TargetPhrase::ReadFromMemory(const char *mem)
 {
   uint64_t bytesRead = 0;
 
-  fileTP.seekg(m_filePos);
-
-  uint64_t numWords;
-  fileTP.read((char*) &numWords, sizeof(uint64_t));
+  uint64_t numWords = ((const uint64_t*) mem)[0];
   bytesRead += sizeof(uint64_t);
 
   for (size_t ind = 0; ind < numWords; ++ind) {
     WordPtr word(new Word());
-    bytesRead += word->ReadFromFile(fileTP);
+    bytesRead += word->ReadFromMemory(mem + bytesRead);
     AddWord(word);
   }
 
   // read source words
-  uint64_t numSourceWords;
-  fileTP.read((char*) &numSourceWords, sizeof(uint64_t));
+  uint64_t numSourceWords = ((const uint64_t*) (mem + bytesRead))[0];
   bytesRead += sizeof(uint64_t);
 
   PhrasePtr sp(new SourcePhrase());
   for (size_t ind = 0; ind < numSourceWords; ++ind) {
     WordPtr word( new Word());
-    bytesRead += word->ReadFromFile(fileTP);
+    bytesRead += word->ReadFromMemory(mem + bytesRead);
     sp->AddWord(word);
   }
   SetSourcePhrase(sp);
@@ -396,37 +386,29 @@ uint64_t TargetPhrase::ReadFromFile(std::fstream &fileTP)
   return bytesRead;
 }
 
-uint64_t TargetPhrase::ReadAlignFromFile(std::fstream &fileTPColl)
+uint64_t TargetPhrase::ReadAlignFromMemory(const char *mem)
 {
   uint64_t bytesRead = 0;
 
-  uint64_t numAlign;
-  fileTPColl.read((char*) &numAlign, sizeof(uint64_t));
+  uint64_t numAlign = ((const uint64_t*) mem)[0];
   bytesRead += sizeof(uint64_t);
 
+  const uint64_t *pairs = (const uint64_t*) (mem + bytesRead);
+  m_align.reserve(m_align.size() + numAlign);
   for (size_t ind = 0; ind < numAlign; ++ind) {
-    AlignPair alignPair;
-    fileTPColl.read((char*) &alignPair.first, sizeof(uint64_t));
-    fileTPColl.read((char*) &alignPair.second, sizeof(uint64_t));
-    m_align.push_back(alignPair);
-
-    bytesRead += sizeof(uint64_t) * 2;
+    m_align.push_back(AlignPair(pairs[ind * 2], pairs[ind * 2 + 1]));
   }
+  bytesRead += sizeof(uint64_t) * 2 * numAlign;
 
   return bytesRead;
 }
 
-uint64_t TargetPhrase::ReadScoresFromFile(std::fstream &fileTPColl)
+uint64_t TargetPhrase::ReadScoresFromMemory(const char *mem)
 {
   UTIL_THROW_IF2(m_scores.size() == 0, "Translation rules must must have some scores");
 
-  uint64_t bytesRead = 0;
-
-  for (size_t ind = 0; ind < m_scores.size(); ++ind) {
-    fileTPColl.read((char*) &m_scores[ind], sizeof(float));
-
-    bytesRead += sizeof(float);
-  }
+  uint64_t bytesRead = sizeof(float) * m_scores.size();
+  memcpy(&m_scores[0], mem, bytesRead);
 
   std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::TransformScore);
   std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::FloorScore);
@@ -32,7 +32,17 @@ using namespace std;
 namespace OnDiskPt
 {
 
+namespace
+{
+struct BetterSortScore {
+  bool operator()(const std::pair<float, TargetPhrase*> &a, const std::pair<float, TargetPhrase*> &b) const {
+    return a.first > b.first;
+  }
+};
+}
+
 size_t TargetPhraseCollection::s_sortScoreInd;
+std::vector<float> TargetPhraseCollection::s_sortWeights;
 
 TargetPhraseCollection::TargetPhraseCollection()
   :m_filePos(777)
@@ -56,7 +66,20 @@ void TargetPhraseCollection::AddTargetPhrase(TargetPhrase *targetPhrase)
 
 void TargetPhraseCollection::Sort(size_t tableLimit)
 {
-  std::sort(m_coll.begin(), m_coll.end(), TargetPhraseOrderByScore());
+  if (s_sortWeights.empty()) {
+    std::sort(m_coll.begin(), m_coll.end(), TargetPhraseOrderByScore());
+  } else {
+    // score each phrase once rather than in every comparison
+    std::vector<std::pair<float, TargetPhrase*> > scored(m_coll.size());
+    for (size_t i = 0; i < m_coll.size(); ++i) {
+      scored[i].first = Moses::CalcSortScore(&m_coll[i]->GetScores()[0], s_sortWeights);
+      scored[i].second = m_coll[i];
+    }
+    std::stable_sort(scored.begin(), scored.end(), BetterSortScore());
+    for (size_t i = 0; i < m_coll.size(); ++i) {
+      m_coll[i] = scored[i].second;
+    }
+  }
 
   if (tableLimit && m_coll.size() > tableLimit) {
     CollType::iterator iter;
@@ -147,34 +170,25 @@ Moses::TargetPhraseCollection::shared_ptr TargetPhraseCollection::ConvertToMoses
 
 }
 
-void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper)
+void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, const OnDiskWrapper &onDiskWrapper)
 {
-  fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
-  fstream &fileTP = onDiskWrapper.GetFileTargetInd();
-
   size_t numScores = onDiskWrapper.GetNumScores();
 
-
-  uint64_t numPhrases;
-
-  uint64_t currFilePos = filePos;
-  fileTPColl.seekg(filePos);
-  fileTPColl.read((char*) &numPhrases, sizeof(uint64_t));
+  const char *mem = onDiskWrapper.GetTargetCollMemory(filePos);
+  uint64_t numPhrases = ((const uint64_t*) mem)[0];
 
   // table limit
   if (tableLimit) {
     numPhrases = std::min(numPhrases, (uint64_t) tableLimit);
   }
 
-  currFilePos += sizeof(uint64_t);
+  mem += sizeof(uint64_t);
 
   for (size_t ind = 0; ind < numPhrases; ++ind) {
     TargetPhrase *tp = new TargetPhrase(numScores);
 
-    uint64_t sizeOtherInfo = tp->ReadOtherInfoFromFile(currFilePos, fileTPColl);
-    tp->ReadFromFile(fileTP);
-
-    currFilePos += sizeOtherInfo;
+    mem += tp->ReadOtherInfoFromMemory(mem);
+    tp->ReadFromMemory(onDiskWrapper.GetTargetIndMemory(tp->GetFilePos()));
 
     m_coll.push_back(tp);
   }
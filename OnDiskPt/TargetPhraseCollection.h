@@ -56,6 +56,9 @@ public:
   typedef boost::shared_ptr<TargetPhraseCollection> shared_ptr;
 
   static size_t s_sortScoreInd;
+  // if not empty, Sort() orders by Moses::CalcSortScore() under these
+  // weights instead of by the score at s_sortScoreInd
+  static std::vector<float> s_sortWeights;
 
   TargetPhraseCollection();
   TargetPhraseCollection(const TargetPhraseCollection &copy);
@@ -80,7 +83,7 @@ public:
       , const std::vector<float> &weightT
       , Vocab &vocab
       , bool isSyntax) const;
-  void ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper);
+  void ReadFromFile(size_t tableLimit, uint64_t filePos, const OnDiskWrapper &onDiskWrapper);
 
   const std::string GetDebugStr() const;
   void SetDebugStr(const std::string &str);
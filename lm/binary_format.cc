@@ -15,7 +15,7 @@
 namespace lm {
 namespace ngram {
 
-const char *kModelNames[6] = {"probing hash tables", "probing hash tables with rest costs", "trie", "trie with quantization", "trie with array-compressed pointers", "trie with quantization and array-compressed pointers"};
+const char *kModelNames[7] = {"probing hash tables", "probing hash tables with rest costs", "trie", "trie with quantization", "trie with array-compressed pointers", "trie with quantization and array-compressed pointers", "probing hash tables with quantization"};
 
 namespace {
 const char kMagicBeforeVersion[] = "mmap lm http://kheafield.com/code format version";
@@ -136,7 +136,7 @@ void MatchCheck(ModelType model_type, unsigned int search_version, const Paramet
 const std::size_t kInvalidSize = static_cast<std::size_t>(-1);
 
 BinaryFormat::BinaryFormat(const Config &config)
-  : write_method_(config.write_method), write_mmap_(config.write_mmap), load_method_(config.load_method),
+  : write_method_(config.write_method), write_mmap_(config.write_mmap), load_method_(config.load_method), numa_node_(config.numa_node),
     header_size_(kInvalidSize), vocab_size_(kInvalidSize), vocab_string_offset_(kInvalidOffset) {}
 
 void BinaryFormat::InitializeBinary(int fd, ModelType model_type, unsigned int search_version, Parameters &params) {
@@ -159,7 +159,7 @@ void *BinaryFormat::LoadBinary(std::size_t size) {
   uint64_t total_map = static_cast<uint64_t>(header_size_) + static_cast<uint64_t>(size);
   UTIL_THROW_IF(file_size != util::kBadSize && file_size < total_map, FormatLoadException, "Binary file has size " << file_size << " but the headers say it should be at least " << total_map);
 
-  util::MapRead(load_method_, file_.get(), 0, util::CheckOverflow(total_map), mapping_);
+  util::MapRead(load_method_, file_.get(), 0, util::CheckOverflow(total_map), mapping_, numa_node_);
 
   vocab_string_offset_ = total_map;
   return reinterpret_cast<uint8_t*>(mapping_.get()) + header_size_;
@@ -264,6 +264,7 @@ void BinaryFormat::FinishFile(const Config &config, ModelType model_type, unsign
   params.fixed.probing_multiplier = config.probing_multiplier;
   params.fixed.model_type = model_type;
   params.fixed.has_vocabulary = config.include_vocab;
+  params.fixed.bloom_bits = config.bloom_bits;
   params.fixed.search_version = search_version;
   switch (write_method_) {
     case Config::WRITE_MMAP:
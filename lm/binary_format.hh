@@ -17,7 +17,7 @@
 namespace lm {
 namespace ngram {
 
-extern const char *kModelNames[6];
+extern const char *kModelNames[7];
 
 /*Inspect a file to determine if it is a binary lm.  If not, return false.
  * If so, return true and set recognized to the type.  This is the only API in
@@ -32,6 +32,9 @@ struct FixedWidthParameters {
   ModelType model_type;
   // Does the end of the file have the actual strings in the vocabulary?
   bool has_vocabulary;
+  // Bits per n-gram of the probing Bloom filters.  This was padding, which
+  // was always zeroed, so older files have no filters.
+  uint8_t bloom_bits;
   unsigned int search_version;
 };
 
@@ -78,6 +81,7 @@ class BinaryFormat {
     const Config::WriteMethod write_method_;
     const char *write_mmap_;
     util::LoadMethod load_method_;
+    std::size_t numa_node_;
 
     // File behind memory, if any.
     util::scoped_fd file_;
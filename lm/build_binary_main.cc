@@ -23,7 +23,7 @@ namespace ngram {
 namespace {
 
 void Usage(const char *name, const char *default_mem) {
-  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-w mmap|after] [-p probing_multiplier] [-T trie_temporary] [-S trie_building_mem] [-q bits] [-b bits] [-a bits] [type] input.arpa [output.mmap]\n\n"
+  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-w mmap|after] [-p probing_multiplier] [-B bloom_bits] [-T trie_temporary] [-S trie_building_mem] [-j threads] [-q bits] [-b bits] [-a bits] [type] input.arpa [output.mmap]\n\n"
 "-u sets the log10 probability for <unk> if the ARPA file does not have one.\n"
 "   Default is -100.  The ARPA file will always take precedence.\n"
 "-s allows models to be built even if they do not have <s> and </s>.\n"
@@ -37,7 +37,13 @@ void Usage(const char *name, const char *default_mem) {
 "   vocabulary.  For probing, the unigrams must be in the same order.\n\n"
 "type is either probing or trie.  Default is probing.\n\n"
 "probing uses a probing hash table.  It is the fastest but uses the most memory.\n"
-"-p sets the space multiplier and must be >1.0.  The default is 1.5.\n\n"
+"-p sets the space multiplier and must be >1.0.  The default is 1.5.\n"
+"   With -q, weights are quantized and packed with a shortened hash into 8 bytes\n"
+"   per entry.  -q and -b may add up to at most 31 bits.\n"
+"-B puts a Bloom filter with this many bits per n-gram in front of each table\n"
+"   above unigrams so that most lookups of absent n-grams skip the table.  This\n"
+"   pays off when queries are mostly unseen n-grams but costs time otherwise.\n"
+"   Not available with -q.  Default is 0 (no filter).\n\n"
 "trie is a straightforward trie with bit-level packing.  It uses the least\n"
 "memory and is still faster than SRI or IRST.  Building the trie format uses an\n"
 "on-disk sort to save memory.\n"
@@ -46,6 +52,8 @@ void Usage(const char *name, const char *default_mem) {
 "   with GNU sort.  The number is followed by a unit: \% for percent of physical\n"
 "   memory, b for bytes, K for Kilobytes, M for megabytes, then G,T,P,E,Z,Y.  \n"
 "   Default unit is K for Kilobytes.\n"
+"-j sets the number of threads that parse and sort n-grams.  Default is 1.\n"
+"   Parsing is only split for uncompressed ARPA files.\n"
 "-q turns quantization on and sets the number of bits (e.g. -q 8).\n"
 "-b sets backoff quantization bits.  Requires -q and defaults to that value.\n"
 "-a compresses pointers using an array of offsets.  The parameter is the\n"
@@ -91,7 +99,7 @@ void ParseFileList(const char *from, std::vector<std::string> &to) {
 }
 
 void ProbingQuantizationUnsupported() {
-  std::cerr << "Quantization is only implemented in the trie data structure." << std::endl;
+  std::cerr << "Quantization is not implemented for probing with rest costs." << std::endl;
   exit(1);
 }
 
@@ -108,11 +116,11 @@ int main(int argc, char *argv[]) {
     Usage(argv[0], default_mem);
 
   try {
-    bool quantize = false, set_backoff_bits = false, bhiksha = false, set_write_method = false, rest = false;
+    bool quantize = false, set_backoff_bits = false, bhiksha = false, set_write_method = false, rest = false, bloom = false;
     lm::ngram::Config config;
     config.building_memory = util::ParseSize(default_mem);
     int opt;
-    while ((opt = getopt(argc, argv, "q:b:a:u:p:t:T:m:S:w:sir:h")) != -1) {
+    while ((opt = getopt(argc, argv, "q:b:a:u:p:B:t:T:m:S:j:w:sir:h")) != -1) {
       switch(opt) {
         case 'q':
           config.prob_bits = ParseBitCount(optarg);
@@ -133,6 +141,10 @@ int main(int argc, char *argv[]) {
         case 'p':
           config.probing_multiplier = ParseFloat(optarg);
           break;
+        case 'B':
+          config.bloom_bits = ParseBitCount(optarg);
+          bloom = config.bloom_bits != 0;
+          break;
         case 't': // legacy
         case 'T':
           config.temporary_directory_prefix = optarg;
@@ -144,6 +156,9 @@ int main(int argc, char *argv[]) {
         case 'S':
           config.building_memory = std::min(static_cast<uint64_t>(std::numeric_limits<std::size_t>::max()), util::ParseSize(optarg));
           break;
+        case 'j':
+          config.building_threads = ParseUInt(optarg);
+          break;
         case 'w':
           set_write_method = true;
           if (!strcmp(optarg, "mmap")) {
@@ -170,6 +185,7 @@ int main(int argc, char *argv[]) {
           Usage(argv[0], default_mem);
       }
     }
+    // -b only means something to the quantized types, QUANT_PROBING and QUANT_TRIE.
     if (!quantize && set_backoff_bits) {
       std::cerr << "You specified backoff quantization (-b) but not probability quantization (-q)" << std::endl;
       abort();
@@ -195,9 +211,15 @@ int main(int argc, char *argv[]) {
     }
     if (!strcmp(model_type, "probing")) {
       if (!set_write_method) config.write_method = Config::WRITE_AFTER;
-      if (quantize || set_backoff_bits) ProbingQuantizationUnsupported();
       if (rest) {
+        if (quantize || set_backoff_bits) ProbingQuantizationUnsupported();
         RestProbingModel(from_file, config);
+      } else if (quantize) {
+        if (bloom) {
+          std::cerr << "Bloom filters (-B) are not implemented for quantized probing." << std::endl;
+          return 1;
+        }
+        QuantProbingModel(from_file, config);
       } else {
         ProbingModel(from_file, config);
       }
@@ -206,6 +228,10 @@ int main(int argc, char *argv[]) {
         std::cerr << "Rest + trie is not supported yet." << std::endl;
         return 1;
       }
+      if (bloom) {
+        std::cerr << "Bloom filters (-B) are only for probing." << std::endl;
+        return 1;
+      }
       if (!set_write_method) config.write_method = Config::WRITE_MMAP;
       if (quantize) {
         if (bhiksha) {
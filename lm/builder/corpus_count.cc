@@ -151,6 +151,31 @@ class Writer {
 
 } // namespace
 
+void LimitVocab(const std::string &prune_vocab_filename, const ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab, std::vector<bool> &prune_words) {
+  bool delimiters[256];
+  util::BoolCharacter::Build("\0\t\n\r ", delimiters);
+  try {
+    util::FilePiece prune_vocab_file(prune_vocab_filename.c_str());
+
+    prune_words.resize(vocab.Size(), true);
+    try {
+      while (true) {
+        StringPiece word(prune_vocab_file.ReadDelimited(delimiters));
+        prune_words[vocab.Index(word)] = false;
+      }
+    } catch (const util::EndOfFileException &e) {}
+
+    // Never prune <unk>, <s>, </s>
+    prune_words[kUNK] = false;
+    prune_words[kBOS] = false;
+    prune_words[kEOS] = false;
+
+  } catch (const util::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    abort();
+  }
+}
+
 float CorpusCount::DedupeMultiplier(std::size_t order) {
   return kProbingMultiplier * static_cast<float>(sizeof(DedupeEntry)) / static_cast<float>(NGram<BuildingPayload>::TotalSize(order));
 }
@@ -212,26 +237,7 @@ void CorpusCount::Run(const util::stream::ChainPosition &position) {
 
   // Create list of unigrams that are supposed to be pruned
   if (!prune_vocab_filename_.empty()) {
-    try {
-      util::FilePiece prune_vocab_file(prune_vocab_filename_.c_str());
-
-      prune_words_.resize(vocab.Size(), true);
-      try {
-        while (true) {
-          StringPiece word(prune_vocab_file.ReadDelimited(delimiters));
-          prune_words_[vocab.Index(word)] = false;
-        }
-      } catch (const util::EndOfFileException &e) {}
-
-      // Never prune <unk>, <s>, </s>
-      prune_words_[kUNK] = false;
-      prune_words_[kBOS] = false;
-      prune_words_[kEOS] = false;
-
-    } catch (const util::Exception &e) {
-      std::cerr << e.what() << std::endl;
-      abort();
-    }
+    LimitVocab(prune_vocab_filename_, vocab, prune_words_);
   }
 }
 
@@ -18,8 +18,17 @@ class ChainPosition;
 } // namespace util
 
 namespace lm {
+namespace ngram {
+template <class NewWordAction> class GrowableVocab;
+class WriteUniqueWords;
+} // namespace ngram
+
 namespace builder {
 
+// Mark the words of vocab that are not in the whitespace-separated file
+// prune_vocab_filename for pruning.  <unk>, <s>, and </s> are always kept.
+void LimitVocab(const std::string &prune_vocab_filename, const ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab, std::vector<bool> &prune_words);
+
 class CorpusCount {
   public:
     // Memory usage will be DedupeMultipler(order) * block_size + total_chain_size + unknown vocab_hash_size
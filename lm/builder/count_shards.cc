@@ -0,0 +1,101 @@
+#include "lm/builder/count_shards.hh"
+
+#include "lm/common/ngram.hh"
+#include "lm/lm_exception.hh"
+#include "lm/vocab.hh"
+#include "util/file_piece.hh"
+#include "util/stream/chain.hh"
+
+#include <cstring>
+
+namespace lm {
+namespace builder {
+
+namespace {
+const char kCountShardMagic[] = "lmplz counts v1";
+} // namespace
+
+std::string CountShardCountsFile(const std::string &prefix) {
+  return prefix + ".counts";
+}
+
+std::string CountShardVocabFile(const std::string &prefix) {
+  return prefix + ".vocab";
+}
+
+void WriteCountShardHeader(int fd, std::size_t order, uint64_t token_count, WordIndex type_count) {
+  CountShardHeader header;
+  memset(&header, 0, sizeof(CountShardHeader));
+  memcpy(header.magic, kCountShardMagic, sizeof(kCountShardMagic));
+  header.order = order;
+  header.token_count = token_count;
+  header.type_count = type_count;
+  util::WriteOrThrow(fd, &header, sizeof(CountShardHeader));
+}
+
+CountShardReader::CountShardReader(const std::vector<std::string> &prefixes, std::size_t order, ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab)
+  : order_(order), token_count_(0), shards_(prefixes.size()) {
+  bool delimiters[256];
+  memset(delimiters, 0, sizeof(delimiters));
+  delimiters[0] = true;
+  for (std::vector<std::string>::const_iterator i = prefixes.begin(); i != prefixes.end(); ++i) {
+    shards_.push_back();
+    Shard &shard = shards_.back();
+    shard.name = CountShardCountsFile(*i);
+    shard.counts.reset(util::OpenReadOrThrow(shard.name.c_str()));
+
+    CountShardHeader header;
+    util::ReadOrThrow(shard.counts.get(), &header, sizeof(CountShardHeader));
+    UTIL_THROW_IF(memcmp(header.magic, kCountShardMagic, sizeof(kCountShardMagic)), FormatLoadException, shard.name << " is not a count shard written by lmplz --count_shard.");
+    UTIL_THROW_IF(header.order != order, FormatLoadException, shard.name << " has counts of order " << header.order << " but the model has order " << order << ".");
+    token_count_ += header.token_count;
+
+    util::FilePiece words(CountShardVocabFile(*i).c_str());
+    shard.mapping.reserve(header.type_count);
+    try {
+      while (true) {
+        shard.mapping.push_back(vocab.FindOrInsert(words.ReadDelimited(delimiters)));
+      }
+    } catch (const util::EndOfFileException &e) {}
+    UTIL_THROW_IF(shard.mapping.size() != header.type_count, FormatLoadException, words.FileName() << " has " << shard.mapping.size() << " words but " << shard.name << " expects " << header.type_count << ".");
+  }
+}
+
+void CountShardReader::Run(const util::stream::ChainPosition &position) {
+  const std::size_t block_size = position.GetChain().BlockSize();
+  const std::size_t entry_size = position.GetChain().EntrySize();
+  util::stream::Link link(position);
+  for (Shard *shard = shards_.begin(); shard != shards_.end(); ++shard) {
+    // Sort only combines n-grams when merging blocks, so a block must not mix
+    // shards: the n-grams within a shard are already unique.
+    std::size_t filled = 0;
+    const WordIndex *mapping = &*shard->mapping.begin();
+    const std::size_t mapping_size = shard->mapping.size();
+    while (true) {
+      uint8_t *base = static_cast<uint8_t*>(link->Get());
+      std::size_t got = util::ReadOrEOF(shard->counts.get(), base + filled, block_size - filled);
+      UTIL_THROW_IF(got % entry_size, FormatLoadException, shard->name << " ended with " << got << " bytes, not a multiple of " << entry_size << ".");
+      for (uint8_t *entry = base + filled; entry != base + filled + got; entry += entry_size) {
+        NGramHeader gram(entry, order_);
+        for (WordIndex *w = gram.begin(); w != gram.end(); ++w) {
+          UTIL_THROW_IF(*w >= mapping_size, FormatLoadException, shard->name << " has word id " << *w << " beyond its vocabulary of " << mapping_size << " words.");
+          *w = mapping[*w];
+        }
+      }
+      filled += got;
+      if (filled < block_size) break;
+      link->SetValidSize(block_size);
+      ++link;
+      filled = 0;
+    }
+    if (filled) {
+      link->SetValidSize(filled);
+      ++link;
+    }
+    shard->counts.reset();
+  }
+  link.Poison();
+}
+
+} // namespace builder
+} // namespace lm
@@ -0,0 +1,74 @@
+#ifndef LM_BUILDER_COUNT_SHARDS_H
+#define LM_BUILDER_COUNT_SHARDS_H
+
+#include "lm/word_index.hh"
+#include "util/file.hh"
+#include "util/fixed_array.hh"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace util { namespace stream { class ChainPosition; } }
+
+namespace lm {
+namespace ngram {
+template <class NewWordAction> class GrowableVocab;
+class WriteUniqueWords;
+} // namespace ngram
+
+namespace builder {
+
+/* Counting can be split over corpus shards run as independent processes
+ * (lmplz --count_shard), each writing two files:
+ *   prefix.counts  a CountShardHeader followed by the order-N n-grams with
+ *                  their counts, in suffix order and combined
+ *   prefix.vocab   the shard's vocabulary as null-delimited words in id order
+ * The shards are then merged (lmplz --merge_shards) into the input of
+ * adjusted counts.  Since every shard numbers its own vocabulary, words are
+ * mapped to a merged vocabulary on the way in.
+ */
+struct CountShardHeader {
+  char magic[16];
+  uint64_t order;
+  uint64_t token_count;
+  uint64_t type_count;
+};
+
+std::string CountShardCountsFile(const std::string &prefix);
+std::string CountShardVocabFile(const std::string &prefix);
+
+// Write the header to the start of a counts file.
+void WriteCountShardHeader(int fd, std::size_t order, uint64_t token_count, WordIndex type_count);
+
+// Reads the n-grams of several shards into a chain of order-N n-grams in the
+// merged vocabulary.  The output is not sorted.
+class CountShardReader {
+  public:
+    // Checks the shards and maps their words into vocab, whose new words are
+    // written out as usual.  The vocab can be destroyed afterwards.
+    CountShardReader(const std::vector<std::string> &prefixes, std::size_t order, ngram::GrowableVocab<ngram::WriteUniqueWords> &vocab);
+
+    // Sum of the shards' token counts.
+    uint64_t TokenCount() const { return token_count_; }
+
+    void Run(const util::stream::ChainPosition &position);
+
+  private:
+    struct Shard {
+      std::string name;
+      util::scoped_fd counts;
+      std::vector<WordIndex> mapping;
+    };
+
+    const std::size_t order_;
+    uint64_t token_count_;
+    util::FixedArray<Shard> shards_;
+};
+
+} // namespace builder
+} // namespace lm
+
+#endif // LM_BUILDER_COUNT_SHARDS_H
@@ -0,0 +1,114 @@
+#include "lm/builder/count_shards.hh"
+
+#include "lm/builder/output.hh"
+#include "lm/builder/pipeline.hh"
+#include "lm/lm_exception.hh"
+
+#include "util/file.hh"
+
+#define BOOST_TEST_MODULE CountShardsTest
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace lm { namespace builder { namespace {
+
+PipelineConfig TestConfig() {
+  PipelineConfig config;
+  config.order = 3;
+  config.sort.temp_prefix = "count_shards_test_temp";
+  config.sort.buffer_size = 16384;
+  config.sort.total_memory = 1 << 20;
+  config.initial_probs.adder_in.total_memory = 32768;
+  config.initial_probs.adder_in.block_count = 2;
+  config.initial_probs.adder_out.total_memory = 32768;
+  config.initial_probs.adder_out.block_count = 2;
+  config.initial_probs.interpolate_unigrams = true;
+  config.read_backoffs = config.initial_probs.adder_out;
+  config.vocab_estimate = 100;
+  config.minimum_block = 1024;
+  config.block_count = 2;
+  config.prune_thresholds.assign(config.order, 0);
+  config.prune_vocab = false;
+  config.renumber_vocabulary = false;
+  // The corpus is too small for the closed-form discounts at every order.
+  config.discount.fallback.amount[0] = 0.0;
+  config.discount.fallback.amount[1] = 0.5;
+  config.discount.fallback.amount[2] = 1.0;
+  config.discount.fallback.amount[3] = 1.5;
+  config.discount.bad_action = SILENT;
+  config.output_q = false;
+  config.vocab_size_for_unk = 0;
+  config.disallowed_symbol_action = THROW_UP;
+  return config;
+}
+
+int TextFile(const std::string &text) {
+  util::scoped_fd file(util::MakeTemp("count_shards_test_text"));
+  util::WriteOrThrow(file.get(), text.data(), text.size());
+  util::SeekOrThrow(file.get(), 0);
+  return file.release();
+}
+
+// Runs the pipeline, reading text_file unless config.count_shards is set, and
+// returns the ARPA file.
+std::string BuildARPA(PipelineConfig config, int text_file) {
+  util::scoped_fd arpa(util::MakeTemp("count_shards_test_arpa"));
+  {
+    Output output(config.sort.temp_prefix, false, false);
+    output.Add(new PrintHook(util::DupOrThrow(arpa.get()), false));
+    Pipeline(config, text_file, output);
+  }
+  std::string ret(util::SizeOrThrow(arpa.get()), '\0');
+  util::SeekOrThrow(arpa.get(), 0);
+  util::ReadOrThrow(arpa.get(), &ret[0], ret.size());
+  return ret;
+}
+
+void RemoveShard(const std::string &prefix) {
+  std::remove(CountShardCountsFile(prefix).c_str());
+  std::remove(CountShardVocabFile(prefix).c_str());
+}
+
+// Counting the halves of a corpus separately and merging the counts builds
+// the same model as counting the whole corpus.  Most n-grams appear in both
+// halves, so their counts have to be summed, and each half also has words
+// and n-grams of its own.
+BOOST_AUTO_TEST_CASE(MergeMatchesSinglePass) {
+  const std::string first =
+    "the cat sat on the mat\n"
+    "the dog sat on the log\n"
+    "a cat and a dog\n"
+    "the cat saw the dog\n"
+    "on the mat sat a cat\n";
+  const std::string second =
+    "the dog sat on the mat\n"
+    "a bird sat on the log\n"
+    "the cat and the bird\n"
+    "the cat sat on the mat\n"
+    "a dog saw a bird\n";
+
+  const std::string whole(BuildARPA(TestConfig(), TextFile(first + second)));
+
+  const std::string prefixes[] = {"count_shards_test_first", "count_shards_test_second"};
+  {
+    PipelineConfig config(TestConfig());
+    CountShard(config, TextFile(first), prefixes[0]);
+  }
+  {
+    PipelineConfig config(TestConfig());
+    CountShard(config, TextFile(second), prefixes[1]);
+  }
+  PipelineConfig merge(TestConfig());
+  merge.count_shards.assign(prefixes, prefixes + 2);
+  const std::string merged(BuildARPA(merge, TextFile("")));
+  RemoveShard(prefixes[0]);
+  RemoveShard(prefixes[1]);
+
+  BOOST_CHECK(whole.find("ngram 3=") != std::string::npos);
+  BOOST_CHECK_EQUAL(whole, merged);
+}
+
+}}} // namespaces
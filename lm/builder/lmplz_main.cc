@@ -72,7 +72,7 @@ int main(int argc, char *argv[]) {
     po::options_description options("Language model building options");
     lm::builder::PipelineConfig pipeline;
 
-    std::string text, intermediate, arpa;
+    std::string text, intermediate, arpa, binary, binary_type, count_shard;
     std::vector<std::string> pruning;
     std::vector<std::string> discount_fallback;
     std::vector<std::string> discount_fallback_default;
@@ -91,7 +91,7 @@ int main(int argc, char *argv[]) {
       ("interpolate_unigrams", po::value<bool>(&pipeline.initial_probs.interpolate_unigrams)->default_value(true)->implicit_value(true), "Interpolate the unigrams (default) as opposed to giving lots of mass to <unk> like SRI.  If you want SRI's behavior with a large <unk> and the old lmplz default, use --interpolate_unigrams 0.")
       ("skip_symbols", po::bool_switch(), "Treat <s>, </s>, and <unk> as whitespace instead of throwing an exception")
       ("temp_prefix,T", po::value<std::string>(&pipeline.sort.temp_prefix)->default_value("/tmp/lm"), "Temporary file prefix")
-      ("memory,S", lm:: SizeOption(pipeline.sort.total_memory, util::GuessPhysicalMemory() ? "80%" : "1G"), "Sorting memory")
+      ("memory,S", lm:: SizeOption(pipeline.sort.total_memory, util::GuessPhysicalMemory() ? "80%" : "1G"), "Memory budget, shared by all chains and sorts of a step")
       ("minimum_block", lm::SizeOption(pipeline.minimum_block, "8K"), "Minimum block size to allow")
       ("sort_block", lm::SizeOption(pipeline.sort.buffer_size, "64M"), "Size of IO operations for sort (determines arity)")
       ("block_count", po::value<std::size_t>(&pipeline.block_count)->default_value(2), "Block count (per order)")
@@ -100,6 +100,10 @@ int main(int argc, char *argv[]) {
       ("verbose_header", po::bool_switch(&verbose_header), "Add a verbose header to the ARPA file that includes information such as token count, smoothing type, etc.")
       ("text", po::value<std::string>(&text), "Read text from a file instead of stdin")
       ("arpa", po::value<std::string>(&arpa), "Write ARPA to a file instead of stdout")
+      ("binary", po::value<std::string>(&binary), "Write a KenLM binary file built directly from the n-grams.  Turns off ARPA output (which can be reactivated by --arpa file).")
+      ("binary_type", po::value<std::string>(&binary_type)->default_value("probing"), "Data structure of the --binary file: probing or trie")
+      ("count_shard", po::value<std::string>(&count_shard), "Only count the text, which is one shard of a corpus, and write sorted counts to files with this prefix.  Shards can be counted by independent processes and combined with --merge_shards.")
+      ("merge_shards", po::value<std::vector<std::string> >(&pipeline.count_shards)->multitoken(), "Build the model from the counts of shards written by --count_shard with these prefixes instead of reading text.")
       ("intermediate", po::value<std::string>(&intermediate), "Write ngrams to intermediate files.  Turns off ARPA output (which can be reactivated by --arpa file).  Forces --renumber on.")
       ("renumber", po::bool_switch(&pipeline.renumber_vocabulary), "Rrenumber the vocabulary identifiers so that they are monotone with the hash of each string.  This is consistent with the ordering used by the trie data structure.")
       ("collapse_values", po::bool_switch(&pipeline.output_q), "Collapse probability and backoff into a single value, q that yields the same sentence-level probabilities.  See http://kheafield.com/professional/edinburgh/rest_paper.pdf for more details, including a proof.")
@@ -197,15 +201,44 @@ int main(int argc, char *argv[]) {
       out.reset(util::CreateOrThrow(arpa.c_str()));
     }
 
+    if (vm.count("count_shard")) {
+      if (!pipeline.count_shards.empty() || vm.count("arpa") || vm.count("binary") || vm.count("intermediate")) {
+        std::cerr << "--count_shard only writes counts.  Build the model from them with --merge_shards." << std::endl;
+        return 1;
+      }
+      lm::builder::CountShard(pipeline, in.release(), count_shard);
+      util::PrintUsage(std::cerr);
+      return 0;
+    }
+    if (!pipeline.count_shards.empty() && vm.count("text")) {
+      std::cerr << "--merge_shards reads counts instead of --text." << std::endl;
+      return 1;
+    }
+
     try {
       bool writing_intermediate = vm.count("intermediate");
       if (writing_intermediate) {
         pipeline.renumber_vocabulary = true;
       }
+      bool writing_binary = vm.count("binary");
       lm::builder::Output output(writing_intermediate ? intermediate : pipeline.sort.temp_prefix, writing_intermediate, pipeline.output_q);
-      if (!writing_intermediate || vm.count("arpa")) {
+      if ((!writing_intermediate && !writing_binary) || vm.count("arpa")) {
         output.Add(new lm::builder::PrintHook(out.release(), verbose_header));
       }
+      if (writing_binary) {
+        lm::ngram::ModelType model_type;
+        if (binary_type == "probing") {
+          model_type = lm::ngram::PROBING;
+        } else if (binary_type == "trie") {
+          model_type = lm::ngram::TRIE;
+        } else {
+          std::cerr << "Unknown --binary_type " << binary_type << ".  Use probing or trie." << std::endl;
+          return 1;
+        }
+        lm::ngram::Config config;
+        config.temporary_directory_prefix = pipeline.sort.temp_prefix;
+        output.Add(new lm::builder::BinaryHook(binary, model_type, config, pipeline.output_q));
+      }
       lm::builder::Pipeline(pipeline, in.release(), output);
     } catch (const util::MallocException &e) {
       std::cerr << e.what() << std::endl;
@@ -1,12 +1,19 @@
 #include "lm/builder/output.hh"
 
 #include "lm/common/model_buffer.hh"
+#include "lm/common/ngram_stream.hh"
 #include "lm/common/print.hh"
+#include "lm/max_order.hh"
+#include "lm/model.hh"
+#include "lm/ngram_source.hh"
 #include "util/file_stream.hh"
 #include "util/stream/multi_stream.hh"
 
+#include <algorithm>
 #include <iostream>
 
+#include <boost/scoped_ptr.hpp>
+
 namespace lm { namespace builder {
 
 OutputHook::~OutputHook() {}
@@ -25,7 +32,7 @@ void Output::SinkProbs(util::stream::Chains &chains) {
   chains >> util::stream::kRecycle;
   chains.Wait(false);
   if (Have(PROB_SEQUENTIAL_HOOK)) {
-    std::cerr << "=== 5/5 Writing ARPA model ===" << std::endl;
+    std::cerr << "=== 5/5 Writing model ===" << std::endl;
     buffer_.Source(chains);
     Apply(PROB_SEQUENTIAL_HOOK, chains);
     chains >> util::stream::kRecycle;
@@ -49,4 +56,115 @@ void PrintHook::Sink(const HeaderInfo &info, int vocab_file, util::stream::Chain
   chains >> PrintARPA(vocab_file, file_.get(), info.counts_pruned);
 }
 
+namespace {
+
+// Reads the sequential probability chains for the model builders.  Entries
+// are copied out before advancing, since the block may then be recycled.
+class ChainSource : public NGramSource {
+  public:
+    ChainSource(const util::stream::ChainPositions &positions, int vocab_file, const std::vector<uint64_t> &counts)
+      : positions_(positions), vocab_(vocab_file), counts_(counts), order_(0) {}
+
+    void ReadCounts(std::vector<uint64_t> &counts) {
+      counts = counts_;
+    }
+
+    void BeginOrder(unsigned int order) {
+      UTIL_THROW_IF(order != order_ + 1 || order > positions_.size(), FormatLoadException, "Orders must be read in sequence, but got " << order << " after " << order_);
+      CheckExhausted();
+      order_ = order;
+      if (order == positions_.size()) {
+        longest_.reset(new ProxyStream<NGram<Prob> >(positions_[order - 1], NGram<Prob>(NULL, order)));
+      } else {
+        middle_.reset(new ProxyStream<NGram<ProbBackoff> >(positions_[order - 1], NGram<ProbBackoff>(NULL, order)));
+      }
+    }
+
+    const WordIndex *Next(float &prob, float &backoff) {
+      ++read_;
+      if (order_ == positions_.size()) {
+        ProxyStream<NGram<Prob> > &stream = *longest_;
+        UTIL_THROW_IF(!stream, FormatLoadException, "Ran out of " << order_ << "-grams");
+        std::copy(stream->begin(), stream->end(), words_);
+        prob = stream->Value().prob;
+        ++stream;
+      } else {
+        ProxyStream<NGram<ProbBackoff> > &stream = *middle_;
+        UTIL_THROW_IF(!stream, FormatLoadException, "Ran out of " << order_ << "-grams");
+        std::copy(stream->begin(), stream->end(), words_);
+        prob = stream->Value().prob;
+        backoff = stream->Value().backoff;
+        ++stream;
+      }
+      return words_;
+    }
+
+    StringPiece Word(WordIndex id) const {
+      return vocab_.LookupPiece(id);
+    }
+
+    void End() {
+      UTIL_THROW_IF(order_ != positions_.size(), FormatLoadException, "Stopped reading after order " << order_ << " of " << positions_.size());
+      CheckExhausted();
+    }
+
+  private:
+    void CheckExhausted() const {
+      UTIL_THROW_IF((middle_.get() && *middle_) || (longest_.get() && *longest_), FormatLoadException, "More " << order_ << "-grams than the " << counts_[order_ - 1] << " counted");
+    }
+
+    const util::stream::ChainPositions &positions_;
+    VocabReconstitute vocab_;
+    std::vector<uint64_t> counts_;
+    unsigned int order_;
+    boost::scoped_ptr<ProxyStream<NGram<ProbBackoff> > > middle_;
+    boost::scoped_ptr<ProxyStream<NGram<Prob> > > longest_;
+    WordIndex words_[KENLM_MAX_ORDER];
+};
+
+class BuildBinary {
+  public:
+    // Does not take ownership of vocab_file.
+    BuildBinary(int vocab_file, const std::vector<uint64_t> &counts, ngram::ModelType model_type, const ngram::Config &config)
+      : vocab_file_(vocab_file), counts_(counts), model_type_(model_type), config_(config) {}
+
+    void Run(const util::stream::ChainPositions &positions) {
+      // The model checks the order against KENLM_MAX_ORDER before reading.
+      ChainSource source(positions, vocab_file_, counts_);
+      switch (model_type_) {
+        case ngram::PROBING:
+          {
+            ngram::ProbingModel model(source, config_);
+          }
+          break;
+        case ngram::TRIE:
+          {
+            ngram::TrieModel model(source, config_);
+          }
+          break;
+        default:
+          UTIL_THROW(FormatLoadException, "Model type " << model_type_ << " cannot be built by lmplz");
+      }
+    }
+
+  private:
+    int vocab_file_;
+    std::vector<uint64_t> counts_;
+    ngram::ModelType model_type_;
+    ngram::Config config_;
+};
+
+} // namespace
+
+BinaryHook::BinaryHook(const std::string &file, ngram::ModelType model_type, const ngram::Config &config, bool output_q)
+  : OutputHook(PROB_SEQUENTIAL_HOOK), file_(file), model_type_(model_type), config_(config) {
+  UTIL_THROW_IF(model_type != ngram::PROBING && model_type != ngram::TRIE, util::Exception, "lmplz can only write probing or trie binary files");
+  UTIL_THROW_IF(output_q, util::Exception, "--collapse_values can not be written with --binary: q values are not probabilities and have no backoff.  Write an ARPA file with --arpa instead.");
+}
+
+void BinaryHook::Sink(const HeaderInfo &info, int vocab_file, util::stream::Chains &chains) {
+  config_.write_mmap = file_.c_str();
+  chains >> BuildBinary(vocab_file, info.counts_pruned, model_type_, config_);
+}
+
 }} // namespaces
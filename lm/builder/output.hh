@@ -3,11 +3,15 @@
 
 #include "lm/builder/header_info.hh"
 #include "lm/common/model_buffer.hh"
+#include "lm/config.hh"
+#include "lm/model_type.hh"
 #include "util/file.hh"
 
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/utility.hpp>
 
+#include <string>
+
 namespace util { namespace stream { class Chains; class ChainPositions; } }
 
 /* Outputs from lmplz: ARPA, sharded files, etc */
@@ -80,6 +84,21 @@ class PrintHook : public OutputHook {
     bool verbose_header_;
 };
 
+// Builds a KenLM binary file straight from the n-grams, without ARPA.
+class BinaryHook : public OutputHook {
+  public:
+    // Supports PROBING and TRIE.  config.write_mmap is replaced by file.
+    // Throws if output_q: the binary formats store probability and backoff.
+    BinaryHook(const std::string &file, ngram::ModelType model_type, const ngram::Config &config, bool output_q);
+
+    void Sink(const HeaderInfo &info, int vocab_file, util::stream::Chains &chains);
+
+  private:
+    std::string file_;
+    ngram::ModelType model_type_;
+    ngram::Config config_;
+};
+
 }} // namespaces
 
 #endif // LM_BUILDER_OUTPUT_H
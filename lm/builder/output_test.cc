@@ -0,0 +1,28 @@
+#include "lm/builder/output.hh"
+
+#include "lm/config.hh"
+#include "util/exception.hh"
+
+#define BOOST_TEST_MODULE OutputTest
+#include <boost/test/unit_test.hpp>
+
+namespace lm { namespace builder { namespace {
+
+// The binary formats store probability and backoff, so q values are refused
+// up front instead of failing in the middle of the pipeline.
+BOOST_AUTO_TEST_CASE(BinaryRejectsQ) {
+  ngram::Config config;
+  BOOST_CHECK_THROW(BinaryHook("unused", ngram::PROBING, config, true), util::Exception);
+  BOOST_CHECK_THROW(BinaryHook("unused", ngram::TRIE, config, true), util::Exception);
+  BinaryHook probing("unused", ngram::PROBING, config, false);
+  BinaryHook trie("unused", ngram::TRIE, config, false);
+  BOOST_CHECK_EQUAL(PROB_SEQUENTIAL_HOOK, probing.Type());
+  BOOST_CHECK_EQUAL(PROB_SEQUENTIAL_HOOK, trie.Type());
+}
+
+BOOST_AUTO_TEST_CASE(BinaryRejectsQuantized) {
+  ngram::Config config;
+  BOOST_CHECK_THROW(BinaryHook("unused", ngram::QUANT_PROBING, config, false), util::Exception);
+}
+
+}}} // namespaces
@@ -3,6 +3,7 @@
 #include "lm/builder/adjust_counts.hh"
 #include "lm/builder/combine_counts.hh"
 #include "lm/builder/corpus_count.hh"
+#include "lm/builder/count_shards.hh"
 #include "lm/builder/hash_gamma.hh"
 #include "lm/builder/initial_probabilities.hh"
 #include "lm/builder/interpolate.hh"
@@ -16,6 +17,7 @@
 #include "util/exception.hh"
 #include "util/file.hh"
 #include "util/stream/io.hh"
+#include "util/usage.hh"
 
 #include <algorithm>
 #include <iostream>
@@ -41,11 +43,20 @@ void PrintStatistics(const std::vector<uint64_t> &counts, const std::vector<uint
   }
 }
 
+// Memory of the small chains that run beside the n-gram chains in steps 3 and
+// 4.  It comes out of the budget before the n-gram chains are sized.
+std::size_t SideChainMemory(const PipelineConfig &config) {
+  const std::size_t initial = config.order * (config.initial_probs.adder_in.total_memory + config.initial_probs.adder_out.total_memory);
+  const std::size_t interpolate = (config.order - 1) * config.read_backoffs.total_memory;
+  return std::max(initial, interpolate);
+}
+
 class Master {
   public:
-    explicit Master(PipelineConfig &config, unsigned output_steps)
-      : config_(config), chains_(config.order), unigrams_(util::MakeTemp(config_.TempPrefix())), steps_(output_steps + 4) {
+    Master(PipelineConfig &config, unsigned steps)
+      : config_(config), chains_(config.order), unigrams_(util::MakeTemp(config_.TempPrefix())), steps_(steps), planned_(0) {
       config_.minimum_block = std::max(NGram<BuildingPayload>::TotalSize(config_.order), config_.minimum_block);
+      util::ResetRSSPeak();
     }
 
     const PipelineConfig &Config() const { return config_; }
@@ -67,6 +78,7 @@ class Master {
       const std::size_t total = std::max<std::size_t>(config_.TotalMemory(), min_chains + subtract_for_numbering + config_.minimum_block);
       // Do merge sort with calculated laziness.
       const std::size_t merge_using = ngrams.Merge(std::min(total - min_chains - subtract_for_numbering, ngrams.DefaultLazy()));
+      Plan(merge_using + subtract_for_numbering);
 
       std::vector<uint64_t> count_bounds(1, types);
       CreateChains(total - merge_using - subtract_for_numbering, count_bounds);
@@ -80,8 +92,11 @@ class Master {
       for (std::size_t i = 0; i < config_.order - unigrams_are_sorted; ++i) {
         sorts[i].Merge(0);
       }
-      // There's no lazy merge, so just divide memory amongst the chains.
-      CreateChains(config_.TotalMemory(), counts);
+      // There's no lazy merge, so just divide memory amongst the chains, less
+      // the second reading and the gamma output.
+      const std::size_t side = config_.order * (second_config.total_memory + config_.initial_probs.adder_out.total_memory);
+      Plan(side);
+      CreateChains(config_.TotalMemory() - side, counts);
       chains_.back().ActivateProgress();
       if (unigrams_are_sorted) {
         chains_[0] >> unigrams_.Source();
@@ -99,14 +114,22 @@ class Master {
       }
     }
 
-    // There is no sort after this, so go for broke on lazy merging.
+    /* There is no sort after this, so go for broke on lazy merging.  Orders
+     * whose runs don't fit in what is left of the budget are merged on disk
+     * first, spilling to temporary files, until they do; in the extreme each
+     * is fully merged and read back in chain-sized blocks.
+     */
     template <class Compare> void MaximumLazyInput(const std::vector<uint64_t> &counts, Sorts<Compare> &sorts) {
+      // The gammas are read beside the n-grams.
+      const std::size_t side = (config_.order - 1) * config_.read_backoffs.total_memory;
+      const std::size_t budget = config_.TotalMemory() - side;
+      Plan(side);
       // Determine the minimum we can use for all the chains.
       std::size_t min_chains = 0;
       for (std::size_t i = 0; i < config_.order; ++i) {
         min_chains += std::min(counts[i] * NGram<BuildingPayload>::TotalSize(i + 1), static_cast<uint64_t>(config_.minimum_block));
       }
-      std::size_t for_merge = min_chains > config_.TotalMemory() ? 0 : (config_.TotalMemory() - min_chains);
+      std::size_t for_merge = min_chains > budget ? 0 : (budget - min_chains);
       std::vector<std::size_t> laziness;
       // Prioritize longer n-grams.
       for (util::stream::Sort<SuffixOrder> *i = sorts.end() - 1; i >= sorts.begin(); --i) {
@@ -115,6 +138,9 @@ class Master {
         for_merge -= laziness.back();
       }
       std::reverse(laziness.begin(), laziness.end());
+      for (std::size_t i = 0; i < laziness.size(); ++i) {
+        Plan(laziness[i]);
+      }
 
       CreateChains(for_merge + min_chains, counts);
       chains_.back().ActivateProgress();
@@ -136,6 +162,16 @@ class Master {
 
     unsigned int Steps() const { return steps_; }
 
+    // Count memory allocated in the current step outside CreateChains.
+    void Plan(std::size_t bytes) { planned_ += bytes; }
+
+    // Report the memory of the step that just finished and start the next.
+    void ReportMemory(unsigned int step) {
+      std::cerr << "Memory for step " << step << ": " << planned_ << " bytes planned of " << config_.TotalMemory() << " budget, peak resident " << util::RSSPeak() << " bytes" << std::endl;
+      planned_ = 0;
+      util::ResetRSSPeak();
+    }
+
   private:
     // Create chains, allocating memory to them.  Totally heuristic.  Count
     // bounds are upper bounds on the counts or not present.
@@ -151,19 +187,19 @@ class Master {
       assignments.resize(config_.order, remaining_mem);
 
       // Now we know how much memory everybody wants.  How much will they get?
-      // Proportional to this.
-      std::vector<float> portions;
+      // Proportional to this.  Double so rounding stays within the budget.
+      std::vector<double> portions;
       // Indices of orders that have yet to be assigned.
       std::vector<std::size_t> unassigned;
       for (std::size_t i = 0; i < config_.order; ++i) {
-        portions.push_back(static_cast<float>((i+1) * NGram<BuildingPayload>::TotalSize(i+1)));
+        portions.push_back(static_cast<double>((i+1) * NGram<BuildingPayload>::TotalSize(i+1)));
         unassigned.push_back(i);
       }
       /*If somebody doesn't eat their full dinner, give it to the rest of the
        * family.  Then somebody else might not eat their full dinner etc.  Ends
        * when everybody unassigned is hungry.
        */
-      float sum;
+      double sum;
       bool found_more;
       std::vector<std::size_t> block_count(config_.order);
       do {
@@ -195,6 +231,7 @@ class Master {
         // This was crashing if e.g. there was no 5-gram.
         assignments[i] = std::max(assignments[i], block_count[i] * NGram<BuildingPayload>::TotalSize(i + 1));
         std::cerr << ' ' << (i+1) << ":" << assignments[i];
+        Plan(assignments[i]);
         chains_.push_back(util::stream::ChainConfig(NGram<BuildingPayload>::TotalSize(i + 1), block_count[i], assignments[i]));
       }
       std::cerr << std::endl;
@@ -207,6 +244,8 @@ class Master {
     util::stream::FileBuffer unigrams_;
 
     const unsigned int steps_;
+
+    std::size_t planned_;
 };
 
 util::stream::Sort<SuffixOrder, CombineCounts> *CountText(int text_file /* input */, int vocab_file /* output */, Master &master, uint64_t &token_count, WordIndex &type_count, std::string &text_file_name, std::vector<bool> &prune_words) {
@@ -232,6 +271,39 @@ util::stream::Sort<SuffixOrder, CombineCounts> *CountText(int text_file /* input
 
   util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorter(new util::stream::Sort<SuffixOrder, CombineCounts>(chain, config.sort, SuffixOrder(config.order), CombineCounts()));
   chain.Wait(true);
+  master.Plan(vocab_usage + memory_for_chain);
+  master.ReportMemory(1);
+  return sorter.release();
+}
+
+// Like CountText, but reading the counts of shards written by CountShard.
+util::stream::Sort<SuffixOrder, CombineCounts> *MergeCounts(int vocab_file /* output */, Master &master, uint64_t &token_count, WordIndex &type_count, std::string &text_file_name, std::vector<bool> &prune_words) {
+  const PipelineConfig &config = master.Config();
+  std::cerr << "=== 1/" << master.Steps() << " Merging and sorting count shards ===" << std::endl;
+
+  util::scoped_ptr<CountShardReader> reader;
+  {
+    // Only needed to number the words, so free it before allocating the chain.
+    ngram::GrowableVocab<ngram::WriteUniqueWords> vocab(config.vocab_estimate, vocab_file);
+    reader.reset(new CountShardReader(config.count_shards, config.order, vocab));
+    type_count = vocab.Size();
+    if (!config.prune_vocab_file.empty()) {
+      LimitVocab(config.prune_vocab_file, vocab, prune_words);
+    }
+  }
+  token_count = reader->TokenCount();
+  text_file_name.clear();
+  for (std::vector<std::string>::const_iterator i = config.count_shards.begin(); i != config.count_shards.end(); ++i) {
+    if (i != config.count_shards.begin()) text_file_name += ' ';
+    text_file_name += *i;
+  }
+
+  util::stream::Chain chain(util::stream::ChainConfig(NGram<BuildingPayload>::TotalSize(config.order), config.block_count, config.TotalMemory()));
+  chain >> boost::ref(*reader);
+  util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorter(new util::stream::Sort<SuffixOrder, CombineCounts>(chain, config.sort, SuffixOrder(config.order), CombineCounts()));
+  chain.Wait(true);
+  master.Plan(config.TotalMemory());
+  master.ReportMemory(1);
   return sorter.release();
 }
 
@@ -242,6 +314,7 @@ void InitialProbabilities(const std::vector<uint64_t> &counts, const std::vector
   {
     Sorts<ContextOrder> sorts;
     master.SetupSorts(sorts, !config.renumber_vocabulary);
+    master.ReportMemory(2);
     PrintStatistics(counts, counts_pruned, discounts);
     lm::ngram::ShowSizes(counts_pruned);
     std::cerr << "=== 3/" << master.Steps() << " Calculating and sorting initial probabilities ===" << std::endl;
@@ -259,6 +332,7 @@ void InitialProbabilities(const std::vector<uint64_t> &counts, const std::vector
   }
   // Has to be done here due to gamma_chains scope.
   master.SetupSorts(primary, true);
+  master.ReportMemory(3);
 }
 
 void InterpolateProbabilities(const std::vector<uint64_t> &counts, Master &master, Sorts<SuffixOrder> &primary, util::FixedArray<util::stream::FileBuffer> &gammas, Output &output, const SpecialVocab &specials) {
@@ -281,6 +355,8 @@ void InterpolateProbabilities(const std::vector<uint64_t> &counts, Master &maste
   master >> Interpolate(std::max(master.Config().vocab_size_for_unk, counts[0] - 1 /* <s> is not included */), util::stream::ChainPositions(gamma_chains), config.prune_thresholds, config.prune_vocab, config.output_q, specials);
   gamma_chains >> util::stream::kRecycle;
   output.SinkProbs(master.MutableChains());
+  // Includes writing the model, if that is a separate step.
+  master.ReportMemory(4);
 }
 
 class VocabNumbering {
@@ -326,9 +402,7 @@ class VocabNumbering {
     SpecialVocab specials_;
 };
 
-} // namespace
-
-void Pipeline(PipelineConfig &config, int text_file, Output &output) {
+void CheckConfig(PipelineConfig &config) {
   // Some fail-fast sanity checks.
   if (config.sort.buffer_size * 4 > config.TotalMemory()) {
     config.sort.buffer_size = config.TotalMemory() / 4;
@@ -339,10 +413,16 @@ void Pipeline(PipelineConfig &config, int text_file, Output &output) {
     std::cerr << "Warning: raising minimum block to " << config.minimum_block << " to fit an ngram in every block." << std::endl;
   }
   UTIL_THROW_IF(config.sort.buffer_size < config.minimum_block, util::Exception, "Sort block size " << config.sort.buffer_size << " is below the minimum block size " << config.minimum_block << ".");
-  UTIL_THROW_IF(config.TotalMemory() < config.minimum_block * config.order * config.block_count, util::Exception,
-      "Not enough memory to fit " << (config.order * config.block_count) << " blocks with minimum size " << config.minimum_block << ".  Increase memory to " << (config.minimum_block * config.order * config.block_count) << " bytes or decrease the minimum block size.");
+  const std::size_t required = config.minimum_block * config.order * config.block_count + SideChainMemory(config);
+  UTIL_THROW_IF(config.TotalMemory() < required, util::Exception,
+      "Not enough memory to fit " << (config.order * config.block_count) << " blocks with minimum size " << config.minimum_block << " and the gamma chains.  Increase memory to " << required << " bytes or decrease the minimum block size.");
+}
+
+} // namespace
 
-  Master master(config, output.Steps());
+void Pipeline(PipelineConfig &config, int text_file, Output &output) {
+  CheckConfig(config);
+  Master master(config, output.Steps() + 4);
   // master's destructor will wait for chains.  But they might be deadlocked if
   // this thread dies because e.g. it ran out of memory.
   try {
@@ -351,8 +431,13 @@ void Pipeline(PipelineConfig &config, int text_file, Output &output) {
     WordIndex type_count;
     std::string text_file_name;
     std::vector<bool> prune_words;
-    util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorted_counts(
-        CountText(text_file, numbering.WriteOnTheFly(), master, token_count, type_count, text_file_name, prune_words));
+    util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorted_counts;
+    if (config.count_shards.empty()) {
+      sorted_counts.reset(CountText(text_file, numbering.WriteOnTheFly(), master, token_count, type_count, text_file_name, prune_words));
+    } else {
+      util::scoped_fd unused_text(text_file);
+      sorted_counts.reset(MergeCounts(numbering.WriteOnTheFly(), master, token_count, type_count, text_file_name, prune_words));
+    }
     std::cerr << "Unigram tokens " << token_count << " types " << type_count << std::endl;
 
     // Create vocab mapping, which uses temporary memory, while nothing else is happening.
@@ -382,4 +467,36 @@ void Pipeline(PipelineConfig &config, int text_file, Output &output) {
   }
 }
 
+void CountShard(PipelineConfig &config, int text_file, const std::string &prefix) {
+  CheckConfig(config);
+  Master master(config, 2);
+  try {
+    util::scoped_fd vocab_file(util::CreateOrThrow(CountShardVocabFile(prefix).c_str()));
+    util::scoped_fd counts_file(util::CreateOrThrow(CountShardCountsFile(prefix).c_str()));
+    uint64_t token_count;
+    WordIndex type_count;
+    std::string text_file_name;
+    // Pruning the vocabulary is done when the shards are merged.
+    std::vector<bool> prune_words;
+    util::scoped_ptr<util::stream::Sort<SuffixOrder, CombineCounts> > sorted_counts(
+        CountText(text_file, vocab_file.get(), master, token_count, type_count, text_file_name, prune_words));
+    std::cerr << "Unigram tokens " << token_count << " types " << type_count << std::endl;
+
+    std::cerr << "=== 2/" << master.Steps() << " Writing sorted counts ===" << std::endl;
+    WriteCountShardHeader(counts_file.get(), config.order, token_count, type_count);
+    // Leave the chain at least a sort buffer per block.
+    const std::size_t chain_min = std::min(config.TotalMemory() / 2, config.sort.buffer_size * config.block_count);
+    const std::size_t merge_using = sorted_counts->Merge(config.TotalMemory() - chain_min);
+    util::stream::Chain chain(util::stream::ChainConfig(NGram<BuildingPayload>::TotalSize(config.order), config.block_count, config.TotalMemory() - merge_using));
+    sorted_counts->Output(chain, merge_using);
+    chain >> util::stream::WriteAndRecycle(counts_file.get());
+    chain.Wait(true);
+    master.Plan(config.TotalMemory());
+    master.ReportMemory(2);
+  } catch (const util::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    abort();
+  }
+}
+
 }} // namespaces
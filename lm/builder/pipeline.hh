@@ -11,6 +11,7 @@
 
 #include <string>
 #include <cstddef>
+#include <vector>
 
 namespace lm { namespace builder {
 
@@ -65,12 +66,25 @@ struct PipelineConfig {
    */
   WarningAction disallowed_symbol_action;
 
+  /* Prefixes of count shards written by CountShard.  If not empty, Pipeline
+   * merges their counts instead of counting text.
+   */
+  std::vector<std::string> count_shards;
+
   const std::string &TempPrefix() const { return sort.temp_prefix; }
+  // Budget shared by the chains, lazy merges, and side chains of each step.
+  // What doesn't fit is merged on disk.  Each step reports its plan and peak
+  // resident size.
   std::size_t TotalMemory() const { return sort.total_memory; }
 };
 
 // Takes ownership of text_file and out_arpa.
 void Pipeline(PipelineConfig &config, int text_file, Output &output);
 
+// Count one shard of the corpus and write sorted counts to files starting with
+// prefix, for a later Pipeline with config.count_shards.  Takes ownership of
+// text_file.
+void CountShard(PipelineConfig &config, int text_file, const std::string &prefix);
+
 }} // namespaces
 #endif // LM_BUILDER_PIPELINE_H
@@ -14,7 +14,9 @@ Config::Config() :
   positive_log_probability(THROW_UP),
   unknown_missing_logprob(-100.0),
   probing_multiplier(1.5),
+  bloom_bits(0),
   building_memory(1073741824ULL), // 1 GB
+  building_threads(1),
   temporary_directory_prefix(""),
   arpa_complain(ALL),
   write_mmap(NULL),
@@ -24,7 +26,8 @@ Config::Config() :
   prob_bits(8),
   backoff_bits(8),
   pointer_bhiksha_bits(22),
-  load_method(util::POPULATE_OR_READ) {}
+  load_method(util::POPULATE_OR_READ),
+  numa_node(0) {}
 
 } // namespace ngram
 } // namespace lm
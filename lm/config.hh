@@ -60,11 +60,22 @@ struct Config {
   // TrieModel which has lower memory consumption.
   float probing_multiplier;
 
+  // Bits per n-gram of the Bloom filters checked before the probing hash
+  // tables of orders 2 and up, or 0 for no filters.  Filters answer most
+  // lookups of absent n-grams without touching the tables.  Stored in binary
+  // files.  Only applies to ProbingModel and RestProbingModel.
+  uint8_t bloom_bits;
+
   // Amount of memory to use for building.  The actual memory usage will be
   // higher since this just sets sort buffer size.  Only applies to trie
   // models.
   std::size_t building_memory;
 
+  // Threads used to parse and sort n-grams when building a trie.  The output
+  // does not depend on this.  Parsing is only split when reading an
+  // uncompressed ARPA file.
+  std::size_t building_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If empty, defaults to write_mmap.  If that's NULL,
@@ -114,6 +125,9 @@ struct Config {
   // See util/mmap.hh for details of MapMethod.
   util::LoadMethod load_method;
 
+  // NUMA node to place the model on when load_method is NODE_READ.
+  std::size_t numa_node;
+
 
   // Set defaults.
   Config();
@@ -46,7 +46,7 @@ bool IsEntirelyWhiteSpace(const StringPiece &line) {
 }
 
 ARPAOutput::ARPAOutput(const char *name, size_t buffer_size) 
-  : file_backing_(util::CreateOrThrow(name)), file_(file_backing_.get(), buffer_size) {}
+  : file_backing_(util::CreateOrThrow(name)), file_(file_backing_.get(), buffer_size), fast_counter_(0) {}
 
 void ARPAOutput::ReserveForCounts(std::streampos reserve) {
   for (std::streampos i = 0; i < reserve; i += std::streampos(1)) {
@@ -55,6 +55,7 @@ void ARPAOutput::ReserveForCounts(std::streampos reserve) {
 }
 
 void ARPAOutput::BeginLength(unsigned int length) {
+  fast_counter_ = 0;
   file_ << '\\' << length << "-grams:" << '\n';
 }
 
@@ -7,21 +7,31 @@
 #include "lm/filter/vocab.hh"
 #include "lm/filter/wrapper.hh"
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/file_piece.hh"
+#include "util/read_compressed.hh"
 
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
 
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
 
 namespace lm {
 namespace {
 
 void DisplayHelp(const char *name) {
   std::cerr
-    << "Usage: " << name << " mode [context] [phrase] [raw|arpa] [threads:m] [batch_size:m] (vocab|model):input_file output_file\n\n"
+    << "Usage: " << name << " mode [context] [phrase] [raw|arpa] [threads:m] [batch_size:m] [output_threads:m] [vocabs:list] (vocab|model):input_file output_file\n\n"
     "copy mode just copies, but makes the format nicer for e.g. irstlm's broken\n"
     "    parser.\n"
     "single mode treats the entire input as a single sentence.\n"
@@ -39,10 +49,20 @@ void DisplayHelp(const char *name) {
     "raw means space-separated tokens, optionally followed by a tab and arbitrary\n"
     "    text.  This is useful for ngram count files.\n"
     "arpa means the ARPA file format for n-gram language models.\n\n"
+    "vocabs:list filters to several vocabularies in one pass over the model.  Each\n"
+    "    line of list is a vocabulary file, optionally followed by a space and the\n"
+    "    file to write its model to (default: output_file with the 0-indexed line\n"
+    "    number appended).  In single mode each vocabulary file is read as one\n"
+    "    sentence, in union mode as one sentence per line.  The model is then the\n"
+    "    only input.\n\n"
 #ifndef NTHREAD
     "threads:m sets m threads (default: conccurrency detected by boost)\n"
     "batch_size:m sets the batch size for threading.  Expect memory usage from this\n"
-    "    of 2*threads*batch_size n-grams.\n\n"
+    "    of 2*threads*batch_size n-grams.\n"
+    "output_threads:m writes the output files of multiple mode or vocabs: on m\n"
+    "    threads (default: 1).\n"
+    "With more than one thread, a compressed model is decompressed on a thread of\n"
+    "    its own.\n\n"
 #else
     "This binary was compiled with -DNTHREAD, disabling threading.  If you wanted\n"
     "    threading, compile without this flag against Boost >=1.42.0.\n\n"
@@ -62,10 +82,12 @@ struct Config {
 #ifndef NTHREAD
   batch_size(25000),
   threads(boost::thread::hardware_concurrency()),
+  output_threads(1),
 #endif
   phrase(false),
   context(false),
-  format(FORMAT_ARPA)
+  format(FORMAT_ARPA),
+  vocabs(NULL)
   {
 #ifndef NTHREAD
     if (!threads) threads = 1;
@@ -75,13 +97,83 @@ struct Config {
 #ifndef NTHREAD
   size_t batch_size;
   size_t threads;
+  size_t output_threads;
 #endif
   bool phrase;
   bool context;
   FilterMode mode;
   Format format;
+  // List of vocabulary files or NULL.
+  const char *vocabs;
 };
 
+#ifndef NTHREAD
+// Threads that can write the output files in parallel.
+template <class OutputBuffer> size_t OutputThreads(const Config &config) {
+  return config.output_threads;
+}
+template <> size_t OutputThreads<BinaryOutputBuffer>(const Config &) {
+  return 1;
+}
+
+// Decompresses a model on its own thread and passes the text through a pipe,
+// so that filtering does not wait for decompression.
+class DecompressThread : boost::noncopyable {
+  public:
+    // Takes ownership of fd.
+    explicit DecompressThread(int fd) : in_(fd) {
+      int fds[2];
+      UTIL_THROW_IF(pipe(fds), util::ErrnoException, "Failed to create a pipe for decompression");
+      read_ = fds[0];
+      write_.reset(fds[1]);
+      // Closing the read end early stops the thread with EPIPE instead.
+      signal(SIGPIPE, SIG_IGN);
+      thread_.reset(new boost::thread(boost::ref(*this)));
+    }
+
+    // Destroy after closing the read end.
+    ~DecompressThread() {
+      thread_->join();
+    }
+
+    // Read end of the pipe, which the caller owns.
+    int Output() const { return read_; }
+
+    // Only call from thread.
+    void operator()() {
+      try {
+        std::vector<char> buffer(1 << 20);
+        std::size_t got;
+        while ((got = in_.Read(&buffer[0], buffer.size()))) {
+          util::WriteOrThrow(write_.get(), &buffer[0], got);
+        }
+      } catch (const util::ErrnoException &e) {
+        if (e.Error() != EPIPE) {
+          std::cerr << "Decompression threw " << e.what() << std::endl;
+          abort();
+        }
+      } catch (const std::exception &e) {
+        std::cerr << "Decompression threw " << e.what() << std::endl;
+        abort();
+      }
+      write_.reset();
+    }
+
+  private:
+    util::ReadCompressed in_;
+    int read_;
+    util::scoped_fd write_;
+    boost::scoped_ptr<boost::thread> thread_;
+};
+
+bool IsCompressed(int fd) {
+  if (util::SizeFile(fd) == util::kBadSize || util::SizeFile(fd) < util::ReadCompressed::kMagicSize) return false;
+  char magic[util::ReadCompressed::kMagicSize];
+  util::ErsatzPRead(fd, magic, sizeof(magic), 0);
+  return util::ReadCompressed::DetectCompressedMagic(magic);
+}
+#endif
+
 template <class Format, class Filter, class OutputBuffer, class Output> void RunThreadedFilter(const Config &config, util::FilePiece &in_lm, Filter &filter, Output &output) {
 #ifndef NTHREAD
   if (config.threads == 1) {
@@ -90,7 +182,7 @@ template <class Format, class Filter, class OutputBuffer, class Output> void Run
 #ifndef NTHREAD
   } else {
     typedef Controller<Filter, OutputBuffer, Output> Threaded;
-    Threaded threading(config.batch_size, config.threads * 2, config.threads, filter, output);
+    Threaded threading(config.batch_size, config.threads * 2, config.threads, filter, output, OutputThreads<OutputBuffer>(config));
     Format::RunFilter(in_lm, threading, output);
   }
 #endif
@@ -110,6 +202,35 @@ template <class Format, class Binary> void DispatchBinaryFilter(const Config &co
   RunContextFilter<Format, Filter, BinaryOutputBuffer, typename Format::Output>(config, in_lm, Filter(binary), out);
 }
 
+// Filter to each vocabulary file listed in config.vocabs.
+template <class Format> void DispatchVocabs(const Config &config, util::FilePiece &in_lm, const char *out_name) {
+  std::ifstream list(config.vocabs, std::ios::in);
+  UTIL_THROW_IF(!list, util::ErrnoException, "Failed to open " << config.vocabs);
+  vocab::Grouped::Words words;
+  // Output of each sentence.
+  std::vector<unsigned int> groups;
+  std::vector<std::string> names;
+  std::string line;
+  while (std::getline(list, line)) {
+    std::string::size_type space = line.find(' ');
+    std::string file(line, 0, space);
+    if (file.empty()) continue;
+    unsigned int index = names.size();
+    names.push_back(space == std::string::npos ? std::string(out_name) + boost::lexical_cast<std::string>(index) : line.substr(space + 1));
+    std::ifstream in(file.c_str(), std::ios::in);
+    UTIL_THROW_IF(!in, util::ErrnoException, "Failed to open " << file);
+    if (config.mode == MODE_SINGLE) {
+      vocab::ReadSet(in, words, index);
+      groups.push_back(index);
+    } else {
+      groups.resize(groups.size() + vocab::ReadMultiple(in, words, groups.size()), index);
+    }
+  }
+  UTIL_THROW_IF(names.empty(), util::Exception, "No vocabulary files listed in " << config.vocabs);
+  typename Format::Multiple out(names);
+  RunContextFilter<Format, vocab::Grouped, MultipleOutputBuffer, typename Format::Multiple>(config, in_lm, vocab::Grouped(words, groups), out);
+}
+
 template <class Format> void DispatchFilterModes(const Config &config, std::istream &in_vocab, util::FilePiece &in_lm, const char *out_name) {
   if (config.mode == MODE_MULTIPLE) {
     if (config.phrase) {
@@ -198,7 +319,15 @@ int main(int argc, char *argv[]) {
           std::cerr << "Batch size must be at least one and should probably be >= 5000" << std::endl;
           if (!config.batch_size) return 1;
         }
+      } else if (!std::strncmp(str, "output_threads:", 15)) {
+        config.output_threads = boost::lexical_cast<size_t>(str + 15);
+        if (!config.output_threads) {
+          std::cerr << "Specify at least one output thread." << std::endl;
+          return 1;
+        }
 #endif
+      } else if (!std::strncmp(str, "vocabs:", 7)) {
+        config.vocabs = str + 7;
       } else {
         lm::DisplayHelp(argv[0]);
         return 1;
@@ -215,6 +344,16 @@ int main(int argc, char *argv[]) {
       return 1;
     }
 
+    if (config.vocabs && config.mode != lm::MODE_SINGLE && config.mode != lm::MODE_UNION) {
+      std::cerr << "vocabs: works with single or union mode." << std::endl;
+      return 1;
+    }
+
+    if (config.vocabs && config.phrase) {
+      std::cerr << "vocabs: does not support the phrase constraint." << std::endl;
+      return 1;
+    }
+
     bool cmd_is_model = true;
     const char *cmd_input = argv[argc - 2];
     if (!strncmp(cmd_input, "vocab:", 6)) {
@@ -228,6 +367,10 @@ int main(int argc, char *argv[]) {
     } else {
       std::cerr << "Assuming that " << cmd_input << " is a model file" << std::endl;
     }
+    if (config.vocabs && !cmd_is_model) {
+      std::cerr << "With vocabs:, the input file is the model." << std::endl;
+      return 1;
+    }
     std::ifstream cmd_file;
     std::istream *vocab;
     if (cmd_is_model) {
@@ -238,7 +381,25 @@ int main(int argc, char *argv[]) {
       vocab = &cmd_file;
     }
 
-    util::FilePiece model(cmd_is_model ? util::OpenReadOrThrow(cmd_input) : 0, cmd_is_model ? cmd_input : NULL, &std::cerr);
+    int model_fd = cmd_is_model ? util::OpenReadOrThrow(cmd_input) : 0;
+#ifndef NTHREAD
+    // Declared before the model so that it is joined after the model closes the pipe.
+    boost::scoped_ptr<lm::DecompressThread> decompress;
+    if (cmd_is_model && config.threads > 1 && lm::IsCompressed(model_fd)) {
+      decompress.reset(new lm::DecompressThread(model_fd));
+      model_fd = decompress->Output();
+    }
+#endif
+    util::FilePiece model(model_fd, cmd_is_model ? cmd_input : NULL, &std::cerr);
+
+    if (config.vocabs) {
+      if (config.format == lm::FORMAT_ARPA) {
+        lm::DispatchVocabs<lm::ARPAFormat>(config, model, argv[argc - 1]);
+      } else if (config.format == lm::FORMAT_COUNT) {
+        lm::DispatchVocabs<lm::CountFormat>(config, model, argv[argc - 1]);
+      }
+      return 0;
+    }
 
     if (config.format == lm::FORMAT_ARPA) {
       lm::DispatchFilterModes<lm::ARPAFormat>(config, *vocab, model, argv[argc - 1]);
@@ -8,6 +8,8 @@
 #include <boost/ptr_container/ptr_vector.hpp>
 
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 namespace lm {
 
@@ -27,6 +29,15 @@ template <class Single> class MultipleOutput {
       }
     }
 
+    explicit MultipleOutput(const std::vector<std::string> &names) {
+      files_.reserve(names.size());
+      for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i) {
+        files_.push_back(new Single(i->c_str()));
+      }
+    }
+
+    size_t Size() const { return files_.size(); }
+
     void AddNGram(const StringPiece &line) {
       for (SinglesIterator i = files_.begin(); i != files_.end(); ++i)
         i->AddNGram(line);
@@ -53,6 +64,8 @@ class MultipleARPAOutput : public MultipleOutput<ARPAOutput> {
   public:
     MultipleARPAOutput(const char *prefix, size_t number) : MultipleOutput<ARPAOutput>(prefix, number) {}
 
+    explicit MultipleARPAOutput(const std::vector<std::string> &names) : MultipleOutput<ARPAOutput>(names) {}
+
     void ReserveForCounts(std::streampos reserve) {
       for (boost::ptr_vector<ARPAOutput>::iterator i = files_.begin(); i != files_.end(); ++i)
         i->ReserveForCounts(reserve);
@@ -135,6 +148,9 @@ struct CountFormat {
 /* For multithreading, the buffer classes hold batches of filter inputs and
  * outputs in memory.  The strings get reused a lot, so keep them around
  * instead of clearing each time.
+ *
+ * Output buffers can also be flushed in parts by several threads, part of
+ * parts writing its share of the output files, then cleared.
  */
 class InputBuffer {
   public:
@@ -185,12 +201,20 @@ class BinaryOutputBuffer {
     }
 
     template <class Output> void Flush(Output &output) {
+      Flush(output, 0, 1);
+      Clear();
+    }
+
+    // There is only one output file, which goes to part 0.
+    template <class Output> void Flush(Output &output, size_t part, size_t /*parts*/) const {
+      if (part) return;
       for (std::vector<StringPiece>::const_iterator i = lines_.begin(); i != lines_.end(); ++i) {
         output.AddNGram(*i);
       }
-      lines_.clear();
     }
 
+    void Clear() { lines_.clear(); }
+
   private:
     std::vector<StringPiece> lines_;
 };
@@ -229,9 +253,26 @@ class MultipleOutputBuffer {
           }
         }
       }
-      annotated_.clear();
+      Clear();
     }
 
+    // Write to the output files whose index is part modulo parts.
+    template <class Output> void Flush(Output &output, size_t part, size_t parts) const {
+      for (std::vector<Annotated>::const_iterator i = annotated_.begin(); i != annotated_.end(); ++i) {
+        if (i->systems.empty()) {
+          for (size_t j = part; j < output.Size(); j += parts) {
+            output.SingleAddNGram(j, i->line);
+          }
+        } else {
+          for (std::vector<size_t>::const_iterator j = i->systems.begin(); j != i->systems.end(); ++j) {
+            if (*j % parts == part) output.SingleAddNGram(*j, i->line);
+          }
+        }
+      }
+    }
+
+    void Clear() { annotated_.clear(); }
+
   private:
     struct Annotated {
       // If this is empty, send to all systems.
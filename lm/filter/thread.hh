@@ -3,6 +3,7 @@
 
 #include "util/thread_pool.hh"
 
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/utility/in_place_factory.hpp>
 
 #include <deque>
@@ -40,6 +41,13 @@ template <class OutputBuffer> class ThreadBatch {
       output_.Flush(output);
     }
 
+    // Flush thread part of parts.  Call Clear once all parts are done.
+    template <class RealOutput> void Flush(RealOutput &output, size_t part, size_t parts) const {
+      output_.Flush(output, part, parts);
+    }
+
+    void Clear() { output_.Clear(); }
+
   private:
     InputBuffer input_;
     OutputBuffer output_;
@@ -64,12 +72,39 @@ template <class Batch, class Filter> class FilterWorker {
     util::PCQueue<Request> &done_;
 };
 
-// There should only be one OutputWorker.
+// Writes part of a batch's output files for OutputWorker.
+template <class Batch, class Output> class FlushWorker {
+  public:
+    typedef Batch *Request;
+
+    FlushWorker(Output &output, size_t part, size_t parts, util::Semaphore &finished)
+      : output_(output), part_(part), parts_(parts), finished_(finished) {}
+
+    void operator()(Request request) {
+      request->Flush(output_, part_, parts_);
+      finished_.post();
+    }
+
+  private:
+    Output &output_;
+    const size_t part_, parts_;
+    util::Semaphore &finished_;
+};
+
+// There should only be one OutputWorker.  With more than one writer, the
+// output files are split among writer threads that flush each batch together.
 template <class Batch, class Output> class OutputWorker {
   public:
     typedef Batch *Request;
 
-    OutputWorker(Output &output, util::PCQueue<Request> &done) : output_(output), done_(done), base_sequence_(0) {}
+    OutputWorker(Output &output, util::PCQueue<Request> &done, size_t writers = 1)
+      : output_(output), done_(done), base_sequence_(0), finished_(0) {
+      if (writers > 1) {
+        for (size_t i = 0; i < writers; ++i) {
+          flushers_.push_back(new util::ThreadPool<FlushWorker<Batch, Output> >(1, 1, boost::in_place(boost::ref(output), i, writers, boost::ref(finished_)), NULL));
+        }
+      }
+    }
 
     void operator()(Request request) {
       assert(request->Sequence() >= base_sequence_);
@@ -80,7 +115,7 @@ template <class Batch, class Output> class OutputWorker {
       }
       ordering_[pos] = request;
       while (!ordering_.empty() && ordering_.front()) {
-        ordering_.front()->Flush(output_);
+        Flush(*ordering_.front());
         done_.Produce(ordering_.front());
         ordering_.pop_front();
         ++base_sequence_;
@@ -88,6 +123,20 @@ template <class Batch, class Output> class OutputWorker {
     }
 
   private:
+    void Flush(Batch &batch) {
+      if (flushers_.empty()) {
+        batch.Flush(output_);
+        return;
+      }
+      for (typename Flushers::iterator i = flushers_.begin(); i != flushers_.end(); ++i) {
+        i->Produce(&batch);
+      }
+      for (size_t i = 0; i < flushers_.size(); ++i) {
+        util::WaitSemaphore(finished_);
+      }
+      batch.Clear();
+    }
+
     Output &output_;
 
     util::PCQueue<Request> &done_;
@@ -95,6 +144,11 @@ template <class Batch, class Output> class OutputWorker {
     std::deque<Request> ordering_;
 
     uint64_t base_sequence_;
+
+    // Declared before the flushers, which must be joined first.
+    util::Semaphore finished_;
+    typedef boost::ptr_vector<util::ThreadPool<FlushWorker<Batch, Output> > > Flushers;
+    Flushers flushers_;
 };
 
 template <class Filter, class OutputBuffer, class RealOutput> class Controller : boost::noncopyable {
@@ -102,11 +156,12 @@ template <class Filter, class OutputBuffer, class RealOutput> class Controller :
     typedef ThreadBatch<OutputBuffer> Batch;
 
   public:
-    Controller(size_t batch_size, size_t queue, size_t workers, const Filter &filter, RealOutput &output)
+    // writers threads write the output, each to its share of the files.
+    Controller(size_t batch_size, size_t queue, size_t workers, const Filter &filter, RealOutput &output, size_t writers = 1)
       : batch_size_(batch_size), queue_size_(queue),
         batches_(queue),
         to_read_(queue),
-        output_(queue, 1, boost::in_place(boost::ref(output), boost::ref(to_read_)), NULL),
+        output_(queue, 1, boost::in_place(boost::ref(output), boost::ref(to_read_), writers), NULL),
         filter_(queue, workers, boost::in_place(boost::ref(filter), boost::ref(output_.In())), NULL),
         sequence_(0) {
       for (size_t i = 0; i < queue; ++i) {
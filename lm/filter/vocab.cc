@@ -31,9 +31,9 @@ bool IsLineEnd(std::istream &in) {
 
 // Read space separated words in enter separated lines.  These lines can be
 // very long, so don't read an entire line at a time.
-unsigned int ReadMultiple(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out) {
+unsigned int ReadMultiple(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out, unsigned int first) {
   in.exceptions(std::istream::badbit);
-  unsigned int sentence = 0;
+  unsigned int sentence = first;
   bool used_id = false;
   std::string word;
   while (in >> word) {
@@ -46,7 +46,17 @@ unsigned int ReadMultiple(std::istream &in, boost::unordered_map<std::string, st
       used_id = false;
     }
   }
-  return sentence + used_id;
+  return sentence + used_id - first;
+}
+
+void ReadSet(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out, unsigned int id) {
+  in.exceptions(std::istream::badbit);
+  std::string word;
+  while (in >> word) {
+    std::vector<unsigned int> &posting = out[word];
+    if (posting.empty() || (posting.back() != id))
+      posting.push_back(id);
+  }
 }
 
 } // namespace vocab
@@ -22,7 +22,11 @@ namespace vocab {
 void ReadSingle(std::istream &in, boost::unordered_set<std::string> &out);
 
 // Read one sentence vocabulary per line.  Return the number of sentences.
-unsigned int ReadMultiple(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out);
+// Sentences are numbered from first.
+unsigned int ReadMultiple(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out, unsigned int first = 0);
+
+// Read all words in as the vocabulary numbered id.
+void ReadSet(std::istream &in, boost::unordered_map<std::string, std::vector<unsigned int> > &out, unsigned int id);
 
 /* Is this a special tag like <s> or <UNK>?  This actually includes anything
  * surrounded with < and >, which most tokenizers separate for real words, so
@@ -127,6 +131,69 @@ class Multiple {
     std::vector<boost::iterator_range<const unsigned int*> > sets_;
 };
 
+/* Like Multiple, but sentences are grouped into outputs.  An n-gram goes to
+ * an output if all its words appear in one of the output's sentences.
+ */
+class Grouped {
+  public:
+    typedef boost::unordered_map<std::string, std::vector<unsigned int> > Words;
+
+    // groups[sentence] is the output of each sentence and must not decrease.
+    Grouped(const Words &vocabs, const std::vector<unsigned int> &groups) : vocabs_(vocabs), groups_(groups) {}
+
+  private:
+    // Callback from AllIntersection.  Sentences come in increasing order, so
+    // an output's sentences are adjacent.
+    template <class Output> class Callback {
+      public:
+        Callback(Output &out, const StringPiece &line, const std::vector<unsigned int> &groups)
+          : out_(out), line_(line), groups_(groups), last_(static_cast<unsigned int>(-1)) {}
+
+        void operator()(unsigned int sentence) {
+          unsigned int group = groups_[sentence];
+          if (group == last_) return;
+          last_ = group;
+          out_.SingleAddNGram(group, line_);
+        }
+
+      private:
+        Output &out_;
+        const StringPiece &line_;
+        const std::vector<unsigned int> &groups_;
+        unsigned int last_;
+    };
+
+  public:
+    template <class Iterator, class Output> void AddNGram(const Iterator &begin, const Iterator &end, const StringPiece &line, Output &output) {
+      sets_.clear();
+      for (Iterator i(begin); i != end; ++i) {
+        if (IsTag(*i)) continue;
+        Words::const_iterator found(FindStringPiece(vocabs_, *i));
+        if (vocabs_.end() == found) return;
+        sets_.push_back(boost::iterator_range<const unsigned int*>(&*found->second.begin(), &*found->second.end()));
+      }
+      if (sets_.empty()) {
+        output.AddNGram(line);
+        return;
+      }
+
+      Callback<Output> cb(output, line, groups_);
+      util::AllIntersection(sets_, cb);
+    }
+
+    template <class Output> void AddNGram(const StringPiece &ngram, const StringPiece &line, Output &output) {
+      AddNGram(util::TokenIter<util::SingleCharacter, true>(ngram, ' '), util::TokenIter<util::SingleCharacter, true>::end(), line, output);
+    }
+
+    void Flush() const {}
+
+  private:
+    const Words &vocabs_;
+    const std::vector<unsigned int> &groups_;
+
+    std::vector<boost::iterator_range<const unsigned int*> > sets_;
+};
+
 } // namespace vocab
 } // namespace lm
 
@@ -4,6 +4,9 @@
 #include "util/file_piece.hh"
 #include "util/usage.hh"
 
+#include <cstdlib>
+#include <vector>
+
 #include <stdint.h>
 
 namespace {
@@ -67,53 +70,121 @@ template <class Model, class Width> void QueryFromBytes(const Model &model, int
   std::cout << "RSSMax: " << util::RSSMax() << std::endl;
 }
 
-template <class Model, class Width> void DispatchFunction(const Model &model, bool query) {
-  if (query) {
+// Same queries through FullScoreBatch.  Consecutive words depend on each
+// other's state, so the text is cut at sentence boundaries into batch_size
+// lanes and each batch scores the next word of every lane.
+template <class Model, class Width> void QueryBatchFromBytes(const Model &model, int fd_in, std::size_t batch_size) {
+  std::vector<Width> ids;
+  Width buf[4096];
+  while (std::size_t got = util::ReadOrEOF(fd_in, buf, sizeof(buf))) {
+    UTIL_THROW_IF2(got % sizeof(Width), "File size not a multiple of vocab id size " << sizeof(Width));
+    ids.insert(ids.end(), buf, buf + got / sizeof(Width));
+  }
+  const Width kEOS = model.GetVocabulary().EndSentence();
+
+  // Lanes are [cur, end) ranges of ids.
+  std::vector<std::size_t> cur, end;
+  for (std::size_t lane = 0, from = 0; lane < batch_size && from < ids.size(); ++lane) {
+    std::size_t to = std::max(from + 1, ids.size() * (lane + 1) / batch_size);
+    while (to < ids.size() && ids[to - 1] != kEOS) ++to;
+    cur.push_back(from);
+    end.push_back(to);
+    from = to;
+  }
+  std::vector<lm::ngram::State> in_states(cur.size(), model.BeginSentenceState()), out_states(cur.size());
+  std::vector<lm::WordIndex> words(cur.size());
+  std::vector<lm::FullScoreReturn> ret(cur.size());
+
+  double loaded = util::CPUTime();
+  std::cout << "CPU_to_load: " << loaded << std::endl;
+
+  double total = 0.0;
+  while (!cur.empty()) {
+    const std::size_t active = cur.size();
+    for (std::size_t l = 0; l < active; ++l) {
+      words[l] = ids[cur[l]];
+    }
+    model.FullScoreBatch(&in_states[0], &words[0], active, &out_states[0], &ret[0]);
+    float sum = 0.0;
+    for (std::size_t l = 0; l < active; ++l) {
+      sum += ret[l].prob;
+      in_states[l] = (words[l] == kEOS) ? model.BeginSentenceState() : out_states[l];
+    }
+    total += sum;
+    // Retire finished lanes by moving the last lane into their place.
+    for (std::size_t l = 0; l < cur.size();) {
+      if (++cur[l] != end[l]) {
+        ++l;
+        continue;
+      }
+      cur[l] = cur.back();
+      end[l] = end.back();
+      in_states[l] = in_states[cur.size() - 1];
+      cur.pop_back();
+      end.pop_back();
+    }
+  }
+  double after = util::CPUTime();
+  std::cerr << "Probability sum is " << total << std::endl;
+  std::cout << "Queries: " << ids.size() << std::endl;
+  std::cout << "Batch: " << batch_size << std::endl;
+  std::cout << "CPU_excluding_load: " << (after - loaded) << "\nCPU_per_query: " << ((after - loaded) / static_cast<double>(ids.size())) << std::endl;
+  std::cout << "RSSMax: " << util::RSSMax() << std::endl;
+}
+
+// batch_size 0 converts text to ids, 1 queries one word at a time.
+template <class Model, class Width> void DispatchFunction(const Model &model, std::size_t batch_size) {
+  if (batch_size == 1) {
     QueryFromBytes<Model, Width>(model, 0);
+  } else if (batch_size) {
+    QueryBatchFromBytes<Model, Width>(model, 0, batch_size);
   } else {
     ConvertToBytes<Model, Width>(model, 0);
   }
 }
 
-template <class Model> void DispatchWidth(const char *file, bool query) {
+template <class Model> void DispatchWidth(const char *file, std::size_t batch_size) {
   lm::ngram::Config config;
   config.load_method = util::READ;
   std::cerr << "Using load_method = READ." << std::endl;
   Model model(file, config);
   lm::WordIndex bound = model.GetVocabulary().Bound();
   if (bound <= 256) {
-    DispatchFunction<Model, uint8_t>(model, query);
+    DispatchFunction<Model, uint8_t>(model, batch_size);
   } else if (bound <= 65536) {
-    DispatchFunction<Model, uint16_t>(model, query);
+    DispatchFunction<Model, uint16_t>(model, batch_size);
   } else if (bound <= (1ULL << 32)) {
-    DispatchFunction<Model, uint32_t>(model, query);
+    DispatchFunction<Model, uint32_t>(model, batch_size);
   } else {
-    DispatchFunction<Model, uint64_t>(model, query);
+    DispatchFunction<Model, uint64_t>(model, batch_size);
   }
 }
 
-void Dispatch(const char *file, bool query) {
+void Dispatch(const char *file, std::size_t batch_size) {
   using namespace lm::ngram;
   lm::ngram::ModelType model_type;
   if (lm::ngram::RecognizeBinary(file, model_type)) {
     switch(model_type) {
       case PROBING:
-        DispatchWidth<lm::ngram::ProbingModel>(file, query);
+        DispatchWidth<lm::ngram::ProbingModel>(file, batch_size);
         break;
       case REST_PROBING:
-        DispatchWidth<lm::ngram::RestProbingModel>(file, query);
+        DispatchWidth<lm::ngram::RestProbingModel>(file, batch_size);
         break;
       case TRIE:
-        DispatchWidth<lm::ngram::TrieModel>(file, query);
+        DispatchWidth<lm::ngram::TrieModel>(file, batch_size);
         break;
       case QUANT_TRIE:
-        DispatchWidth<lm::ngram::QuantTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantTrieModel>(file, batch_size);
         break;
       case ARRAY_TRIE:
-        DispatchWidth<lm::ngram::ArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::ArrayTrieModel>(file, batch_size);
         break;
       case QUANT_ARRAY_TRIE:
-        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, batch_size);
+        break;
+      case QUANT_PROBING:
+        DispatchWidth<lm::ngram::QuantProbingModel>(file, batch_size);
         break;
       default:
         UTIL_THROW(util::Exception, "Unrecognized kenlm model type " << model_type);
@@ -126,7 +197,13 @@ void Dispatch(const char *file, bool query) {
 } // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query"))) {
+  std::size_t batch_size = 0;
+  if (argc == 3 && !strcmp(argv[1], "query")) {
+    batch_size = 1;
+  } else if ((argc == 3 || argc == 4) && !strcmp(argv[1], "batch")) {
+    batch_size = (argc == 4) ? std::strtoul(argv[3], NULL, 10) : 64;
+  }
+  if ((argc != 3 || strcmp(argv[1], "vocab")) && !batch_size) {
     std::cerr
       << "Benchmark program for KenLM.  Intended usage:\n"
       << "#Convert text to vocabulary ids offline.  These ids are tied to a model.\n"
@@ -134,9 +211,11 @@ int main(int argc, char *argv[]) {
       << "#Ensure files are in RAM.\n"
       << "cat $text.vocab $model >/dev/null\n"
       << "#Timed query against the model.\n"
-      << argv[0] << " query $model <$text.vocab\n";
+      << argv[0] << " query $model <$text.vocab\n"
+      << "#Timed query scoring $size sentences at a time with prefetching (default 64).\n"
+      << argv[0] << " batch $model [$size] <$text.vocab\n";
     return 1;
   }
-  Dispatch(argv[2], !strcmp(argv[1], "query"));
+  Dispatch(argv[2], batch_size);
   return 0;
 }
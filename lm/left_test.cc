@@ -372,6 +372,9 @@ template <class M> void Everything() {
 BOOST_AUTO_TEST_CASE(ProbingAll) {
   Everything<Model>();
 }
+BOOST_AUTO_TEST_CASE(QuantProbingAll) {
+  Everything<QuantProbingModel>();
+}
 BOOST_AUTO_TEST_CASE(TrieAll) {
   Everything<TrieModel>();
 }
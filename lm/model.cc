@@ -2,6 +2,7 @@
 
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
+#include "lm/ngram_source.hh"
 #include "lm/search_hashed.hh"
 #include "lm/search_trie.hh"
 #include "lm/read_arpa.hh"
@@ -66,6 +67,7 @@ template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::Ge
 
     Config new_config(init_config);
     new_config.probing_multiplier = parameters.fixed.probing_multiplier;
+    new_config.bloom_bits = parameters.fixed.bloom_bits;
     Search::UpdateConfigFromBinary(backing_, parameters.counts, VocabularyT::Size(parameters.counts[0], new_config), new_config);
     UTIL_THROW_IF(new_config.enumerate_vocab && !parameters.fixed.has_vocabulary, FormatLoadException, "The decoder requested all the vocabulary strings, but this binary file does not have them.  You may need to rebuild the binary file with an updated version of build_binary.");
 
@@ -75,7 +77,15 @@ template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::Ge
     ComplainAboutARPA(init_config, kModelType);
     InitializeFromARPA(fd.release(), file, init_config);
   }
+  InitializeStates();
+}
+
+template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::GenericModel(NGramSource &source, const Config &config) : backing_(config) {
+  InitializeFromSource(source, NULL, config);
+  InitializeStates();
+}
 
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::InitializeStates() {
   // g++ prints warnings unless these are fully initialized.
   State begin_sentence = State();
   begin_sentence.length = 1;
@@ -92,6 +102,10 @@ template <class Search, class VocabularyT> GenericModel<Search, VocabularyT>::Ge
 template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::InitializeFromARPA(int fd, const char *file, const Config &config) {
   // Backing file is the ARPA.
   util::FilePiece f(fd, file, config.ProgressMessages());
+  InitializeFromSource(f, file, config);
+}
+
+template <class Search, class VocabularyT> template <class Source> void GenericModel<Search, VocabularyT>::InitializeFromSource(Source &f, const char *file, const Config &config) {
   try {
     std::vector<uint64_t> counts;
     // File counts do not include pruned trigrams that extend to quadgrams etc.   These will be fixed by search_.
@@ -139,6 +153,23 @@ template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search,
   return ret;
 }
 
+namespace {
+// How many queries ahead of scoring FullScoreBatch prefetches.  Enough to cover
+// memory latency without evicting entries before they are used.
+const std::size_t kBatchPrefetchDistance = 16;
+} // namespace
+
+template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT>::FullScoreBatch(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const {
+  const std::size_t ahead = std::min(count, kBatchPrefetchDistance);
+  for (std::size_t i = 0; i < ahead; ++i) {
+    Prefetch(in_states[i], new_words[i]);
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i + ahead < count) Prefetch(in_states[i + ahead], new_words[i + ahead]);
+    ret[i] = FullScore(in_states[i], new_words[i], out_states[i]);
+  }
+}
+
 template <class Search, class VocabularyT> FullScoreReturn GenericModel<Search, VocabularyT>::FullScoreForgotState(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word, State &out_state) const {
   context_rend = std::min(context_rend, context_rbegin + P::Order() - 1);
   FullScoreReturn ret = ScoreExceptBackoff(context_rbegin, context_rend, new_word, out_state);
@@ -318,6 +349,7 @@ template <class Search, class VocabularyT> float GenericModel<Search, Vocabulary
 
 template class GenericModel<HashedSearch<BackoffValue>, ProbingVocabulary>;
 template class GenericModel<HashedSearch<RestValue>, ProbingVocabulary>;
+template class GenericModel<QuantHashedSearch, ProbingVocabulary>;
 template class GenericModel<trie::TrieSearch<DontQuantize, trie::DontBhiksha>, SortedVocabulary>;
 template class GenericModel<trie::TrieSearch<DontQuantize, trie::ArrayBhiksha>, SortedVocabulary>;
 template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::DontBhiksha>, SortedVocabulary>;
@@ -332,6 +364,8 @@ base::Model *LoadVirtual(const char *file_name, const Config &config, ModelType
       return new ProbingModel(file_name, config);
     case REST_PROBING:
       return new RestProbingModel(file_name, config);
+    case QUANT_PROBING:
+      return new QuantProbingModel(file_name, config);
     case TRIE:
       return new TrieModel(file_name, config);
     case QUANT_TRIE:
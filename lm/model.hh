@@ -22,6 +22,7 @@
 namespace util { class FilePiece; }
 
 namespace lm {
+class NGramSource;
 namespace ngram {
 namespace detail {
 
@@ -50,6 +51,12 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     explicit GenericModel(const char *file, const Config &config = Config());
 
+    /* Build the model from n-grams that are already in memory or in a
+     * stream, e.g. from lmplz, instead of parsing an ARPA file.  Set
+     * config.write_mmap to save it as a binary file at the same time.
+     */
+    explicit GenericModel(NGramSource &source, const Config &config = Config());
+
     /* Score p(new_word | in_state) and incorporate new_word into out_state.
      * Note that in_state and out_state must be different references:
      * &in_state != &out_state.
@@ -65,6 +72,28 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     FullScoreReturn FullScoreForgotState(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word, State &out_state) const;
 
+    /* Hint that p(new_word | in_state) will be queried soon.  This issues
+     * prefetches for the table entries FullScore will probe and returns
+     * immediately, so callers can overlap the memory latency of many queries
+     * by prefetching a batch before scoring it.
+     */
+    void Prefetch(const State &in_state, const WordIndex new_word) const {
+      search_.Prefetch(in_state.words, in_state.words + in_state.length, new_word);
+    }
+
+    // Same as above with the context as a reversed array like FullScoreForgotState.
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word) const {
+      search_.Prefetch(context_rbegin, context_rend, new_word);
+    }
+
+    /* Score count independent queries: ret[i] = p(new_words[i] | in_states[i])
+     * with the new state in out_states[i].  Prefetches for later queries are
+     * issued while earlier ones are scored, so the cache misses of the batch
+     * overlap instead of being paid one at a time.  Results are the same as
+     * calling FullScore on each query.  out_states must not overlap in_states.
+     */
+    void FullScoreBatch(const State *in_states, const WordIndex *new_words, std::size_t count, State *out_states, FullScoreReturn *ret) const;
+
     /* Get the state for a context.  Don't use this if you can avoid it.  Use
      * BeginSentenceState or NullContextState and extend from those.  If
      * you're only going to use this state to call FullScore once, use
@@ -113,6 +142,12 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
 
     void InitializeFromARPA(int fd, const char *file, const Config &config);
 
+    // Source is util::FilePiece or NGramSource.
+    template <class Source> void InitializeFromSource(Source &f, const char *file, const Config &config);
+
+    // Compute the begin sentence and null context states once loaded.
+    void InitializeStates();
+
     float InternalUnRest(const uint64_t *pointers_begin, const uint64_t *pointers_end, unsigned char first_length) const;
 
     BinaryFormat backing_;
@@ -131,10 +166,12 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
 class name : public from {\
   public:\
     name(const char *file, const Config &config = Config()) : from(file, config) {}\
+    name(NGramSource &source, const Config &config = Config()) : from(source, config) {}\
 };
 
 LM_NAME_MODEL(ProbingModel, detail::GenericModel<detail::HashedSearch<BackoffValue> LM_COMMA() ProbingVocabulary>);
 LM_NAME_MODEL(RestProbingModel, detail::GenericModel<detail::HashedSearch<RestValue> LM_COMMA() ProbingVocabulary>);
+LM_NAME_MODEL(QuantProbingModel, detail::GenericModel<detail::QuantHashedSearch LM_COMMA() ProbingVocabulary>);
 LM_NAME_MODEL(TrieModel, detail::GenericModel<trie::TrieSearch<DontQuantize LM_COMMA() trie::DontBhiksha> LM_COMMA() SortedVocabulary>);
 LM_NAME_MODEL(ArrayTrieModel, detail::GenericModel<trie::TrieSearch<DontQuantize LM_COMMA() trie::ArrayBhiksha> LM_COMMA() SortedVocabulary>);
 LM_NAME_MODEL(QuantTrieModel, detail::GenericModel<trie::TrieSearch<SeparatelyQuantize LM_COMMA() trie::DontBhiksha> LM_COMMA() SortedVocabulary>);
@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #define BOOST_TEST_MODULE ModelTest
 #include <boost/test/unit_test.hpp>
@@ -49,6 +50,7 @@ template <class Model> State GetState(const Model &model, const char *word, cons
 }
 
 #define StartTest(word, ngram, score, indep_left) \
+  model.Prefetch(state, model.GetVocabulary().Index(word)); \
   ret = model.FullScore( \
       state, \
       model.GetVocabulary().Index(word), \
@@ -278,6 +280,35 @@ template <class M> void Stateless(const M &model) {
   BOOST_CHECK_EQUAL(static_cast<WordIndex>(0), state.words[0]);
 }
 
+// FullScoreBatch should match FullScore, including past the prefetch window.
+template <class M> void Batch(const M &model) {
+  const char *words[] = {"looking", "on", "a", "little", "the", "biarritz", "not_found", "more", ".", "</s>", "loin", ","};
+  const std::size_t kWords = sizeof(words) / sizeof(const char*);
+  std::vector<State> contexts, in;
+  std::vector<WordIndex> indices;
+  State state(model.BeginSentenceState()), out;
+  for (std::size_t i = 0; i < kWords; ++i) {
+    WordIndex index = model.GetVocabulary().Index(words[i]);
+    contexts.push_back(state);
+    // Each word after every context seen so far.
+    for (std::size_t j = 0; j < contexts.size(); ++j) {
+      in.push_back(contexts[j]);
+      indices.push_back(index);
+    }
+    model.FullScore(state, index, out);
+    state = out;
+  }
+  std::vector<State> batch_out(in.size());
+  std::vector<FullScoreReturn> batch_ret(in.size());
+  model.FullScoreBatch(&in[0], &indices[0], in.size(), &batch_out[0], &batch_ret[0]);
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    FullScoreReturn ret = model.FullScore(in[i], indices[i], out);
+    BOOST_CHECK_EQUAL(ret.prob, batch_ret[i].prob);
+    BOOST_CHECK_EQUAL(ret.ngram_length, batch_ret[i].ngram_length);
+    BOOST_CHECK_EQUAL(out, batch_out[i]);
+  }
+}
+
 template <class M> void NoUnkCheck(const M &model) {
   WordIndex unk_index = 0;
   State state;
@@ -294,6 +325,7 @@ template <class M> void Everything(const M &m) {
   MinimalState(m);
   ExtendLeftTest(m);
   Stateless(m);
+  Batch(m);
 }
 
 class ExpectEnumerateVocab : public EnumerateVocab {
@@ -321,11 +353,12 @@ class ExpectEnumerateVocab : public EnumerateVocab {
     std::vector<std::string> seen;
 };
 
-template <class ModelT> void LoadingTest() {
+template <class ModelT> void LoadingTest(uint8_t bloom_bits = 0) {
   Config config;
   config.arpa_complain = Config::NONE;
   config.messages = NULL;
   config.probing_multiplier = 2.0;
+  config.bloom_bits = bloom_bits;
   {
     ExpectEnumerateVocab enumerate;
     config.enumerate_vocab = &enumerate;
@@ -347,6 +380,14 @@ template <class ModelT> void LoadingTest() {
 BOOST_AUTO_TEST_CASE(probing) {
   LoadingTest<Model>();
 }
+BOOST_AUTO_TEST_CASE(bloom_probing) {
+  LoadingTest<Model>(8);
+  // Few enough bits that the filter passes many absent n-grams.
+  LoadingTest<RestProbingModel>(1);
+}
+BOOST_AUTO_TEST_CASE(quant_probing) {
+  LoadingTest<QuantProbingModel>();
+}
 BOOST_AUTO_TEST_CASE(trie) {
   LoadingTest<TrieModel>();
 }
@@ -360,11 +401,12 @@ BOOST_AUTO_TEST_CASE(quant_bhiksha_trie) {
   LoadingTest<QuantArrayTrieModel>();
 }
 
-template <class ModelT> void BinaryTest(Config::WriteMethod write_method) {
+template <class ModelT> void BinaryTest(Config::WriteMethod write_method, uint8_t bloom_bits = 0) {
   Config config;
   config.write_mmap = "test.binary";
   config.messages = NULL;
   config.write_method = write_method;
+  config.bloom_bits = bloom_bits;
   ExpectEnumerateVocab enumerate;
   config.enumerate_vocab = &enumerate;
 
@@ -376,6 +418,8 @@ template <class ModelT> void BinaryTest(Config::WriteMethod write_method) {
   }
 
   config.write_mmap = NULL;
+  // The binary file records whether it has Bloom filters.
+  config.bloom_bits = 0;
 
   ModelType type;
   BOOST_REQUIRE(RecognizeBinary("test.binary", type));
@@ -415,9 +459,16 @@ template <class ModelT> void BinaryTest() {
 BOOST_AUTO_TEST_CASE(write_and_read_probing) {
   BinaryTest<ProbingModel>();
 }
+BOOST_AUTO_TEST_CASE(write_and_read_bloom_probing) {
+  BinaryTest<ProbingModel>(Config::WRITE_MMAP, 8);
+  BinaryTest<ProbingModel>(Config::WRITE_AFTER, 8);
+}
 BOOST_AUTO_TEST_CASE(write_and_read_rest_probing) {
   BinaryTest<RestProbingModel>();
 }
+BOOST_AUTO_TEST_CASE(write_and_read_quant_probing) {
+  BinaryTest<QuantProbingModel>();
+}
 BOOST_AUTO_TEST_CASE(write_and_read_trie) {
   BinaryTest<TrieModel>();
 }
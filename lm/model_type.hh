@@ -6,7 +6,7 @@ namespace ngram {
 
 /* Not the best numbering system, but it grew this way for historical reasons
  * and I want to preserve existing binary files. */
-typedef enum {PROBING=0, REST_PROBING=1, TRIE=2, QUANT_TRIE=3, ARRAY_TRIE=4, QUANT_ARRAY_TRIE=5} ModelType;
+typedef enum {PROBING=0, REST_PROBING=1, TRIE=2, QUANT_TRIE=3, ARRAY_TRIE=4, QUANT_ARRAY_TRIE=5, QUANT_PROBING=6} ModelType;
 
 // Historical names.
 const ModelType HASH_PROBING = PROBING;
@@ -0,0 +1,7 @@
+#include "lm/ngram_source.hh"
+
+namespace lm {
+
+NGramSource::~NGramSource() {}
+
+} // namespace lm
@@ -0,0 +1,134 @@
+#ifndef LM_NGRAM_SOURCE_H
+#define LM_NGRAM_SOURCE_H
+
+#include "lm/blank.hh"
+#include "lm/read_arpa.hh"
+#include "lm/weights.hh"
+#include "lm/word_index.hh"
+#include "util/string_piece.hh"
+
+#include <cstddef>
+#include <vector>
+
+#include <stdint.h>
+
+namespace lm {
+
+/* Supplies the n-grams of a model in place of an ARPA file, so that the
+ * binary formats can be built without printing and parsing text.  Orders are
+ * read in increasing order and, within an order, n-grams come in the order an
+ * ARPA file would list them.  Words are identified by the source's own ids,
+ * which are mapped to the vocabulary being built once the unigrams are in.
+ */
+class NGramSource {
+  public:
+    NGramSource() : read_(0) {}
+
+    virtual ~NGramSource();
+
+    // Number of n-grams of each order, as in the ARPA header.
+    virtual void ReadCounts(std::vector<uint64_t> &counts) = 0;
+
+    // Called before the n-grams of order are read.
+    virtual void BeginOrder(unsigned int order) = 0;
+
+    // Return the words of the next n-gram, oldest first, and its weights.
+    // Backoff is only set by orders that have one.
+    virtual const WordIndex *Next(float &prob, float &backoff) = 0;
+
+    // Text of a word.
+    virtual StringPiece Word(WordIndex id) const = 0;
+
+    // Called once all orders have been read.
+    virtual void End() {}
+
+    // Reported in errors where ARPA reading gives a byte offset.
+    uint64_t Offset() const { return read_; }
+
+    // Map the words of the unigrams just read to ids of vocab.
+    template <class Voc> void MapVocab(const Voc &vocab, const std::vector<WordIndex> &seen) {
+      for (std::vector<WordIndex>::const_iterator i = seen.begin(); i != seen.end(); ++i) {
+        if (*i >= to_vocab_.size()) to_vocab_.resize(*i + 1, 0);
+        to_vocab_[*i] = vocab.Index(Word(*i));
+      }
+    }
+
+    WordIndex ToVocab(WordIndex id) const {
+      UTIL_THROW_IF(id >= to_vocab_.size(), FormatLoadException, "Word " << id << " was not seen in the unigrams (which are supposed to list the entire vocabulary) but appears");
+      return to_vocab_[id];
+    }
+
+  protected:
+    // Implementations count the n-grams they hand out here.
+    uint64_t read_;
+
+  private:
+    std::vector<WordIndex> to_vocab_;
+};
+
+// Overloads of the ARPA readers, so code templated on its input reads either.
+
+inline void ReadARPACounts(NGramSource &in, std::vector<uint64_t> &number) {
+  in.ReadCounts(number);
+}
+
+inline void ReadNGramHeader(NGramSource &in, unsigned int length) {
+  in.BeginOrder(length);
+}
+
+inline void ReadEnd(NGramSource &in) {
+  in.End();
+}
+
+namespace detail {
+// Same conventions as ReadBackoff: zero is stored as kNoExtensionBackoff.
+inline void SetSourceBackoff(Prob &/*weights*/, float backoff) {
+  UTIL_THROW_IF(backoff != 0.0, FormatLoadException, "Non-zero backoff " << backoff << " provided for an n-gram that should have no backoff");
+}
+inline void SetSourceBackoff(float &to, float backoff) {
+  to = (backoff == ngram::kExtensionBackoff) ? ngram::kNoExtensionBackoff : backoff;
+}
+inline void SetSourceBackoff(ProbBackoff &weights, float backoff) {
+  SetSourceBackoff(weights.backoff, backoff);
+}
+inline void SetSourceBackoff(RestWeights &weights, float backoff) {
+  SetSourceBackoff(weights.backoff, backoff);
+}
+} // namespace detail
+
+template <class Voc, class Weights> void Read1Grams(NGramSource &f, std::size_t count, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
+  f.BeginOrder(1);
+  std::vector<WordIndex> seen;
+  seen.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    float prob, backoff = 0.0;
+    const WordIndex *word = f.Next(prob, backoff);
+    if (prob > 0.0) {
+      warn.Warn(prob);
+      prob = 0.0;
+    }
+    Weights &w = unigrams[vocab.Insert(f.Word(*word))];
+    w.prob = prob;
+    detail::SetSourceBackoff(w, backoff);
+    seen.push_back(*word);
+  }
+  vocab.FinishedLoading(unigrams);
+  f.MapVocab(vocab, seen);
+}
+
+template <class Voc, class Weights, class Iterator> void ReadNGram(NGramSource &f, const unsigned char n, const Voc &/*vocab*/, Iterator indices_out, Weights &weights, PositiveProbWarn &warn) {
+  float backoff = 0.0;
+  const WordIndex *words = f.Next(weights.prob, backoff);
+  if (weights.prob > 0.0) {
+    warn.Warn(weights.prob);
+    weights.prob = 0.0;
+  }
+  for (const WordIndex *i = words; i != words + n; ++i, ++indices_out) {
+    *indices_out = f.ToVocab(*i);
+  }
+  detail::SetSourceBackoff(weights, backoff);
+}
+
+} // namespace lm
+
+#endif // LM_NGRAM_SOURCE_H
@@ -93,7 +93,8 @@ class DontQuantize {
 };
 
 class SeparatelyQuantize {
-  private:
+  public:
+    // Centers of the quantization bins for one kind of value.
     class Bins {
       public:
         // Sigh C++ default constructor
@@ -134,7 +135,6 @@ class SeparatelyQuantize {
         uint64_t mask_;
     };
 
-  public:
     static const ModelType kModelTypeAdd = kQuantAdd;
 
     static void UpdateConfigFromBinary(const BinaryFormat &file, uint64_t offset, Config &config);
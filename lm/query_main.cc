@@ -14,7 +14,9 @@ void Usage(const char *name) {
     "-b: Do not buffer output.\n"
     "-n: Do not wrap the input in <s> and </s>.\n"
     "-v summary|sentence|word: Level of verbosity\n"
-    "-l lazy|populate|read|parallel: Load lazily, with populate, or malloc+read\n"
+    "-l lazy|populate|read|parallel|interleave: Load lazily, with populate, or malloc+read\n"
+    "   (read, parallel, and interleave use huge pages where available; interleave\n"
+    "   also spreads the model over NUMA nodes)\n"
     "The default loading method is populate on Linux and read on others.\n";
   exit(1);
 }
@@ -57,6 +59,8 @@ int main(int argc, char *argv[]) {
           config.load_method = util::READ;
         } else if (!strcmp(optarg, "parallel")) {
           config.load_method = util::PARALLEL_READ;
+        } else if (!strcmp(optarg, "interleave")) {
+          config.load_method = util::INTERLEAVE_READ;
         } else {
           Usage(argv[0]);
         }
@@ -93,6 +97,9 @@ int main(int argc, char *argv[]) {
         case QUANT_ARRAY_TRIE:
           Query<QuantArrayTrieModel>(file, config, sentence_context, printer);
           break;
+        case QUANT_PROBING:
+          Query<QuantProbingModel>(file, config, sentence_context, printer);
+          break;
         default:
           std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
           abort();
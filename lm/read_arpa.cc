@@ -146,6 +146,10 @@ void ReadEnd(util::FilePiece &in) {
 }
 
 void PositiveProbWarn::Warn(float prob) {
+  if (!seen_) {
+    seen_ = true;
+    first_ = prob;
+  }
   switch (action_) {
     case THROW_UP:
       UTIL_THROW(FormatLoadException, "Positive log probability " << prob << " in the model.  This is a bug in IRSTLM; you can set config.positive_log_probability = SILENT or pass -i to build_binary to substitute 0.0 for the log probability.  Error");
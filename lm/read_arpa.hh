@@ -31,14 +31,29 @@ extern const bool kARPASpaces[256];
 // Positive log probability warning.
 class PositiveProbWarn {
   public:
-    PositiveProbWarn() : action_(THROW_UP) {}
+    PositiveProbWarn() : action_(THROW_UP), seen_(false) {}
 
-    explicit PositiveProbWarn(WarningAction action) : action_(action) {}
+    explicit PositiveProbWarn(WarningAction action) : action_(action), seen_(false) {}
 
     void Warn(float prob);
 
+    // For parsing part of the file on another thread: throws like this
+    // warner but otherwise only remembers the first positive probability, to
+    // be reported by Merge.
+    PositiveProbWarn Deferred() const {
+      return PositiveProbWarn(action_ == THROW_UP ? THROW_UP : SILENT);
+    }
+
+    // Warn about the first positive probability seen by a Deferred copy.
+    // Merge the copies in file order.
+    void Merge(const PositiveProbWarn &deferred) {
+      if (deferred.seen_) Warn(deferred.first_);
+    }
+
   private:
     WarningAction action_;
+    bool seen_;
+    float first_;
 };
 
 template <class Voc, class Weights> void Read1Gram(util::FilePiece &f, Voc &vocab, Weights *unigrams, PositiveProbWarn &warn) {
@@ -4,13 +4,16 @@
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
 #include "lm/model.hh"
+#include "lm/ngram_source.hh"
 #include "lm/read_arpa.hh"
 #include "lm/value.hh"
 #include "lm/vocab.hh"
 
 #include "util/bit_packing.hh"
 #include "util/file_piece.hh"
+#include "util/mmap.hh"
 
+#include <cmath>
 #include <string>
 
 namespace lm {
@@ -156,8 +159,8 @@ template <class Build> void MarkLower(
   }
 }
 
-template <class Build, class Activate, class Store> void ReadNGrams(
-    util::FilePiece &f,
+template <class Source, class Build, class Activate, class Store> void ReadNGrams(
+    Source &f,
     const unsigned int n,
     const size_t count,
     const ProbingVocabulary &vocab,
@@ -216,9 +219,30 @@ template <class Value> uint8_t *HashedSearch<Value>::SetupMemory(uint8_t *start,
   allocated = Longest::Size(counts.back(), config.probing_multiplier);
   longest_ = Longest(start, allocated);
   start += allocated;
+  middle_bloom_.clear();
+  for (unsigned int n = 2; n < counts.size(); ++n) {
+    allocated = util::BloomFilter::Size(counts[n - 1], config.bloom_bits);
+    middle_bloom_.push_back(util::BloomFilter(start, allocated, config.bloom_bits));
+    start += allocated;
+  }
+  allocated = util::BloomFilter::Size(counts.back(), config.bloom_bits);
+  longest_bloom_ = util::BloomFilter(start, allocated, config.bloom_bits);
+  start += allocated;
   return start;
 }
 
+template <class Value> void HashedSearch<Value>::FillBlooms() {
+  for (std::size_t i = 0; i < middle_.size(); ++i) {
+    // Includes blanks inserted for pruned context.
+    for (typename Middle::ConstIterator e = middle_[i].RawBegin(); e != middle_[i].RawEnd(); ++e) {
+      if (e->key) middle_bloom_[i].Insert(e->key);
+    }
+  }
+  for (typename Longest::ConstIterator e = longest_.RawBegin(); e != longest_.RawEnd(); ++e) {
+    if (e->key) longest_bloom_.Insert(e->key);
+  }
+}
+
 /*template <class Value> void HashedSearch<Value>::Relocate(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config) {
   unigram_ = Unigram(start, counts[0]);
   start += Unigram::Size(counts[0]);
@@ -229,24 +253,28 @@ template <class Value> uint8_t *HashedSearch<Value>::SetupMemory(uint8_t *start,
   longest_.Relocate(start);
 }*/
 
-template <class Value> void HashedSearch<Value>::InitializeFromARPA(const char * /*file*/, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
+template <class Value> template <class Source> void HashedSearch<Value>::InitializeFromARPA(const char * /*file*/, Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
   void *vocab_rebase;
   void *search_base = backing.GrowForSearch(Size(counts, config), vocab.UnkCountChangePadding(), vocab_rebase);
   vocab.Relocate(vocab_rebase);
   SetupMemory(reinterpret_cast<uint8_t*>(search_base), counts, config);
+  Populate(f, counts, config, vocab);
+  if (config.bloom_bits) FillBlooms();
+}
 
+template <class Value> template <class Source> void HashedSearch<Value>::Populate(Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab) {
   PositiveProbWarn warn(config.positive_log_probability);
   Read1Grams(f, counts[0], vocab, unigram_.Raw(), warn);
   CheckSpecials(config, vocab);
   DispatchBuild(f, counts, config, vocab, warn);
 }
 
-template <> void HashedSearch<BackoffValue>::DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
+template <> template <class Source> void HashedSearch<BackoffValue>::DispatchBuild(Source &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
   NoRestBuild build;
   ApplyBuild(f, counts, vocab, warn, build);
 }
 
-template <> void HashedSearch<RestValue>::DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
+template <> template <class Source> void HashedSearch<RestValue>::DispatchBuild(Source &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn) {
   switch (config.rest_function) {
     case Config::REST_MAX:
       {
@@ -263,25 +291,25 @@ template <> void HashedSearch<RestValue>::DispatchBuild(util::FilePiece &f, cons
   }
 }
 
-template <class Value> template <class Build> void HashedSearch<Value>::ApplyBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build) {
+template <class Value> template <class Source, class Build> void HashedSearch<Value>::ApplyBuild(Source &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build) {
   for (WordIndex i = 0; i < counts[0]; ++i) {
     build.SetRest(&i, (unsigned int)1, unigram_.Raw()[i]);
   }
 
   try {
     if (counts.size() > 2) {
-      ReadNGrams<Build, ActivateUnigram<typename Value::Weights>, Middle>(
+      ReadNGrams<Source, Build, ActivateUnigram<typename Value::Weights>, Middle>(
           f, 2, counts[1], vocab, build, unigram_.Raw(), middle_, ActivateUnigram<typename Value::Weights>(unigram_.Raw()), middle_[0], warn);
     }
     for (unsigned int n = 3; n < counts.size(); ++n) {
-      ReadNGrams<Build, ActivateLowerMiddle<Middle>, Middle>(
+      ReadNGrams<Source, Build, ActivateLowerMiddle<Middle>, Middle>(
           f, n, counts[n-1], vocab, build, unigram_.Raw(), middle_, ActivateLowerMiddle<Middle>(middle_[n-3]), middle_[n-2], warn);
     }
     if (counts.size() > 2) {
-      ReadNGrams<Build, ActivateLowerMiddle<Middle>, Longest>(
+      ReadNGrams<Source, Build, ActivateLowerMiddle<Middle>, Longest>(
           f, counts.size(), counts[counts.size() - 1], vocab, build, unigram_.Raw(), middle_, ActivateLowerMiddle<Middle>(middle_.back()), longest_, warn);
     } else {
-      ReadNGrams<Build, ActivateUnigram<typename Value::Weights>, Longest>(
+      ReadNGrams<Source, Build, ActivateUnigram<typename Value::Weights>, Longest>(
           f, counts.size(), counts[counts.size() - 1], vocab, build, unigram_.Raw(), middle_, ActivateUnigram<typename Value::Weights>(unigram_.Raw()), longest_, warn);
     }
   } catch (util::ProbingSizeException &e) {
@@ -290,9 +318,131 @@ template <class Value> template <class Build> void HashedSearch<Value>::ApplyBui
   ReadEnd(f);
 }
 
+uint8_t *QuantHashedSearch::SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config) {
+  UTIL_THROW_IF(config.prob_bits + config.backoff_bits > 31, ConfigException, "Quantized probing stores at most 31 bits of weights per entry so that the rest can hold the hash.  Currently you have requested " << static_cast<unsigned>(config.prob_bits) << " probability and " << static_cast<unsigned>(config.backoff_bits) << " backoff bits.");
+  quant_.SetupMemory(start, counts.size(), config);
+  start += SeparatelyQuantize::Size(counts.size(), config);
+  unigram_ = reinterpret_cast<ProbBackoff*>(start);
+  start += (counts[0] + 1) * sizeof(ProbBackoff);
+  // One more bit in middle entries records whether the n-gram is independent of words to its left.
+  middle_shift_ = config.prob_bits + config.backoff_bits + 1;
+  longest_shift_ = config.prob_bits;
+  std::size_t allocated;
+  middle_.clear();
+  for (unsigned int n = 2; n < counts.size(); ++n) {
+    allocated = Table::Size(counts[n - 1], config.probing_multiplier);
+    middle_.push_back(Table(start, allocated, 0, ShiftedHash(middle_shift_), ShiftedEqual(middle_shift_)));
+    start += allocated;
+  }
+  allocated = Table::Size(counts.back(), config.probing_multiplier);
+  longest_ = Table(start, allocated, 0, ShiftedHash(longest_shift_), ShiftedEqual(longest_shift_));
+  start += allocated;
+  return start;
+}
+
+template <class Source> void QuantHashedSearch::InitializeFromARPA(const char * /*file*/, Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing) {
+  void *vocab_rebase;
+  void *search_base = backing.GrowForSearch(Size(counts, config), vocab.UnkCountChangePadding(), vocab_rebase);
+  vocab.Relocate(vocab_rebase);
+  SetupMemory(reinterpret_cast<uint8_t*>(search_base), counts, config);
+
+  // The bins can only be trained once every weight is known, so build the
+  // usual tables in memory first.
+  HashedSearch<BackoffValue> unpacked;
+  util::scoped_memory unpacked_memory;
+  util::HugeMalloc(HashedSearch<BackoffValue>::Size(counts, config), true, unpacked_memory);
+  unpacked.SetupMemory(reinterpret_cast<uint8_t*>(unpacked_memory.get()), counts, config);
+  unpacked.Populate(f, counts, config, vocab);
+  Pack(unpacked, counts, config);
+}
+
+namespace {
+// Weights of a probing entry with the independent left flag removed.
+float EntryProb(float prob) {
+  util::FloatEnc enc;
+  enc.f = prob;
+  enc.i |= util::kSignBit;
+  return enc.f;
+}
+} // namespace
+
+void QuantHashedSearch::Pack(const HashedSearch<BackoffValue> &unpacked, const std::vector<uint64_t> &counts, const Config &config) {
+  typedef HashedSearch<BackoffValue>::Middle UnpackedMiddle;
+  typedef HashedSearch<BackoffValue>::Longest UnpackedLongest;
+  const ProbBackoff *unigrams = &unpacked.unigram_.Lookup(0);
+  std::copy(unigrams, unigrams + counts[0] + 1, unigram_);
+
+  std::vector<float> probs, backoffs;
+  for (std::size_t i = 0; i < middle_.size(); ++i) {
+    probs.clear();
+    backoffs.clear();
+    const UnpackedMiddle &from = unpacked.middle_[i];
+    for (UnpackedMiddle::ConstIterator e = from.RawBegin(); e != from.RawEnd(); ++e) {
+      if (!e->key) continue;
+      probs.push_back(EntryProb(e->value.prob));
+      if (e->value.backoff != 0.0) backoffs.push_back(e->value.backoff);
+    }
+    quant_.Train(i + 2, probs, backoffs);
+  }
+  probs.clear();
+  for (UnpackedLongest::ConstIterator e = unpacked.longest_.RawBegin(); e != unpacked.longest_.RawEnd(); ++e) {
+    if (e->key) probs.push_back(EntryProb(e->value.prob));
+  }
+  quant_.TrainProb(counts.size(), probs);
+  quant_.FinishedLoading(config);
+
+  // The truncated hashes of two n-grams can be equal, and a truncated hash of
+  // zero reads as an empty bucket.  Such n-grams are left out and counted.
+  uint64_t collisions = 0, zero = 0;
+  Table::ConstIterator found;
+  PackedEntry entry;
+  for (std::size_t i = 0; i < middle_.size(); ++i) {
+    const SeparatelyQuantize::Bins &prob_bins = quant_.GetTables(i)[0];
+    const SeparatelyQuantize::Bins &backoff_bins = quant_.GetTables(i)[1];
+    const UnpackedMiddle &from = unpacked.middle_[i];
+    for (UnpackedMiddle::ConstIterator e = from.RawBegin(); e != from.RawEnd(); ++e) {
+      if (!e->key) continue;
+      entry.packed = (e->key << middle_shift_)
+        | (static_cast<uint64_t>(BackoffValue::ProbingProxy(e->value).IndependentLeft()) << (middle_shift_ - 1))
+        | (prob_bins.EncodeProb(EntryProb(e->value.prob)) << backoff_bins.Bits())
+        | backoff_bins.EncodeBackoff(e->value.backoff);
+      if (!(entry.packed >> middle_shift_)) {
+        ++zero;
+      } else if (middle_[i].Find(entry.packed, found)) {
+        ++collisions;
+      } else {
+        middle_[i].Insert(entry);
+      }
+    }
+  }
+  const SeparatelyQuantize::Bins &longest_bins = quant_.LongestTable();
+  for (UnpackedLongest::ConstIterator e = unpacked.longest_.RawBegin(); e != unpacked.longest_.RawEnd(); ++e) {
+    if (!e->key) continue;
+    entry.packed = (e->key << longest_shift_) | longest_bins.EncodeProb(EntryProb(e->value.prob));
+    if (!(entry.packed >> longest_shift_)) {
+      ++zero;
+    } else if (longest_.Find(entry.packed, found)) {
+      ++collisions;
+    } else {
+      longest_.Insert(entry);
+    }
+  }
+  if ((collisions || zero) && config.messages) {
+    *config.messages << "Quantized probing: " << collisions << " n-grams have the same truncated hash as another n-gram and take its weights, and "
+      << zero << " n-grams truncate to the empty key and are missing.  Quantize with fewer bits (-q, -b) to keep more hash bits." << std::endl;
+  }
+}
+
 template class HashedSearch<BackoffValue>;
 template class HashedSearch<RestValue>;
 
+template void HashedSearch<BackoffValue>::InitializeFromARPA(const char *, util::FilePiece &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+template void HashedSearch<BackoffValue>::InitializeFromARPA(const char *, NGramSource &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+template void HashedSearch<RestValue>::InitializeFromARPA(const char *, util::FilePiece &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+template void HashedSearch<RestValue>::InitializeFromARPA(const char *, NGramSource &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+template void QuantHashedSearch::InitializeFromARPA(const char *, util::FilePiece &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+template void QuantHashedSearch::InitializeFromARPA(const char *, NGramSource &, const std::vector<uint64_t> &, const Config &, ProbingVocabulary &, BinaryFormat &);
+
 } // namespace detail
 } // namespace ngram
 } // namespace lm
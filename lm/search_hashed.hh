@@ -3,11 +3,14 @@
 
 #include "lm/model_type.hh"
 #include "lm/config.hh"
+#include "lm/quantize.hh"
 #include "lm/read_arpa.hh"
 #include "lm/return.hh"
+#include "lm/value.hh"
 #include "lm/weights.hh"
 
 #include "util/bit_packing.hh"
+#include "util/bloom_filter.hh"
 #include "util/probing_hash_table.hh"
 
 #include <algorithm>
@@ -79,12 +82,21 @@ template <class Value> class HashedSearch {
       for (unsigned char n = 1; n < counts.size() - 1; ++n) {
         ret += Middle::Size(counts[n], config.probing_multiplier);
       }
-      return ret + Longest::Size(counts.back(), config.probing_multiplier);
+      ret += Longest::Size(counts.back(), config.probing_multiplier);
+      // Bloom filters follow the tables.
+      for (unsigned char n = 1; n < counts.size(); ++n) {
+        ret += util::BloomFilter::Size(counts[n], config.bloom_bits);
+      }
+      return ret;
     }
 
     uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
 
-    void InitializeFromARPA(const char *file, util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+    // Source is util::FilePiece for ARPA files or NGramSource.
+    template <class Source> void InitializeFromARPA(const char *file, Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+
+    // Read the n-grams into memory that SetupMemory was already given.
+    template <class Source> void Populate(Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab);
 
     unsigned char Order() const {
       return middle_.size() + 2;
@@ -108,7 +120,7 @@ template <class Value> class HashedSearch {
     MiddlePointer LookupMiddle(unsigned char order_minus_2, WordIndex word, Node &node, bool &independent_left, uint64_t &extend_pointer) const {
       node = CombineWordHash(node, word);
       typename Middle::ConstIterator found;
-      if (!middle_[order_minus_2].Find(node, found)) {
+      if (!MayContain(middle_bloom_[order_minus_2], node) || !middle_[order_minus_2].Find(node, found)) {
         independent_left = true;
         return MiddlePointer();
       }
@@ -121,10 +133,33 @@ template <class Value> class HashedSearch {
     LongestPointer LookupLongest(WordIndex word, const Node &node) const {
       // Sign bit is always on because longest n-grams do not extend left.
       typename Longest::ConstIterator found;
-      if (!longest_.Find(CombineWordHash(node, word), found)) return LongestPointer();
+      const uint64_t key = CombineWordHash(node, word);
+      if (!MayContain(longest_bloom_, key) || !longest_.Find(key, found)) return LongestPointer();
       return LongestPointer(found->value.prob);
     }
 
+    // Touch the entries that scoring word after the reversed context
+    // [context_rbegin, context_rend) will probe.  The keys do not depend on
+    // the outcome of earlier lookups, so all orders can be fetched at once.
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, WordIndex word) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(&unigram_.Lookup(word));
+#endif
+      Node node = static_cast<Node>(word);
+      const WordIndex *i = context_rbegin;
+      for (unsigned char order_minus_2 = 0; order_minus_2 < middle_.size(); ++order_minus_2, ++i) {
+        if (i >= context_rend) return;
+        node = CombineWordHash(node, *i);
+        if (middle_bloom_[order_minus_2].Active()) middle_bloom_[order_minus_2].Prefetch(node);
+        middle_[order_minus_2].Prefetch(node);
+      }
+      if (i < context_rend) {
+        node = CombineWordHash(node, *i);
+        if (longest_bloom_.Active()) longest_bloom_.Prefetch(node);
+        longest_.Prefetch(node);
+      }
+    }
+
     // Generate a node without necessarily checking that it actually exists.
     // Optionally return false if it's know to not exist.
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
@@ -137,10 +172,20 @@ template <class Value> class HashedSearch {
     }
 
   private:
+    // Quantizes the tables built here.
+    friend class QuantHashedSearch;
+
+    static bool MayContain(const util::BloomFilter &bloom, uint64_t key) {
+      return !bloom.Active() || bloom.MayContain(key);
+    }
+
+    // Add the keys in the tables to the Bloom filters.
+    void FillBlooms();
+
     // Interpret config's rest cost build policy and pass the right template argument to ApplyBuild.
-    void DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn);
+    template <class Source> void DispatchBuild(Source &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn);
 
-    template <class Build> void ApplyBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build);
+    template <class Source, class Build> void ApplyBuild(Source &f, const std::vector<uint64_t> &counts, const ProbingVocabulary &vocab, PositiveProbWarn &warn, const Build &build);
 
     class Unigram {
       public:
@@ -183,6 +228,200 @@ template <class Value> class HashedSearch {
 
     typedef util::ProbingHashTable<ProbEntry, util::IdentityHash> Longest;
     Longest longest_;
+
+    // Inactive unless config.bloom_bits is set.
+    std::vector<util::BloomFilter> middle_bloom_;
+    util::BloomFilter longest_bloom_;
+};
+
+/* Probing hash tables with quantized weights.  An entry of the middle or
+ * longest tables is a single 64-bit word: the quantized weights are packed in
+ * the low bits and the n-gram's hash, truncated to the bits left over, is
+ * stored above them.  Keys are therefore passed to the tables shifted left by
+ * the number of value bits.  Unigrams are not quantized.
+ *
+ * Truncating hashes makes collisions likely for large models: n n-grams in
+ * an order with h hash bits give about n^2 / 2^(h+1) colliding pairs, e.g. a
+ * million with 1e8 n-grams and 32 bits.  The second n-gram of a pair is left
+ * out and queries for it return the first one's weights.  An n-gram whose
+ * truncated hash is zero would look like an empty bucket, so it is left out
+ * as well.  Building counts both and reports them to config.messages.
+ */
+class QuantHashedSearch {
+  public:
+    typedef uint64_t Node;
+
+    typedef BackoffValue::ProbingProxy UnigramPointer;
+
+    class MiddlePointer {
+      public:
+        MiddlePointer(const SeparatelyQuantize &quant, unsigned char order_minus_2, uint64_t packed)
+          : bins_(quant.GetTables(order_minus_2)), packed_(packed) {}
+
+        MiddlePointer() : bins_(NULL), packed_(0) {}
+
+        bool Found() const { return bins_ != NULL; }
+
+        float Prob() const {
+          return ProbBins().Decode((packed_ >> BackoffBins().Bits()) & ProbBins().Mask());
+        }
+
+        float Backoff() const {
+          return BackoffBins().Decode(packed_ & BackoffBins().Mask());
+        }
+
+        float Rest() const { return Prob(); }
+
+        // The flag bit is above the weights.
+        bool IndependentLeft() const {
+          return (packed_ >> (ProbBins().Bits() + BackoffBins().Bits())) & 1;
+        }
+
+      private:
+        const SeparatelyQuantize::Bins &ProbBins() const { return bins_[0]; }
+        const SeparatelyQuantize::Bins &BackoffBins() const { return bins_[1]; }
+
+        const SeparatelyQuantize::Bins *bins_;
+        uint64_t packed_;
+    };
+
+    class LongestPointer {
+      public:
+        LongestPointer(const SeparatelyQuantize &quant, uint64_t packed) : table_(&quant.LongestTable()), packed_(packed) {}
+
+        LongestPointer() : table_(NULL), packed_(0) {}
+
+        bool Found() const { return table_ != NULL; }
+
+        float Prob() const {
+          return table_->Decode(packed_ & table_->Mask());
+        }
+
+      private:
+        const SeparatelyQuantize::Bins *table_;
+        uint64_t packed_;
+    };
+
+    static const ModelType kModelType = QUANT_PROBING;
+    static const bool kDifferentRest = false;
+    static const unsigned int kVersion = 0;
+
+    static void UpdateConfigFromBinary(const BinaryFormat &file, const std::vector<uint64_t> &/*counts*/, uint64_t offset, Config &config) {
+      SeparatelyQuantize::UpdateConfigFromBinary(file, offset, config);
+    }
+
+    static uint64_t Size(const std::vector<uint64_t> &counts, const Config &config) {
+      uint64_t ret = SeparatelyQuantize::Size(counts.size(), config) + (counts[0] + 1) * sizeof(ProbBackoff);
+      for (unsigned char n = 1; n < counts.size() - 1; ++n) {
+        ret += Table::Size(counts[n], config.probing_multiplier);
+      }
+      return ret + Table::Size(counts.back(), config.probing_multiplier);
+    }
+
+    uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
+
+    // Source is util::FilePiece for ARPA files or NGramSource.
+    template <class Source> void InitializeFromARPA(const char *file, Source &f, const std::vector<uint64_t> &counts, const Config &config, ProbingVocabulary &vocab, BinaryFormat &backing);
+
+    unsigned char Order() const {
+      return middle_.size() + 2;
+    }
+
+    ProbBackoff &UnknownUnigram() { return unigram_[0]; }
+
+    UnigramPointer LookupUnigram(WordIndex word, Node &next, bool &independent_left, uint64_t &extend_left) const {
+      extend_left = static_cast<uint64_t>(word);
+      next = extend_left;
+      UnigramPointer ret(unigram_[word]);
+      independent_left = ret.IndependentLeft();
+      return ret;
+    }
+
+    MiddlePointer Unpack(uint64_t extend_pointer, unsigned char extend_length, Node &node) const {
+      node = extend_pointer;
+      return MiddlePointer(quant_, extend_length - 2, middle_[extend_length - 2].MustFind(extend_pointer << middle_shift_)->packed);
+    }
+
+    MiddlePointer LookupMiddle(unsigned char order_minus_2, WordIndex word, Node &node, bool &independent_left, uint64_t &extend_pointer) const {
+      node = CombineWordHash(node, word);
+      Table::ConstIterator found;
+      if (!middle_[order_minus_2].Find(node << middle_shift_, found)) {
+        independent_left = true;
+        return MiddlePointer();
+      }
+      extend_pointer = node;
+      MiddlePointer ret(quant_, order_minus_2, found->packed);
+      independent_left = ret.IndependentLeft();
+      return ret;
+    }
+
+    LongestPointer LookupLongest(WordIndex word, const Node &node) const {
+      Table::ConstIterator found;
+      if (!longest_.Find(CombineWordHash(node, word) << longest_shift_, found)) return LongestPointer();
+      return LongestPointer(quant_, found->packed);
+    }
+
+    // Same as HashedSearch::Prefetch.
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, WordIndex word) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(&unigram_[word]);
+#endif
+      Node node = static_cast<Node>(word);
+      const WordIndex *i = context_rbegin;
+      for (unsigned char order_minus_2 = 0; order_minus_2 < middle_.size(); ++order_minus_2, ++i) {
+        if (i >= context_rend) return;
+        node = CombineWordHash(node, *i);
+        middle_[order_minus_2].Prefetch(node << middle_shift_);
+      }
+      if (i < context_rend) longest_.Prefetch(CombineWordHash(node, *i) << longest_shift_);
+    }
+
+    bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
+      assert(begin != end);
+      node = static_cast<Node>(*begin);
+      for (const WordIndex *i = begin + 1; i < end; ++i) {
+        node = CombineWordHash(node, *i);
+      }
+      return true;
+    }
+
+  private:
+    struct PackedEntry {
+      typedef uint64_t Key;
+      uint64_t packed;
+      Key GetKey() const { return packed; }
+      void SetKey(Key to) { packed = to; }
+    };
+
+    // Hash and compare only the bits above the value.
+    class ShiftedHash {
+      public:
+        explicit ShiftedHash(uint8_t shift = 0) : shift_(shift) {}
+        uint64_t operator()(uint64_t packed) const { return packed >> shift_; }
+      private:
+        uint8_t shift_;
+    };
+    class ShiftedEqual {
+      public:
+        explicit ShiftedEqual(uint8_t shift = 0) : shift_(shift) {}
+        bool operator()(uint64_t first, uint64_t second) const { return (first >> shift_) == (second >> shift_); }
+      private:
+        uint8_t shift_;
+    };
+
+    typedef util::ProbingHashTable<PackedEntry, ShiftedHash, ShiftedEqual> Table;
+
+    // Train the quantizer on the weights of unpacked and insert them here.
+    void Pack(const HashedSearch<BackoffValue> &unpacked, const std::vector<uint64_t> &counts, const Config &config);
+
+    SeparatelyQuantize quant_;
+
+    ProbBackoff *unigram_;
+
+    std::vector<Table> middle_;
+    Table longest_;
+
+    uint8_t middle_shift_, longest_shift_;
 };
 
 } // namespace detail
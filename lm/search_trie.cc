@@ -6,6 +6,7 @@
 #include "lm/blank.hh"
 #include "lm/lm_exception.hh"
 #include "lm/max_order.hh"
+#include "lm/ngram_source.hh"
 #include "lm/quantize.hh"
 #include "lm/trie.hh"
 #include "lm/trie_sort.hh"
@@ -13,6 +14,7 @@
 #include "lm/weights.hh"
 #include "lm/word_index.hh"
 #include "util/ersatz_progress.hh"
+#include "util/file_piece.hh"
 #include "util/mmap.hh"
 #include "util/proxy_iterator.hh"
 #include "util/scoped.hh"
@@ -575,13 +577,14 @@ template <class Quant, class Bhiksha> uint8_t *TrieSearch<Quant, Bhiksha>::Setup
   return start + Longest::Size(Quant::LongestBits(config), counts.back(), counts[0]);
 }
 
-template <class Quant, class Bhiksha> void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing) {
+template <class Quant, class Bhiksha> template <class Source> void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *file, Source &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing) {
   std::string temporary_prefix;
   if (!config.temporary_directory_prefix.empty()) {
     temporary_prefix = config.temporary_directory_prefix;
   } else if (config.write_mmap) {
     temporary_prefix = config.write_mmap;
   } else {
+    UTIL_THROW_IF(!file, ConfigException, "Set temporary_directory_prefix or write_mmap to build a trie without a file.");
     temporary_prefix = file;
   }
   // At least 1MB sorting memory.
@@ -595,6 +598,18 @@ template class TrieSearch<DontQuantize, ArrayBhiksha>;
 template class TrieSearch<SeparatelyQuantize, DontBhiksha>;
 template class TrieSearch<SeparatelyQuantize, ArrayBhiksha>;
 
+#define LM_TRIE_INITIALIZE(Quant, Bhiksha, Source) \
+  template void TrieSearch<Quant, Bhiksha>::InitializeFromARPA(const char *, Source &, std::vector<uint64_t> &, const Config &, SortedVocabulary &, BinaryFormat &);
+#define LM_TRIE_INITIALIZE_SOURCES(Quant, Bhiksha) \
+  LM_TRIE_INITIALIZE(Quant, Bhiksha, util::FilePiece) \
+  LM_TRIE_INITIALIZE(Quant, Bhiksha, NGramSource)
+LM_TRIE_INITIALIZE_SOURCES(DontQuantize, DontBhiksha)
+LM_TRIE_INITIALIZE_SOURCES(DontQuantize, ArrayBhiksha)
+LM_TRIE_INITIALIZE_SOURCES(SeparatelyQuantize, DontBhiksha)
+LM_TRIE_INITIALIZE_SOURCES(SeparatelyQuantize, ArrayBhiksha)
+#undef LM_TRIE_INITIALIZE_SOURCES
+#undef LM_TRIE_INITIALIZE
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
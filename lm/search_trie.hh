@@ -59,7 +59,8 @@ template <class Quant, class Bhiksha> class TrieSearch {
 
     uint8_t *SetupMemory(uint8_t *start, const std::vector<uint64_t> &counts, const Config &config);
 
-    void InitializeFromARPA(const char *file, util::FilePiece &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing);
+    // Source is util::FilePiece for ARPA files or NGramSource.
+    template <class Source> void InitializeFromARPA(const char *file, Source &f, std::vector<uint64_t> &counts, const Config &config, SortedVocabulary &vocab, BinaryFormat &backing);
 
     unsigned char Order() const {
       return middle_end_ - middle_begin_ + 2;
@@ -88,6 +89,12 @@ template <class Quant, class Bhiksha> class TrieSearch {
       return LongestPointer(quant_, longest_.Find(word, node));
     }
 
+    // Trie lookups are a chain of dependent searches, so only the unigram
+    // entry is known before the query runs.
+    void Prefetch(const WordIndex * /*context_rbegin*/, const WordIndex * /*context_rend*/, WordIndex word) const {
+      unigram_.Prefetch(word);
+    }
+
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
       assert(begin != end);
       bool independent_left;
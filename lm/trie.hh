@@ -62,6 +62,12 @@ class Unigram {
       return unigram_;
     }
 
+    void Prefetch(WordIndex word) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(unigram_ + word);
+#endif
+    }
+
     UnigramPointer Find(WordIndex word, NodeRange &next) const {
       UnigramValue *val = unigram_ + word;
       next.begin = val->next;
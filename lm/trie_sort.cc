@@ -2,13 +2,16 @@
 
 #include "lm/config.hh"
 #include "lm/lm_exception.hh"
+#include "lm/ngram_source.hh"
 #include "lm/read_arpa.hh"
 #include "lm/vocab.hh"
 #include "lm/weights.hh"
 #include "lm/word_index.hh"
 #include "util/file_piece.hh"
+#include "util/fixed_array.hh"
 #include "util/mmap.hh"
 #include "util/proxy_iterator.hh"
+#include "util/scoped.hh"
 #include "util/sized_iterator.hh"
 
 #include <algorithm>
@@ -20,6 +23,11 @@
 #include <limits>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 namespace lm {
 namespace ngram {
 namespace trie {
@@ -150,6 +158,180 @@ template <class Combine> FILE *MergeSortedFiles(FILE *first_file, FILE *second_f
   return out_file.release();
 }
 
+// What the tasks converting one order share.
+struct OrderInfo {
+  unsigned char order;
+  std::size_t entry_size;
+  std::size_t weights_size;
+  const std::string *temp_prefix;
+  const SortedVocabulary *vocab;
+  // Each task parsing the file reports positive log probabilities to a
+  // Deferred() copy of this.
+  const PositiveProbWarn *warn;
+  // ARPA file to parse the n-grams from, or NULL if they were already read.
+  const char *parse_file;
+};
+
+template <class Source> void ReadBatch(Source &f, const OrderInfo &info, uint8_t *out, uint8_t *out_end, PositiveProbWarn &warn) {
+  const unsigned char order = info.order;
+  const std::size_t words_size = sizeof(WordIndex) * order;
+  if (info.weights_size == sizeof(Prob)) {
+    for (; out != out_end; out += info.entry_size) {
+      std::reverse_iterator<WordIndex*> it(reinterpret_cast<WordIndex*>(out) + order);
+      ReadNGram(f, order, *info.vocab, it, *reinterpret_cast<Prob*>(out + words_size), warn);
+    }
+  } else {
+    for (; out != out_end; out += info.entry_size) {
+      std::reverse_iterator<WordIndex*> it(reinterpret_cast<WordIndex*>(out) + order);
+      ReadNGram(f, order, *info.vocab, it, *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+    }
+  }
+}
+
+// Sorts a range of n-grams and writes them and their contexts to temporary
+// files, first parsing them from info.parse_file if set.  Positive log
+// probabilities are left in Warnings() for the caller to report once.
+class SortTask {
+  public:
+    struct Range {
+      uint8_t *begin, *end;
+      // Where the range's n-grams start in info.parse_file.
+      uint64_t offset;
+    };
+
+    SortTask(const OrderInfo &info, const Range &range)
+      : info_(info), range_(range), warn_(info.warn->Deferred()) {}
+
+    void operator()() {
+      if (info_.parse_file) {
+        util::FilePiece f(info_.parse_file);
+        f.Seek(range_.offset);
+        ReadBatch(f, info_, range_.begin, range_.end, warn_);
+      }
+      // Sort full records by full n-gram.
+      util::SizedProxy proxy_begin(range_.begin, info_.entry_size), proxy_end(range_.end, info_.entry_size);
+      // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.
+#if defined(_WIN32) || defined(_WIN64)
+      std::stable_sort
+#else
+      std::sort
+#endif
+          (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(info_.order)));
+      file_.reset(DiskFlush(range_.begin, range_.end, *info_.temp_prefix));
+      context_.reset(WriteContextFile(range_.begin, range_.end, *info_.temp_prefix, info_.entry_size, info_.order));
+    }
+
+    FILE *ReleaseFile() { return file_.release(); }
+    FILE *ReleaseContext() { return context_.release(); }
+
+    const PositiveProbWarn &Warnings() const { return warn_; }
+
+  private:
+    const OrderInfo &info_;
+    const Range range_;
+    PositiveProbWarn warn_;
+    util::scoped_FILE file_, context_;
+};
+
+// Merges two sorted files of n-grams or of their contexts.
+class MergeTask {
+  public:
+    struct Input {
+      FILE *first, *second;
+      bool context;
+    };
+
+    MergeTask(const OrderInfo &info, const Input &input) : info_(info), input_(input) {}
+
+    void operator()() {
+      if (input_.context) {
+        out_.reset(MergeSortedFiles(input_.first, input_.second, *info_.temp_prefix, 0, info_.order - 1, FirstCombine()));
+      } else {
+        out_.reset(MergeSortedFiles(input_.first, input_.second, *info_.temp_prefix, info_.weights_size, info_.order, ThrowCombine()));
+      }
+    }
+
+    FILE *Release() { return out_.release(); }
+
+  private:
+    const OrderInfo &info_;
+    const Input input_;
+    util::scoped_FILE out_;
+};
+
+#ifdef WITH_THREADS
+// Runs a task, keeping any exception for the thread that started it.
+template <class Task> class Catcher {
+  public:
+    explicit Catcher(Task &task) : task_(task) {}
+
+    void operator()() {
+      try {
+        task_();
+      } catch (...) {
+        error_ = boost::current_exception();
+      }
+    }
+
+    // Throws the task's exception with its original type.
+    void Rethrow() const {
+      if (error_) boost::rethrow_exception(error_);
+    }
+
+  private:
+    Task &task_;
+    boost::exception_ptr error_;
+};
+#endif // WITH_THREADS
+
+// Runs the tasks on a thread each and throws the first failure once all have
+// finished.
+template <class Task> void RunTasks(util::FixedArray<Task> &tasks) {
+#ifdef WITH_THREADS
+  if (tasks.size() > 1) {
+    util::FixedArray<Catcher<Task> > catchers(tasks.size());
+    boost::thread_group threads;
+    for (Task *i = tasks.begin(); i != tasks.end(); ++i) {
+      catchers.push_back(*i);
+      threads.create_thread(boost::ref(catchers.back()));
+    }
+    threads.join_all();
+    for (const Catcher<Task> *i = catchers.begin(); i != catchers.end(); ++i) {
+      i->Rethrow();
+    }
+    return;
+  }
+#endif
+  for (Task *i = tasks.begin(); i != tasks.end(); ++i) {
+    (*i)();
+  }
+}
+
+// Records where each range's n-grams start in f and reads past them, so that
+// threads can parse the ranges from their own FilePiece.  Returns the file to
+// parse or, without reading anything, NULL if f is not an uncompressed file.
+const char *LocateRanges(util::FilePiece &f, std::size_t entry_size, SortTask::Range *begin, SortTask::Range *end) {
+  if (!f.Seekable() || end - begin < 2) return NULL;
+  for (SortTask::Range *range = begin; range != end; ++range) {
+    range->offset = f.Offset();
+    for (std::size_t remaining = (range->end - range->begin) / entry_size; remaining; ) {
+      StringPiece line(f.ReadLine());
+      // Blank lines are skipped when parsing, so they don't count.
+      for (const char *i = line.data(); i != line.data() + line.size(); ++i) {
+        if (!util::kSpaces[static_cast<unsigned char>(*i)]) {
+          --remaining;
+          break;
+        }
+      }
+    }
+  }
+  return f.FileName().c_str();
+}
+
+const char *LocateRanges(NGramSource &, std::size_t, SortTask::Range *, SortTask::Range *) {
+  return NULL;
+}
+
 } // namespace
 
 void RecordReader::Init(FILE *file, std::size_t entry_size) {
@@ -187,7 +369,7 @@ void RecordReader::Rewind() {
   }
 }
 
-SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab) {
+template <class Source> SortedFiles::SortedFiles(const Config &config, Source &f, std::vector<uint64_t> &counts, size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab) {
   PositiveProbWarn warn(config.positive_log_probability);
   unigram_.reset(util::MakeTemp(file_prefix));
   {
@@ -212,7 +394,7 @@ SortedFiles::SortedFiles(const Config &config, util::FilePiece &f, std::vector<u
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
   for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, file_prefix, order, warn, mem.get(), buffer);
+    ConvertToSorted(f, config, vocab, counts, file_prefix, order, warn, mem.get(), buffer);
   }
   ReadEnd(f);
 }
@@ -237,57 +419,79 @@ class Closer {
 };
 } // namespace
 
-void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
+template <class Source> void SortedFiles::ConvertToSorted(Source &f, const Config &config, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
+  OrderInfo info;
+  info.order = order;
   // Size of weights.  Does it include backoff?
-  const size_t words_size = sizeof(WordIndex) * order;
-  const size_t weights_size = sizeof(float) + ((order == counts.size()) ? 0 : sizeof(float));
-  const size_t entry_size = words_size + weights_size;
+  info.weights_size = sizeof(float) + ((order == counts.size()) ? 0 : sizeof(float));
+  info.entry_size = sizeof(WordIndex) * order + info.weights_size;
+  info.temp_prefix = &file_prefix;
+  info.vocab = &vocab;
+  info.warn = &warn;
+  const size_t entry_size = info.entry_size;
   const size_t batch_size = std::min(count, mem_size / entry_size);
+  const size_t threads = std::max<size_t>(1, config.building_threads);
   uint8_t *const begin = reinterpret_cast<uint8_t*>(mem);
 
   std::deque<FILE*> files, contexts;
   Closer files_closer(files), contexts_closer(contexts);
 
-  for (std::size_t batch = 0, done = 0; done < count; ++batch) {
-    uint8_t *out = begin;
-    uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
-    if (order == counts.size()) {
-      for (; out != out_end; out += entry_size) {
-        std::reverse_iterator<WordIndex*> it(reinterpret_cast<WordIndex*>(out) + order);
-        ReadNGram(f, order, vocab, it, *reinterpret_cast<Prob*>(out + words_size), warn);
-      }
-    } else {
-      for (; out != out_end; out += entry_size) {
-        std::reverse_iterator<WordIndex*> it(reinterpret_cast<WordIndex*>(out) + order);
-        ReadNGram(f, order, vocab, it, *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
-      }
+  for (std::size_t done = 0; done < count; ) {
+    const std::size_t batch = std::min(count - done, batch_size);
+    uint8_t *out_end = begin + batch * entry_size;
+    // Each thread sorts a range of the batch.  The sorted files only depend
+    // on the n-grams, so splitting the batch doesn't change the output.
+    const std::size_t ranges = std::min(threads, batch);
+    util::FixedArray<SortTask::Range> range(ranges);
+    for (std::size_t i = 0; i < ranges; ++i) {
+      range.push_back();
+      range.back().begin = begin + (batch * i / ranges) * entry_size;
+      range.back().end = begin + (batch * (i + 1) / ranges) * entry_size;
+      range.back().offset = 0;
     }
-    // Sort full records by full n-gram.
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM.  TODO: figure out why windows sort doesn't like my proxies.
-#if defined(_WIN32) || defined(_WIN64)
-    std::stable_sort
-#else
-    std::sort
-#endif
-        (NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, file_prefix));
-    contexts.push_back(WriteContextFile(begin, out_end, file_prefix, entry_size, order));
-
-    done += (out_end - begin) / entry_size;
+    info.parse_file = LocateRanges(f, entry_size, range.begin(), range.end());
+    if (!info.parse_file) {
+      ReadBatch(f, info, begin, out_end, warn);
+    }
+    util::FixedArray<SortTask> sorts(ranges);
+    for (const SortTask::Range *i = range.begin(); i != range.end(); ++i) {
+      sorts.push_back(info, *i);
+    }
+    RunTasks(sorts);
+    for (SortTask *i = sorts.begin(); i != sorts.end(); ++i) {
+      warn.Merge(i->Warnings());
+      files.push_back(i->ReleaseFile());
+      contexts.push_back(i->ReleaseContext());
+    }
+    done += batch;
   }
 
-  // All individual files created.  Merge them.
-
+  // All individual files created.  Merge them, a pair of each kind per two threads.
   while (files.size() > 1) {
-    files.push_back(MergeSortedFiles(files[0], files[1], file_prefix, weights_size, order, ThrowCombine()));
-    files_closer.PopFront();
-    files_closer.PopFront();
-    contexts.push_back(MergeSortedFiles(contexts[0], contexts[1], file_prefix, 0, order - 1, FirstCombine()));
-    contexts_closer.PopFront();
-    contexts_closer.PopFront();
+    const std::size_t pairs = std::min(files.size() / 2, std::max<std::size_t>(1, threads / 2));
+    util::FixedArray<MergeTask> merges(pairs * 2);
+    for (std::size_t i = 0; i < pairs; ++i) {
+      MergeTask::Input input;
+      input.context = false;
+      input.first = files[2 * i];
+      input.second = files[2 * i + 1];
+      merges.push_back(info, input);
+      input.context = true;
+      input.first = contexts[2 * i];
+      input.second = contexts[2 * i + 1];
+      merges.push_back(info, input);
+    }
+    RunTasks(merges);
+    for (std::size_t i = 0; i < pairs * 2; ++i) {
+      files_closer.PopFront();
+      contexts_closer.PopFront();
+    }
+    for (std::size_t i = 0; i < pairs; ++i) {
+      files.push_back(merges[2 * i].Release());
+      contexts.push_back(merges[2 * i + 1].Release());
+    }
   }
 
   if (!files.empty()) {
@@ -299,6 +503,9 @@ void SortedFiles::ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vo
   }
 }
 
+template SortedFiles::SortedFiles(const Config &, util::FilePiece &, std::vector<uint64_t> &, size_t, const std::string &, SortedVocabulary &);
+template SortedFiles::SortedFiles(const Config &, NGramSource &, std::vector<uint64_t> &, size_t, const std::string &, SortedVocabulary &);
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
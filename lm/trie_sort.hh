@@ -84,8 +84,8 @@ class RecordReader {
 
 class SortedFiles {
   public:
-    // Build from ARPA
-    SortedFiles(const Config &config, util::FilePiece &f, std::vector<uint64_t> &counts, std::size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
+    // Build from ARPA (util::FilePiece) or an NGramSource.
+    template <class Source> SortedFiles(const Config &config, Source &f, std::vector<uint64_t> &counts, std::size_t buffer, const std::string &file_prefix, SortedVocabulary &vocab);
 
     int StealUnigram() {
       return unigram_.release();
@@ -100,7 +100,7 @@ class SortedFiles {
     }
 
   private:
-    void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size);
+    template <class Source> void ConvertToSorted(Source &f, const Config &config, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, const std::string &prefix, unsigned char order, PositiveProbWarn &warn, void *mem, std::size_t mem_size);
 
     util::scoped_fd unigram_;
 
@@ -1,4 +1,5 @@
 #include "util/usage.hh"
+#include "util/tokenize_piece.hh"
 #include "moses/TranslationModel/ProbingPT/storing.hh"
 
 
@@ -8,20 +9,33 @@ int main(int argc, char* argv[])
 
   const char * is_reordering = "false";
 
-  if (!(argc == 5 || argc == 4)) {
+  if (!(argc == 6 || argc == 5 || argc == 4)) {
     // Tell the user how to run the program
-    std::cerr << "Provided " << argc << " arguments, needed 4 or 5." << std::endl;
-    std::cerr << "Usage: " << argv[0] << " path_to_phrasetable output_dir num_scores is_reordering" << std::endl;
+    std::cerr << "Provided " << argc << " arguments, needed 4, 5 or 6." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " path_to_phrasetable output_dir num_scores is_reordering [sort_weights]" << std::endl;
     std::cerr << "is_reordering should be either true or false, but it is currently a stub feature." << std::endl;
+    std::cerr << "sort_weights is a comma separated weight per score, e.g. 0.2,0.2,0.2,0.2. If given, target phrases" << std::endl;
+    std::cerr << "are stored best first and decoding with the same weights reads only the first table-limit of them." << std::endl;
     //std::cerr << "Usage: " << argv[0] << " path_to_phrasetable number_of_uniq_lines output_bin_file output_hash_table output_vocab_id" << std::endl;
     return 1;
   }
 
-  if (argc == 5) {
+  if (argc >= 5) {
     is_reordering = argv[4];
   }
 
-  createProbingPT(argv[1], argv[2], argv[3], is_reordering);
+  std::vector<float> sort_weights;
+  if (argc == 6) {
+    for (util::TokenIter<util::SingleCharacter> it(argv[5], util::SingleCharacter(',')); it; ++it) {
+      sort_weights.push_back(atof(it->as_string().c_str()));
+    }
+    if (sort_weights.size() != (size_t)atoi(argv[3])) {
+      std::cerr << "Got " << sort_weights.size() << " sort weights for " << argv[3] << " scores." << std::endl;
+      return 1;
+    }
+  }
+
+  createProbingPT(argv[1], argv[2], argv[3], is_reordering, sort_weights);
 
   util::PrintUsage(std::cout);
   return 0;
@@ -26,6 +26,8 @@ void printHelp(char **argv)
             "\n  advanced:\n"
             "\t-encoding string  -- encoding type: PREnc REnc None (default PREnc)\n"
             "\t-rankscore int    -- score index of P(t|s) (default 2)\n"
+            "\t-rankweights string -- comma separated weight per score. Store target phrases best\n"
+            "\t                     first by weighted log score (any encoding) and rank by it for PREnc\n"
             "\t-maxrank int      -- maximum rank for PREnc (default 100)\n"
             "\t-landmark int     -- use landmark phrase every 2^n source phrases (default 10)\n"
             "\t-fingerprint int  -- number of bits used for source phrase fingerprints (default 16)\n"
@@ -66,6 +68,7 @@ int main(int argc, char **argv)
   size_t maxRank = 100;
   bool sortScoreIndexSet = false;
   size_t sortScoreIndex = 2;
+  std::vector<float> sortWeights;
   bool warnMe = true;
   size_t threads =
 #ifdef WITH_THREADS
@@ -109,6 +112,9 @@ int main(int argc, char **argv)
       ++i;
       sortScoreIndex = atoi(argv[i]);
       sortScoreIndexSet = true;
+    } else if("-rankweights" == arg && i+1 < argc) {
+      ++i;
+      sortWeights = Tokenize<float>(argv[i], ",");
     } else if("-no-alignment-info" == arg) {
       useAlignmentInfo = false;
     } else if("-landmark" == arg && i+1 < argc) {
@@ -146,7 +152,13 @@ int main(int argc, char **argv)
     }
   }
 
-  if(!sortScoreIndexSet && numScoreComponent != 4 && coding == PhraseTableCreator::PREnc) {
+  if(!sortWeights.empty() && sortWeights.size() != numScoreComponent) {
+    std::cerr << "ERROR: -rankweights has " << sortWeights.size() << " weights for "
+              << numScoreComponent << " scores" << std::endl;
+    abort();
+  }
+
+  if(!sortScoreIndexSet && sortWeights.empty() && numScoreComponent != 4 && coding == PhraseTableCreator::PREnc) {
     std::cerr << "WARNING: You are using a nonstandard number of scores ("
               << numScoreComponent << ") with PREnc. Set the index of P(t|s) "
               "with  -rankscore int  if it is not "
@@ -166,7 +178,7 @@ int main(int argc, char **argv)
                      numScoreComponent, sortScoreIndex,
                      coding, orderBits, fingerprintBits,
                      useAlignmentInfo, multipleScoreTrees,
-                     quantize, maxRank, warnMe
+                     quantize, maxRank, warnMe, sortWeights
 #ifdef WITH_THREADS
                      , threads
 #endif
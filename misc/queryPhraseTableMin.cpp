@@ -9,6 +9,7 @@
 #include "moses/TranslationModel/CompactPT/PhraseDictionaryCompact.h"
 #include "moses/Util.h"
 #include "moses/Phrase.h"
+#include "moses/Timer.h"
 #include "moses/parameters/AllOptions.h"
 
 void usage();
@@ -23,6 +24,7 @@ int main(int argc, char **argv)
   std::string ttable = "";
   bool useAlignments = false;
   bool reportCounts = false;
+  int benchmarkPasses = 0;
 
   for(int i = 1; i < argc; i++) {
     if(!strcmp(argv[i], "-n")) {
@@ -37,6 +39,10 @@ int main(int argc, char **argv)
       useAlignments = true;
     } else if (!strcmp(argv[i], "-c")) {
       reportCounts = true;
+    } else if(!strcmp(argv[i], "-b")) {
+      if(i + 1 == argc)
+        usage();
+      benchmarkPasses = atoi(argv[++i]);
     } else
       usage();
   }
@@ -54,6 +60,36 @@ int main(int argc, char **argv)
   AllOptions::ptr opts(new AllOptions);
   pdc.Load(opts);
 
+  if(benchmarkPasses > 0) {
+    std::vector<Phrase> sourcePhrases;
+    std::string line;
+    while(getline(std::cin, line)) {
+      sourcePhrases.push_back(Phrase());
+      sourcePhrases.back().CreateFromString(Input, input, line, NULL);
+    }
+
+    // Time decoding alone; PREnc tables also serve repeated lookups
+    // from their decoding cache
+    size_t decoded = 0;
+    Timer timer;
+    timer.start();
+    for(int pass = 0; pass < benchmarkPasses; pass++)
+      for(size_t i = 0; i < sourcePhrases.size(); i++) {
+        TargetPhraseVectorPtr decodedPhraseColl
+        = pdc.GetTargetPhraseCollectionRaw(sourcePhrases[i]);
+        if(decodedPhraseColl != NULL)
+          decoded += decodedPhraseColl->size();
+      }
+    timer.stop();
+
+    double seconds = timer.get_elapsed_time();
+    std::cerr << "Decoded " << decoded << " target phrases for "
+              << benchmarkPasses * sourcePhrases.size() << " lookups in "
+              << seconds << " seconds: " << decoded / seconds
+              << " phrases/sec" << std::endl;
+    return 0;
+  }
+
   std::string line;
   while(getline(std::cin, line)) {
     Phrase sourcePhrase;
@@ -89,9 +125,11 @@ int main(int argc, char **argv)
 
 void usage()
 {
-  std::cerr << 	"Usage: queryPhraseTable [-n <nscores>] [-a] -t <ttable>\n"
+  std::cerr << 	"Usage: queryPhraseTable [-n <nscores>] [-a] [-b <passes>] -t <ttable>\n"
             "-n <nscores>      number of scores in phrase table (default: 5)\n"
             "-c                only report counts of entries\n"
+            "-b <passes>       decode the queries this many times and report\n"
+            "                  decoded phrases per second\n"
             "-a                binary phrase table contains alignments\n"
             "-t <ttable>       phrase table\n";
   exit(1);
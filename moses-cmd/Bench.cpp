@@ -0,0 +1,343 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2009 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+/**
+ * moses-bench: decodes an input file several times with the models of a
+ * moses.ini and reports throughput, sentence latency and the time spent in
+ * each decoding stage as JSON.
+ *
+ * Takes the usual decoder options plus
+ *   -bench-iterations N   measured passes over the input (default 3)
+ *   -bench-warmup N       passes run first to warm caches, not reported (default 1)
+ *   -bench-json FILE      where to write the report (default stdout)
+ * The input is read from -input-file or stdin.  Translations are discarded;
+ * n-best lists and other reports are written as configured.
+ **/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "moses/ContextScope.h"
+#include "moses/FF/FeatureFunction.h"
+#include "moses/InputFileStream.h"
+#include "moses/IOWrapper.h"
+#include "moses/Parameter.h"
+#include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
+#include "moses/Timer.h"
+#include "moses/TranslationTask.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+#include "util/random.hh"
+#include "util/usage.hh"
+
+using namespace std;
+using namespace Moses;
+
+namespace
+{
+
+struct BenchOptions {
+  size_t iterations;
+  size_t warmup;
+  string json;
+  BenchOptions() : iterations(3), warmup(1), json("-") {}
+};
+
+/** Removes the -bench-* options from argv, so that the rest can go to
+ * Parameter::LoadParam() */
+bool ExtractBenchOptions(int &argc, char const **argv, BenchOptions &opts)
+{
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    string arg(argv[i]);
+    size_t dashes = arg.find_first_not_of('-');
+    string name = dashes == string::npos ? arg : arg.substr(dashes);
+    if (name != "bench-iterations" && name != "bench-warmup" && name != "bench-json") {
+      argv[kept++] = argv[i];
+      continue;
+    }
+    if (i + 1 == argc) {
+      cerr << "Error: " << arg << " needs a value" << endl;
+      return false;
+    }
+    string value(argv[++i]);
+    if (name == "bench-iterations") opts.iterations = Scan<size_t>(value);
+    else if (name == "bench-warmup") opts.warmup = Scan<size_t>(value);
+    else opts.json = value;
+  }
+  argc = kept;
+  return opts.iterations > 0;
+}
+
+/** Runs a TranslationTask on a pool thread, keeping any exception for the
+ * main thread so that ThreadPool::SubmitAndWait() returns */
+class BenchTask : public Task
+{
+public:
+  explicit BenchTask(boost::shared_ptr<TranslationTask> const& task)
+    : m_task(task), m_failed(false) {}
+
+  void Run() {
+    try {
+      m_task->Run();
+    } catch (const std::exception &e) {
+      m_failed = true;
+      m_error = e.what();
+    }
+  }
+
+  boost::shared_ptr<TranslationTask> const& GetTask() const {
+    return m_task;
+  }
+  bool Failed() const {
+    return m_failed;
+  }
+  string const& GetError() const {
+    return m_error;
+  }
+
+private:
+  boost::shared_ptr<TranslationTask> m_task;
+  bool m_failed;
+  string m_error;
+};
+
+//! totals over the measured passes
+struct BenchStats {
+  size_t sentences, words;
+  double wall, parse;
+  TranslationTaskTimes stages;
+  vector<double> latencies; // seconds, one per sentence
+  vector<double> passes;    // seconds, one per pass
+
+  BenchStats() : sentences(0), words(0), wall(0), parse(0), stages() {}
+
+  void Add(TranslationTaskTimes const& times) {
+    stages.setup += times.setup;
+    stages.collectOpts += times.collectOpts;
+    stages.search += times.search;
+    stages.output += times.output;
+    stages.nbest += times.nbest;
+    stages.total += times.total;
+    latencies.push_back(times.total);
+  }
+};
+
+//! decode the whole input once
+void RunPass(string const& input, BenchStats *stats
+#ifdef WITH_THREADS
+             , ThreadPool &pool
+#endif
+            )
+{
+  const StaticData &staticData = StaticData::Instance();
+  istringstream inputStream(input);
+  ostringstream discard;
+  boost::shared_ptr<IOWrapper> ioWrapper(new IOWrapper(*staticData.options()));
+  ioWrapper->SetInputStreamFromString(inputStream);
+  ioWrapper->SetOutputStream2SingleBestOutputCollector(&discard);
+  boost::shared_ptr<ContextScope> scope(new ContextScope);
+
+  Timer passTime;
+  passTime.start();
+
+  // parse everything first so that parsing is timed on its own
+  vector<boost::shared_ptr<BenchTask> > tasks;
+  size_t words = 0;
+  Timer parseTime;
+  parseTime.start();
+  boost::shared_ptr<InputType> source;
+  while ((source = ioWrapper->ReadInput()) != NULL) {
+    words += source->GetSize();
+    boost::shared_ptr<TranslationTask> task
+    = TranslationTask::create(source, ioWrapper, scope);
+    FeatureFunction::SetupAll(*task);
+    tasks.push_back(boost::shared_ptr<BenchTask>(new BenchTask(task)));
+  }
+  parseTime.stop();
+
+#ifdef WITH_THREADS
+  vector<boost::shared_ptr<Task> > batch(tasks.begin(), tasks.end());
+  pool.SubmitAndWait(batch);
+#else
+  for (size_t i = 0; i < tasks.size(); ++i) tasks[i]->Run();
+#endif
+  passTime.stop();
+
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    UTIL_THROW_IF2(tasks[i]->Failed(), "Line " << i << ": " << tasks[i]->GetError());
+  }
+  if (stats == NULL) return;
+
+  stats->sentences += tasks.size();
+  stats->words += words;
+  stats->parse += parseTime.get_elapsed_time();
+  stats->wall += passTime.get_elapsed_time();
+  stats->passes.push_back(passTime.get_elapsed_time());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    stats->Add(tasks[i]->GetTask()->GetTimes());
+  }
+}
+
+//! nearest-rank percentile of sorted values
+double Percentile(vector<double> const& sorted, double p)
+{
+  if (sorted.empty()) return 0;
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  rank = std::max<size_t>(rank, 1);
+  return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+void WriteJson(ostream &out, BenchOptions const& opts, size_t threads,
+               double loadTime, BenchStats &stats)
+{
+  std::sort(stats.latencies.begin(), stats.latencies.end());
+  double mean = stats.sentences ? stats.stages.total / stats.sentences : 0;
+  double wall = stats.wall > 0 ? stats.wall : 1;
+
+  out.setf(std::ios::fixed);
+  out.precision(6);
+  out << "{\n"
+      << "  \"iterations\": " << opts.iterations << ",\n"
+      << "  \"warmup\": " << opts.warmup << ",\n"
+      << "  \"threads\": " << threads << ",\n"
+      << "  \"sentences\": " << stats.sentences << ",\n"
+      << "  \"words\": " << stats.words << ",\n"
+      << "  \"load_seconds\": " << loadTime << ",\n"
+      << "  \"wall_seconds\": " << stats.wall << ",\n"
+      << "  \"pass_seconds\": [";
+  for (size_t i = 0; i < stats.passes.size(); ++i) {
+    out << (i ? ", " : "") << stats.passes[i];
+  }
+  out << "],\n"
+      << "  \"throughput\": {\n"
+      << "    \"sentences_per_second\": " << stats.sentences / wall << ",\n"
+      << "    \"words_per_second\": " << stats.words / wall << "\n"
+      << "  },\n"
+      << "  \"latency_seconds\": {\n"
+      << "    \"mean\": " << mean << ",\n"
+      << "    \"p50\": " << Percentile(stats.latencies, 50) << ",\n"
+      << "    \"p95\": " << Percentile(stats.latencies, 95) << ",\n"
+      << "    \"p99\": " << Percentile(stats.latencies, 99) << ",\n"
+      << "    \"max\": " << (stats.latencies.empty() ? 0 : stats.latencies.back()) << "\n"
+      << "  },\n"
+      // summed over sentences, so with several threads they exceed the wall time
+      << "  \"stage_seconds\": {\n"
+      << "    \"input_parse\": " << stats.parse << ",\n"
+      << "    \"setup\": " << stats.stages.setup << ",\n"
+      << "    \"option_collection\": " << stats.stages.collectOpts << ",\n"
+      << "    \"search\": " << stats.stages.search << ",\n"
+      << "    \"nbest\": " << stats.stages.nbest << ",\n"
+      << "    \"output\": " << stats.stages.output << "\n"
+      << "  },\n"
+      << "  \"peak_rss_bytes\": " << util::RSSMax() << "\n"
+      << "}\n";
+}
+
+} // namespace
+
+int main(int argc, char const** argv)
+{
+#ifdef NDEBUG
+  try
+#endif
+  {
+    BenchOptions opts;
+    if (!ExtractBenchOptions(argc, argv, opts)) {
+      cerr << "Usage: " << argv[0] << " -f moses.ini [-input-file FILE]"
+           << " [-bench-iterations N] [-bench-warmup N] [-bench-json FILE]"
+           << " [decoder options]" << endl;
+      return EXIT_FAILURE;
+    }
+
+    Parameter params;
+    if (!params.LoadParam(argc, argv))
+      return EXIT_FAILURE;
+
+    Timer loadTime;
+    loadTime.start();
+    ResetUserTime();
+    if (!StaticData::LoadDataStatic(&params, argv[0]))
+      return EXIT_FAILURE;
+    loadTime.stop();
+    util::rand_init();
+
+    // keep the input in memory so that every pass parses the same text
+    string input;
+    {
+      const PARAM_VEC *inputFile = params.GetParam("input-file");
+      ostringstream buffer;
+      if (inputFile && inputFile->size()) {
+        InputFileStream in(inputFile->at(0));
+        buffer << in.rdbuf();
+      } else {
+        buffer << cin.rdbuf();
+      }
+      input = buffer.str();
+    }
+
+    const StaticData &staticData = StaticData::Instance();
+    size_t threads = 1;
+#ifdef WITH_THREADS
+    threads = staticData.ThreadCount();
+    ThreadPool pool(threads,
+                    staticData.CpuAffinityOffset(),
+                    staticData.CpuAffinityIncrement());
+#endif
+
+    BenchStats stats;
+    for (size_t i = 0; i < opts.warmup + opts.iterations; ++i) {
+      VERBOSE(1, (i < opts.warmup ? "Warm-up pass " : "Pass ") << i << endl);
+#ifdef WITH_THREADS
+      RunPass(input, i < opts.warmup ? NULL : &stats, pool);
+#else
+      RunPass(input, i < opts.warmup ? NULL : &stats);
+#endif
+    }
+
+#ifdef WITH_THREADS
+    pool.Stop(true);
+#endif
+
+    if (opts.json == "-") {
+      WriteJson(cout, opts, threads, loadTime.get_elapsed_time(), stats);
+    } else {
+      ofstream out(opts.json.c_str());
+      UTIL_THROW_IF2(!out, "Cannot write " << opts.json);
+      WriteJson(out, opts, threads, loadTime.get_elapsed_time(), stats);
+    }
+
+    // skip the slow destructors, as the decoder does
+    exit(EXIT_SUCCESS);
+  }
+#ifdef NDEBUG
+  catch (const std::exception &e) {
+    std::cerr << "Exception: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+#endif
+}
@@ -19,6 +19,8 @@ namespace Moses
 
 BaseManager::BaseManager(ttasksptr const& ttask)
   : m_ttask(ttask), m_source(*(ttask->GetSource().get()))
+  , m_timeCollectOpts(0)
+  , m_timeSearch(0)
 { }
 
 const InputType&
@@ -19,6 +19,11 @@ protected:
   ttaskwptr m_ttask;
   InputType const& m_source;
 
+  // wall time of the last Decode(), left at 0 by managers that do not
+  // tell option collection and search apart
+  double m_timeCollectOpts;
+  double m_timeSearch;
+
   BaseManager(ttasksptr const& ttask);
 
   // output
@@ -52,6 +57,16 @@ public:
   AllOptions::ptr const& options() const;
 
   virtual void Decode() = 0;
+
+  //! seconds spent creating translation options in the last Decode()
+  double GetTimeCollectOpts() const {
+    return m_timeCollectOpts;
+  }
+  //! seconds spent searching in the last Decode()
+  double GetTimeSearch() const {
+    return m_timeSearch;
+  }
+
   // outputs
   virtual void OutputBest(OutputCollector *collector) const = 0;
   virtual void OutputNBest(OutputCollector *collector) const = 0;
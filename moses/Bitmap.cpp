@@ -27,65 +27,85 @@ namespace Moses
 
 TO_STRING_BODY(Bitmap);
 
-Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
-  :m_bitmap(initializer.begin(), initializer.end())
+void Bitmap::Init(size_t size)
 {
+  m_size = size;
+  const size_t numWords = NumWords(size);
+  if (numWords <= kInlineWords) {
+    m_words = m_inline;
+  } else {
+    m_heap.resize(numWords);
+    m_words = &m_heap[0];
+  }
+  std::fill(m_words, m_words + numWords, 0);
+}
 
-  // The initializer may not be of the same length.  Change to the desired
-  // length.  If we need to add any elements, initialize them to false.
-  m_bitmap.resize(size, false);
+Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
+{
+  Init(size);
+
+  // The initializer may not be of the same length.  Positions it does not
+  // cover are false.
+  const size_t stop = std::min(size, initializer.size());
+  for (size_t pos = 0; pos < stop; ++pos) {
+    if (initializer[pos]) {
+      m_words[pos >> 6] |= uint64_t(1) << (pos & 63);
+    }
+  }
 
-  m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
+  m_numWordsCovered = 0;
+  for (size_t index = 0; index < NumWords(size); ++index) {
+    m_numWordsCovered += CountBits(m_words[index]);
+  }
 
   // Find the first gap, and cache it.
-  std::vector<char>::const_iterator first_gap = std::find(
-        m_bitmap.begin(), m_bitmap.end(), false);
-  m_firstGap = (
-                 (first_gap == m_bitmap.end()) ?
-                 NOT_FOUND : first_gap - m_bitmap.begin());
+  m_firstGap = FindNext(0, false);
 }
 
 //! Create Bitmap of length size and initialise.
 Bitmap::Bitmap(size_t size)
-  :m_bitmap(size, false)
-  ,m_firstGap(0)
+  :m_firstGap(0)
   ,m_numWordsCovered(0)
-
 {
+  Init(size);
 }
 
 //! Deep copy.
 Bitmap::Bitmap(const Bitmap &copy)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  Init(copy.m_size);
+  std::copy(copy.m_words, copy.m_words + NumWords(m_size), m_words);
 }
 
 Bitmap::Bitmap(const Bitmap &copy, const Range &range)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  Init(copy.m_size);
+  std::copy(copy.m_words, copy.m_words + NumWords(m_size), m_words);
   SetValueNonOverlap(range);
 }
 
 // for unordered_set in stack
 size_t Bitmap::hash() const
 {
-  size_t ret = boost::hash_value(m_bitmap);
+  size_t ret = m_size;
+  boost::hash_range(ret, m_words, m_words + NumWords(m_size));
   return ret;
 }
 
 bool Bitmap::operator==(const Bitmap& other) const
 {
-  return m_bitmap == other.m_bitmap;
+  return m_size == other.m_size
+         && std::equal(m_words, m_words + NumWords(m_size), other.m_words);
 }
 
 // friend
 std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap)
 {
-  for (size_t i = 0 ; i < bitmap.m_bitmap.size() ; i++) {
+  for (size_t i = 0 ; i < bitmap.m_size ; i++) {
     out << int(bitmap.GetValue(i));
   }
   return out;
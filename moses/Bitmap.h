@@ -29,6 +29,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "Range.h"
 
@@ -38,38 +39,116 @@ typedef unsigned long WordsBitmapID;
 
 /** Vector of boolean to represent whether a word has been translated or not.
  *
- * Implemented using a vector of char, which is usually the same representation
- * for the elements that a C array of bool would use.  A vector of bool, or a
- * Boost dynamic_bitset, could be much more efficient in theory.  Unfortunately
- * algorithms like std::find() are not optimized for vector<bool> on gcc or
- * clang, and dynamic_bitset lacks all the optimized search operations we want.
- * Only benchmarking will tell what works best.  Perhaps dynamic_bitset could
- * still be a dramatic improvement, if we flip the meaning of the bits around
- * so we can use its find_first() and find_next() for the most common searches.
+ * Packed into 64-bit words so that the searches the decoder does all the
+ * time (first gap, edges of a gap, overlap with a span) take a few
+ * count-trailing-zeros and mask operations per word instead of a loop over
+ * positions.  Bits past the end of the sentence are always zero.  Sentences
+ * of up to kInlineWords * 64 words are stored inside the object; longer
+ * ones fall back to a heap-allocated vector.
  */
 class Bitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap);
 private:
-  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
+  static const size_t kInlineWords = 4;
+
+  uint64_t m_inline[kInlineWords]; //! Ticks of words in sentence that have been done.
+  std::vector<uint64_t> m_heap; //! Used instead of m_inline for long sentences.
+  uint64_t *m_words; //! Points to m_inline or m_heap.
+  size_t m_size;
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
 
+  static size_t NumWords(size_t size) {
+    return (size + 63) >> 6;
+  }
+
+  static size_t LowestBit(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    size_t ret = 0;
+    while (!(word & 1)) {
+      word >>= 1;
+      ++ret;
+    }
+    return ret;
+#endif
+  }
+
+  static size_t HighestBit(uint64_t word) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(word);
+#else
+    size_t ret = 63;
+    while (!(word >> 63)) {
+      word <<= 1;
+      --ret;
+    }
+    return ret;
+#endif
+  }
+
+  static size_t CountBits(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    size_t ret = 0;
+    for (; word; word &= word - 1) ++ret;
+    return ret;
+#endif
+  }
+
+  //! bits of word index that fall within [startPos, endPos]
+  static uint64_t WordMask(size_t index, size_t startPos, size_t endPos) {
+    const size_t first = index << 6, last = first + 63;
+    uint64_t mask = ~uint64_t(0);
+    if (startPos > first) mask <<= startPos - first;
+    if (endPos < last) mask &= ~uint64_t(0) >> (last - endPos);
+    return mask;
+  }
+
+  //! allocate zeroed storage for size positions
+  void Init(size_t size);
+
+  //! first position >= pos whose value is value, or NOT_FOUND
+  size_t FindNext(size_t pos, bool value) const {
+    if (pos >= m_size) return NOT_FOUND;
+    const size_t numWords = NumWords(m_size);
+    size_t index = pos >> 6;
+    uint64_t word = (value ? m_words[index] : ~m_words[index])
+                    & (~uint64_t(0) << (pos & 63));
+    while (!word) {
+      if (++index == numWords) return NOT_FOUND;
+      word = value ? m_words[index] : ~m_words[index];
+    }
+    // inverted padding bits look like gaps past the end
+    size_t ret = (index << 6) + LowestBit(word);
+    return ret < m_size ? ret : NOT_FOUND;
+  }
+
+  //! last position <= pos whose value is value, or NOT_FOUND
+  size_t FindPrev(size_t pos, bool value) const {
+    size_t index = pos >> 6;
+    uint64_t word = (value ? m_words[index] : ~m_words[index])
+                    & (~uint64_t(0) >> (63 - (pos & 63)));
+    while (!word) {
+      if (index == 0) return NOT_FOUND;
+      --index;
+      word = value ? m_words[index] : ~m_words[index];
+    }
+    return (index << 6) + HighestBit(word);
+  }
+
   /** Update the first gap, when bits are flipped */
   void UpdateFirstGap(size_t startPos, size_t endPos, bool value) {
     if (value) {
       //may remove gap
       if (startPos <= m_firstGap && m_firstGap <= endPos) {
-        m_firstGap = NOT_FOUND;
-        for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
-          if (!m_bitmap[i]) {
-            m_firstGap = i;
-            break;
-          }
-        }
+        m_firstGap = FindNext(endPos + 1, false);
       }
 
     } else {
@@ -86,8 +165,8 @@ private:
     size_t startPos = range.GetStartPos();
     size_t endPos = range.GetEndPos();
 
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = true;
+    for (size_t index = startPos >> 6; index <= endPos >> 6; ++index) {
+      m_words[index] |= WordMask(index, startPos, endPos);
     }
 
     m_numWordsCovered += range.GetNumWordsCovered();
@@ -116,41 +195,33 @@ public:
     return m_firstGap;
   }
 
+  //! position of 1st word not yet translated at or after pos, or NOT_FOUND
+  size_t GetNextGapPos(size_t pos) const {
+    return FindNext(pos, false);
+  }
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return m_size ? FindPrev(m_size - 1, false) : NOT_FOUND;
   }
 
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return m_size ? FindPrev(m_size - 1, true) : NOT_FOUND;
   }
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return bool(m_bitmap[pos]);
+    return (m_words[pos >> 6] >> (pos & 63)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    bool origValue = m_bitmap[pos];
+    bool origValue = GetValue(pos);
     if (origValue == value) {
       // do nothing
     } else {
-      m_bitmap[pos] = value;
+      m_words[pos >> 6] ^= uint64_t(1) << (pos & 63);
       UpdateFirstGap(pos, pos, value);
       if (value) {
         ++m_numWordsCovered;
@@ -166,40 +237,38 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const Range &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos();
+    size_t endPos = compare.GetEndPos();
+    for (size_t index = startPos >> 6; index <= endPos >> 6; ++index) {
+      if (m_words[index] & WordMask(index, startPos, endPos))
         return true;
     }
     return false;
   }
   //! number of elements
   size_t GetSize() const {
-    return m_bitmap.size();
+    return m_size;
   }
 
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
-    }
-    return l;
+    size_t covered = FindPrev(l - 1, true);
+    return covered == NOT_FOUND ? 0 : covered + 1;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_bitmap.size()) return r;
-    return (
-             std::find(m_bitmap.begin() + r + 1, m_bitmap.end(), true) -
-             m_bitmap.begin()
-           ) - 1;
+    if (r+1 == m_size) return r;
+    size_t covered = FindNext(r + 1, true);
+    return (covered == NOT_FOUND ? m_size : covered) - 1;
   }
 
 
   //! converts bitmap into an integer ID: it consists of two parts: the first 16 bit are the pattern between the first gap and the last word-1, the second 16 bit are the number of filled positions. enforces a sentence length limit of 65535 and a max distortion of 16
   WordsBitmapID GetID() const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -214,10 +283,10 @@ public:
 
   //! converts bitmap into an integer ID, with an additional span covered
   WordsBitmapID GetIDPlus( size_t startPos, size_t endPos ) const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
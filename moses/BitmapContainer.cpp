@@ -225,7 +225,7 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
     hypothesis.GetManager().GetSentenceStats().StartTimeBuildHyp();
   }
   const Bitmap &bitmap = m_parent.GetWordsBitmap();
-  Hypothesis *newHypo = new Hypothesis(hypothesis, transOpt, bitmap, hypothesis.GetManager().GetNextHypoId());
+  Hypothesis *newHypo = Hypothesis::Create(hypothesis, transOpt, bitmap);
   IFVERBOSE(2) {
     hypothesis.GetManager().GetSentenceStats().StopTimeBuildHyp();
   }
@@ -311,7 +311,7 @@ BitmapContainer::~BitmapContainer()
     HypothesisQueueItem *item = m_queue.top();
     m_queue.pop();
 
-    delete item->GetHypothesis();
+    Hypothesis::Release(item->GetHypothesis());
     delete item;
   }
 
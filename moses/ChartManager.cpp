@@ -28,6 +28,7 @@
 #include "HypergraphOutput.h"
 #include "StaticData.h"
 #include "DecodeStep.h"
+#include "Timer.h"
 #include "TreeInput.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/WordPenaltyProducer.h"
@@ -78,6 +79,10 @@ void ChartManager::Decode()
 
   AddXmlChartOptions();
 
+  // option collection and search alternate cell by cell; the timers
+  // accumulate over all cells
+  Timer collectOptsTime, searchTime;
+
   // MAIN LOOP
   size_t size = m_source.GetSize();
   for (int startPos = size-1; startPos >= 0; --startPos) {
@@ -86,14 +91,17 @@ void ChartManager::Decode()
       Range range(startPos, endPos);
 
       // create trans opt
+      collectOptsTime.start();
       m_translationOptionList.Clear();
       m_parser.Create(range, m_translationOptionList);
       m_translationOptionList.ApplyThreshold(options()->search.trans_opt_threshold);
 
       const InputPath &inputPath = m_parser.GetInputPath(range);
       m_translationOptionList.EvaluateWithSourceContext(m_source, inputPath);
+      collectOptsTime.stop();
 
       // decode
+      searchTime.start();
       ChartCell &cell = m_hypoStackColl.Get(range);
       cell.Decode(m_translationOptionList, m_hypoStackColl);
 
@@ -101,8 +109,11 @@ void ChartManager::Decode()
       cell.PruneToSize();
       cell.CleanupArcList();
       cell.SortHypotheses();
+      searchTime.stop();
     }
   }
+  m_timeCollectOpts = collectOptsTime.get_elapsed_time();
+  m_timeSearch = searchTime.get_elapsed_time();
 
   IFVERBOSE(1) {
 
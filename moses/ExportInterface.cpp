@@ -37,6 +37,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 
+#include "FactorCollection.h"
+#include "TranslationOptionCache.h"
 #include "Hypothesis.h"
 #include "Manager.h"
 #include "StaticData.h"
@@ -195,7 +197,9 @@ batch_run()
   }
 
 #ifdef WITH_THREADS
-  ThreadPool pool(staticData.ThreadCount());
+  ThreadPool pool(staticData.ThreadCount(),
+                  staticData.CpuAffinityOffset(),
+                  staticData.CpuAffinityIncrement());
 #endif
 
   // using context for adaptation:
@@ -296,6 +300,10 @@ batch_run()
 
   FeatureFunction::Destroy();
 
+  VERBOSE(1, FactorCollection::Instance().GetStats() << endl);
+  if (TranslationOptionCache::Instance().IsEnabled()) {
+    VERBOSE(1, TranslationOptionCache::Instance().GetStats() << endl);
+  }
   IFVERBOSE(1) util::PrintUsage(std::cerr);
 
 #ifndef EXIT_RETURN
@@ -7,6 +7,7 @@
 namespace Moses
 {
 class FFState;
+class TranslationOptionList;
 
 namespace Syntax
 {
@@ -63,6 +64,17 @@ public:
     return 0; /* FIXME */
   }
 
+  /**
+   * Called once before prev_hypo is extended with every option in options.
+   * Features whose EvaluateWhenApplied is bound by memory latency can use it
+   * to issue prefetches for the whole batch.  It must not change any scores.
+   */
+  virtual void PrefetchWhenApplied(
+    const Hypothesis& /* prev_hypo */,
+    const FFState* /* prev_state */,
+    const TranslationOptionList& /* options */) const {
+  }
+
   //! return the state associated with the empty hypothesis for a given sentence
   virtual const FFState* EmptyHypothesisState(const InputType &input) const = 0;
 
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/thread/locks.hpp>
 #endif
+#include <algorithm>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
@@ -35,54 +36,149 @@ namespace Moses
 {
 FactorCollection FactorCollection::s_instance;
 
+FactorCollection::ThreadCache::ThreadCache()
+  : cacheHits(0)
+  , lookups(0)
+{
+  std::fill(terminals, terminals + CACHE_SIZE, static_cast<const Factor*>(NULL));
+  std::fill(nonTerminals, nonTerminals + CACHE_SIZE, static_cast<const Factor*>(NULL));
+}
+
+FactorCollection::FactorCollection()
+  :
+#ifdef WITH_THREADS
+  m_threadCache(&FactorCollection::RetireThreadCache),
+#endif
+  m_factorIdNonTerminal(0)
+  , m_factorId(moses_MaxNumNonterminals)
+{
+}
+
+#ifdef WITH_THREADS
+void FactorCollection::RetireThreadCache(ThreadCache *cache)
+{
+  FactorCollection &coll = s_instance;
+  {
+    boost::unique_lock<boost::mutex> lock(coll.m_statsLock);
+    coll.m_retiredStats.cacheHits += cache->cacheHits;
+    coll.m_retiredStats.lookups += cache->lookups;
+    coll.m_threadCaches.erase(std::find(coll.m_threadCaches.begin(), coll.m_threadCaches.end(), cache));
+  }
+  delete cache;
+}
+#endif
+
+FactorCollection::ThreadCache &FactorCollection::GetThreadCache()
+{
+#ifdef WITH_THREADS
+  ThreadCache *cache = m_threadCache.get();
+  if (cache == NULL) {
+    cache = new ThreadCache();
+    m_threadCache.reset(cache);
+    boost::unique_lock<boost::mutex> lock(m_statsLock);
+    m_threadCaches.push_back(cache);
+  }
+  return *cache;
+#else
+  return m_threadCache;
+#endif
+}
+
 const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+  const uint64_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
+
+  // thread-local front cache, no locking
+  ThreadCache &cache = GetThreadCache();
+  const Factor *&cached = (isNonTerminal ? cache.nonTerminals : cache.terminals)[(hash >> 6) % CACHE_SIZE];
+  if (cached && cached->GetString() == factorString) {
+    ++cache.cacheHits;
+    return cached;
+  }
+  ++cache.lookups;
+
   FactorFriend to_ins;
   to_ins.in.m_string = factorString;
-  to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
+  Shard &shard = m_shards[hash % NUM_SHARDS];
+  Set & set = (isNonTerminal) ? shard.nonTerminals : shard.terminals;
   // If we're threaded, hope a read-only lock is sufficient.
 #ifdef WITH_THREADS
   {
     // read=lock scope
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+    boost::shared_lock<boost::shared_mutex> read_lock(shard.accessLock);
     Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
+    if (i != set.end()) return cached = &i->in;
   }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+  boost::unique_lock<boost::shared_mutex> lock(shard.accessLock);
+  // another thread may have inserted it in the meantime
+  Set::const_iterator i = set.find(to_ins);
+  if (i != set.end()) return cached = &i->in;
 #endif // WITH_THREADS
-  std::pair<Set::iterator, bool> ret(set.insert(to_ins));
-  if (ret.second) {
-    ret.first->in.m_string.set(
-      memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
-      factorString.size());
+  {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::mutex> id_lock(m_idLock);
+#endif
     if (isNonTerminal) {
-      m_factorIdNonTerminal++;
+      to_ins.in.m_id = m_factorIdNonTerminal++;
       UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
     } else {
-      m_factorId++;
+      to_ins.in.m_id = m_factorId++;
     }
   }
-  return &ret.first->in;
+  std::pair<Set::iterator, bool> ret(set.insert(to_ins));
+  ret.first->in.m_string.set(
+    memcpy(shard.stringBacking.Allocate(factorString.size()), factorString.data(), factorString.size()),
+    factorString.size());
+  return cached = &ret.first->in;
 }
 
 const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
 {
+  const uint64_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
+
+  ThreadCache &cache = GetThreadCache();
+  const Factor *&cached = (isNonTerminal ? cache.nonTerminals : cache.terminals)[(hash >> 6) % CACHE_SIZE];
+  if (cached && cached->GetString() == factorString) {
+    ++cache.cacheHits;
+    return cached;
+  }
+  ++cache.lookups;
+
   FactorFriend to_find;
   to_find.in.m_string = factorString;
-  to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
+  const Shard &shard = m_shards[hash % NUM_SHARDS];
+  const Set & set = (isNonTerminal) ? shard.nonTerminals : shard.terminals;
   {
     // read=lock scope
 #ifdef WITH_THREADS
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+    boost::shared_lock<boost::shared_mutex> read_lock(shard.accessLock);
 #endif // WITH_THREADS
     Set::const_iterator i = set.find(to_find);
-    if (i != set.end()) return &i->in;
+    if (i != set.end()) return cached = &i->in;
   }
   return NULL;
 }
 
+FactorCollectionStats FactorCollection::GetStats() const
+{
+  FactorCollectionStats ret;
+#ifdef WITH_THREADS
+  {
+    boost::unique_lock<boost::mutex> lock(m_statsLock);
+    ret = m_retiredStats;
+    for (size_t i = 0; i < m_threadCaches.size(); ++i) {
+      ret.cacheHits += m_threadCaches[i]->cacheHits;
+      ret.lookups += m_threadCaches[i]->lookups;
+    }
+  }
+  boost::unique_lock<boost::mutex> id_lock(m_idLock);
+#else
+  ret.cacheHits = m_threadCache.cacheHits;
+  ret.lookups = m_threadCache.lookups;
+#endif
+  ret.inserts = m_factorIdNonTerminal + (m_factorId - moses_MaxNumNonterminals);
+  return ret;
+}
 
 FactorCollection::~FactorCollection() {}
 
@@ -91,15 +187,23 @@ TO_STRING_BODY(FactorCollection);
 // friend
 ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 {
+  for (size_t shard = 0; shard < FactorCollection::NUM_SHARDS; ++shard) {
+    const FactorCollection::Shard &s = factorCollection.m_shards[shard];
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
+    boost::shared_lock<boost::shared_mutex> lock(s.accessLock);
 #endif
-  for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
-    out << i->in;
+    for (FactorCollection::Set::const_iterator i = s.nonTerminals.begin(); i != s.nonTerminals.end(); ++i) {
+      out << i->in;
+    }
   }
   return out;
 }
 
+ostream& operator<<(ostream& out, const FactorCollectionStats& stats)
+{
+  out << "factor lookups: " << stats.cacheHits << " cache hits, "
+      << stats.lookups << " table lookups, " << stats.inserts << " inserts";
+  return out;
 }
 
-
+}
@@ -28,7 +28,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
 #include "util/murmur_hash.hh"
@@ -36,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <functional>
 #include <string>
+#include <vector>
 
 #include "util/string_piece.hh"
 #include "util/pool.hh"
@@ -55,6 +58,17 @@ struct FactorFriend {
   Factor in;
 };
 
+/** lookup counters of the FactorCollection, summed over all threads */
+struct FactorCollectionStats {
+  size_t cacheHits; /**< lookups answered by the thread-local front cache */
+  size_t lookups; /**< lookups that went to the shared table */
+  size_t inserts; /**< factors created */
+
+  FactorCollectionStats() : cacheHits(0), lookups(0), inserts(0) {}
+};
+
+std::ostream& operator<<(std::ostream&, const FactorCollectionStats&);
+
 /** collection of factors
  *
  * All Factors in moses are accessed and created by a FactorCollection.
@@ -62,6 +76,11 @@ struct FactorFriend {
  * from being created on the stack, etc), their memory addresses can
  * be used as keys to uniquely identify them.
  * Only 1 FactorCollection object should be created.
+ *
+ * The table is split into shards by string hash, each with its own lock and
+ * string pool, so that threads tokenizing input rarely contend. In front of
+ * the shards, each thread keeps a small direct-mapped cache of the factors
+ * it looked up recently, which answers most lookups without any locking.
  */
 class FactorCollection
 {
@@ -78,25 +97,51 @@ class FactorCollection
     }
   };
   typedef boost::unordered_set<FactorFriend, HashFactor, EqualsFactor> Set;
-  Set m_set;
-  Set m_setNonTerminal;
 
-  util::Pool m_string_backing;
+  static const size_t NUM_SHARDS = 64;
+  static const size_t CACHE_SIZE = 2048; // entries in each thread's front cache
 
-  static FactorCollection s_instance;
+  struct Shard {
+    Set terminals;
+    Set nonTerminals;
+    util::Pool stringBacking;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+    //reader-writer lock
+    mutable boost::shared_mutex accessLock;
 #endif
+  };
+  Shard m_shards[NUM_SHARDS];
+
+  //! per-thread front cache. Counters are only written by the owning thread
+  struct ThreadCache {
+    const Factor *terminals[CACHE_SIZE];
+    const Factor *nonTerminals[CACHE_SIZE];
+    size_t cacheHits;
+    size_t lookups;
+
+    ThreadCache();
+  };
+
+#ifdef WITH_THREADS
+  std::vector<ThreadCache*> m_threadCaches; /**< all live thread caches, for the counters */
+  FactorCollectionStats m_retiredStats; /**< counters of threads that have exited */
+  mutable boost::mutex m_statsLock; // guards the two above
+  mutable boost::mutex m_idLock; // guards the id counters
+  // declared after the members above, as its destructor retires the cache of the current thread
+  boost::thread_specific_ptr<ThreadCache> m_threadCache;
+  static void RetireThreadCache(ThreadCache *cache);
+#else
+  ThreadCache m_threadCache;
+#endif
+  ThreadCache &GetThreadCache();
+
+  static FactorCollection s_instance;
 
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
   size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
   //! constructor. only the 1 static variable can be created
-  FactorCollection()
-    : m_factorIdNonTerminal(0)
-    , m_factorId(moses_MaxNumNonterminals) {
-  }
+  FactorCollection();
 
 public:
   static FactorCollection& Instance() {
@@ -116,6 +161,9 @@ public:
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal = false);
 
+  /** lookup counters. Only approximate while other threads are adding factors */
+  FactorCollectionStats GetStats() const;
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString, bool isNonTerminal = false) {
     return AddFactor(factorString, isNonTerminal);
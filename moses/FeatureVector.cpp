@@ -162,8 +162,26 @@ bool FName::operator!=(const FName& rhs) const
   return ! (*this == rhs);
 }
 
+FVector::FNVmap FVector::s_noFeatures;
+
 FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
 
+FVector::FVector(const FVector& rhs)
+  : m_features(rhs.hasSparseFeatures() ? new FNVmap(*rhs.m_features) : NULL)
+  , m_coreFeatures(rhs.m_coreFeatures)
+{}
+
+FVector& FVector::operator=( const FVector& rhs )
+{
+  if (rhs.hasSparseFeatures()) {
+    sparse() = *rhs.m_features;
+  } else if (m_features) {
+    m_features->clear();
+  }
+  m_coreFeatures = rhs.m_coreFeatures;
+  return *this;
+}
+
 void FVector::resize(size_t newsize)
 {
   valarray<FValue> oldValues(m_coreFeatures);
@@ -176,7 +194,7 @@ void FVector::resize(size_t newsize)
 void FVector::clear()
 {
   m_coreFeatures.resize(m_coreFeatures.size(), 0);
-  m_features.clear();
+  m_features.reset();
 }
 
 bool FVector::load(const std::string& filename)
@@ -305,8 +323,11 @@ ostream& operator<<(ostream& out, const FVector& fv)
 const FValue& FVector::get(const FName& name) const
 {
   static const FValue DEFAULT = 0;
-  const_iterator fi = m_features.find(name);
-  if (fi == m_features.end()) {
+  if (!m_features) {
+    return DEFAULT;
+  }
+  const_iterator fi = m_features->find(name);
+  if (fi == m_features->end()) {
     return DEFAULT;
   } else {
     return fi->second;
@@ -315,8 +336,11 @@ const FValue& FVector::get(const FName& name) const
 
 FValue FVector::getBackoff(const FName& name, float backoff) const
 {
-  const_iterator fi = m_features.find(name);
-  if (fi == m_features.end()) {
+  if (!m_features) {
+    return backoff;
+  }
+  const_iterator fi = m_features->find(name);
+  if (fi == m_features->end()) {
     return backoff;
   } else {
     return fi->second;
@@ -351,7 +375,7 @@ void FVector::capMin(FValue minValue)
 
 void FVector::set(const FName& name, const FValue& value)
 {
-  m_features[name] = value;
+  sparse()[name] = value;
 }
 
 void FVector::printCoreFeatures()
@@ -370,10 +394,11 @@ FVector& FVector::operator+= (const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) + i->second);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  if (rhs.m_features) {
+    for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
+      set(i->first, get(i->first) + i->second);
+  }
+  corePlusEquals(rhs);
   return *this;
 }
 
@@ -389,8 +414,13 @@ void FVector::corePlusEquals(const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  if (rhs.m_coreFeatures.size() == m_coreFeatures.size()) {
+    // common case: whole-array operation, which the compiler can vectorise
+    m_coreFeatures += rhs.m_coreFeatures;
+  } else {
+    for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
+      m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  }
 }
 
 // assign only core features
@@ -451,7 +481,7 @@ size_t FVector::pruneSparseFeatures(size_t threshold)
   }
 
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
 
   return count;
 }
@@ -471,7 +501,7 @@ size_t FVector::pruneZeroWeightFeatures()
   }
 
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
 
   return count;
 }
@@ -726,7 +756,7 @@ size_t FVector::l1regularize(float lambda)
 
   // erase features that have become zero
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
   numberPruned -= size();
   return numberPruned;
 }
@@ -776,7 +806,7 @@ size_t FVector::sparseL1regularize(float lambda)
 
   // erase features that have become zero
   for (size_t i = 0; i < toErase.size(); ++i)
-    m_features.erase(toErase[i]);
+    m_features->erase(toErase[i]);
   numberPruned -= size();
   return numberPruned;
 }
@@ -806,8 +836,10 @@ FValue FVector::inner_product(const FVector& rhs) const
 {
   assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
   FValue product = 0.0;
-  for (const_iterator i = cbegin(); i != cend(); ++i) {
-    product += ((i->second)*(rhs.get(i->first)));
+  if (m_features && rhs.m_features) {
+    for (const_iterator i = cbegin(); i != cend(); ++i) {
+      product += ((i->second)*(rhs.get(i->first)));
+    }
   }
   for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
     product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
@@ -830,10 +862,10 @@ void FVector::merge(const FVector &other)
 
   // sparse
   FNVmap::const_iterator iter;
-  for (iter = other.m_features.begin(); iter != other.m_features.end(); ++iter) {
+  for (iter = other.cbegin(); iter != other.cend(); ++iter) {
     const FName  &otherKey = iter->first;
     const FValue otherVal = iter->second;
-    m_features[otherKey] = otherVal;
+    set(otherKey, otherVal);
   }
 }
 
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <vector>
 
 #include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/unordered_map.hpp>
 
 #ifdef MPI_ENABLE
@@ -123,18 +124,18 @@ class ProxyFVector;
 
 /**
  * A sparse feature (or weight) vector.
+ * The map for the sparse features is only allocated once a sparse feature is
+ * set, so vectors with core features only (most hypotheses and translation
+ * options) are cheap to copy and add.
  **/
 class FVector
 {
 public:
   /** Empty feature vector */
   FVector(size_t coreFeatures = 0);
+  FVector(const FVector& rhs);
 
-  FVector& operator=( const FVector& rhs ) {
-    m_features = rhs.m_features;
-    m_coreFeatures = rhs.m_coreFeatures;
-    return *this;
-  }
+  FVector& operator=( const FVector& rhs );
 
   /*
    * Change the number of core features
@@ -146,20 +147,24 @@ public:
   typedef FNVmap::iterator iterator;
   typedef FNVmap::const_iterator const_iterator;
   iterator begin() {
-    return m_features.begin();
+    return m_features ? m_features->begin() : s_noFeatures.begin();
   }
   iterator end() {
-    return m_features.end();
+    return m_features ? m_features->end() : s_noFeatures.end();
   }
   const_iterator cbegin() const {
-    return m_features.cbegin();
+    return m_features ? m_features->cbegin() : s_noFeatures.cbegin();
   }
   const_iterator cend() const {
-    return m_features.cend();
+    return m_features ? m_features->cend() : s_noFeatures.cend();
   }
 
   bool hasNonDefaultValue(FName name) const {
-    return m_features.find(name) != m_features.end();
+    return m_features && m_features->find(name) != m_features->end();
+  }
+
+  bool hasSparseFeatures() const {
+    return m_features && !m_features->empty();
   }
   void clear();
 
@@ -177,7 +182,7 @@ public:
 
   /** Size */
   size_t size() const {
-    return m_features.size() + m_coreFeatures.size();
+    return (m_features ? m_features->size() : 0) + m_coreFeatures.size();
   }
 
   size_t coreSize() const {
@@ -272,9 +277,18 @@ private:
   FValue getBackoff(const FName& name, float backoff) const;
   void set(const FName& name, const FValue& value);
 
-  FNVmap m_features;
+  /** Sparse map, allocated on first use */
+  FNVmap &sparse() {
+    if (!m_features) m_features.reset(new FNVmap());
+    return *m_features;
+  }
+
+  boost::scoped_ptr<FNVmap> m_features;
   std::valarray<FValue> m_coreFeatures;
 
+  //! iterated over when there are no sparse features. Never modified
+  static FNVmap s_noFeatures;
+
 #ifdef MPI_ENABLE
   //serialization
   template<class Archive>
@@ -314,7 +328,7 @@ private:
 
 inline void swap(FVector &first, FVector &second)
 {
-  swap(first.m_features, second.m_features);
+  first.m_features.swap(second.m_features);
   swap(first.m_coreFeatures, second.m_coreFeatures);
 }
 
@@ -367,15 +381,15 @@ public:
    }*/
 
   FValue operator++() {
-    return ++m_fv->m_features[m_name];
+    return ++m_fv->sparse()[m_name];
   }
 
   FValue operator +=(FValue lhs) {
-    return (m_fv->m_features[m_name] += lhs);
+    return (m_fv->sparse()[m_name] += lhs);
   }
 
   FValue operator -=(FValue lhs) {
-    return (m_fv->m_features[m_name] -= lhs);
+    return (m_fv->sparse()[m_name] -= lhs);
   }
 
 private:
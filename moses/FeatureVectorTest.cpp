@@ -306,6 +306,32 @@ BOOST_AUTO_TEST_CASE(ip)
   BOOST_CHECK_CLOSE((FValue)p1, 1.1*0.5 + -0.1*0.25 + 2.2*2.4, TOL);
 }
 
+BOOST_AUTO_TEST_CASE(copy)
+{
+  FVector f1(2);
+  FName n1("a");
+  f1[0] = 1.1;
+  f1[1] = -0.1;
+  FVector f2(f1);
+  BOOST_CHECK(!f2.hasSparseFeatures());
+  BOOST_CHECK_EQUAL(f2.size(),2);
+
+  f1[n1] = 2.2;
+  BOOST_CHECK(f1.hasSparseFeatures());
+  f2 = f1;
+  f1[n1] = 0.5;
+  BOOST_CHECK_CLOSE((FValue)f2[n1], 2.2, TOL);
+  BOOST_CHECK_CLOSE(f2[0], 1.1, TOL);
+
+  f2 += f1;
+  BOOST_CHECK_CLOSE((FValue)f2[n1], 2.7, TOL);
+  BOOST_CHECK_CLOSE(f2[1], -0.2, TOL);
+
+  f2 = FVector(2);
+  BOOST_CHECK(!f2.hasSparseFeatures());
+  BOOST_CHECK_EQUAL(f2.size(),2);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -104,15 +104,39 @@ Hypothesis::
   if (m_arcList) {
     ArcList::iterator iter;
     for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
-      delete *iter;
+      Release(*iter);
     }
     m_arcList->clear();
 
-    delete m_arcList;
+    m_manager.GetArcListPool().freeObject(m_arcList);
     m_arcList = NULL;
   }
 }
 
+Hypothesis *
+Hypothesis::
+Create(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt, const Bitmap &bitmap)
+{
+  HypothesisPool &pool = manager.GetHypothesisPool();
+  return new (pool.getPtr()) Hypothesis(manager, source, initialTransOpt, bitmap, manager.GetNextHypoId());
+}
+
+Hypothesis *
+Hypothesis::
+Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Bitmap &bitmap)
+{
+  Manager &manager = prevHypo.GetManager();
+  HypothesisPool &pool = manager.GetHypothesisPool();
+  return new (pool.getPtr()) Hypothesis(prevHypo, transOpt, bitmap, manager.GetNextHypoId());
+}
+
+void
+Hypothesis::
+Release(Hypothesis *hypo)
+{
+  hypo->GetManager().GetHypothesisPool().freeObject(hypo);
+}
+
 void
 Hypothesis::
 AddArc(Hypothesis *loserHypo)
@@ -122,7 +146,7 @@ AddArc(Hypothesis *loserHypo)
       this->m_arcList = loserHypo->m_arcList;  // take ownership, we'll delete
       loserHypo->m_arcList = 0;                // prevent a double deletion
     } else {
-      this->m_arcList = new ArcList();
+      this->m_arcList = m_manager.GetArcListPool().get();
     }
   } else {
     if (loserHypo->m_arcList) {  // both have an arc list: merge. delete loser
@@ -130,7 +154,7 @@ AddArc(Hypothesis *loserHypo)
       size_t add_size = loserHypo->m_arcList->size();
       this->m_arcList->resize(my_size + add_size, 0);
       std::memcpy(&(*m_arcList)[0] + my_size, &(*loserHypo->m_arcList)[0], add_size * sizeof(Hypothesis *));
-      delete loserHypo->m_arcList;
+      m_manager.GetArcListPool().freeObject(loserHypo->m_arcList);
       loserHypo->m_arcList = 0;
     } else { // loserHypo doesn't have any arcs
       // DO NOTHING
@@ -182,6 +206,21 @@ EvaluateWhenApplied(float estimatedScore)
   if (m_prevHypo) m_futureScore += m_prevHypo->GetScore();
 }
 
+void
+Hypothesis::
+PrefetchWhenApplied(const TranslationOptionList &options) const
+{
+  const StaticData &staticData = StaticData::Instance();
+  const vector<const StatefulFeatureFunction*>& ffs =
+    StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (unsigned i = 0; i < ffs.size(); ++i) {
+    const StatefulFeatureFunction &ff = *ffs[i];
+    if(!staticData.IsFeatureFunctionIgnored(ff)) {
+      ff.PrefetchWhenApplied(*this, m_ffStates[i], options);
+    }
+  }
+}
+
 const Hypothesis* Hypothesis::GetPrevHypo()const
 {
   return m_prevHypo;
@@ -248,7 +287,7 @@ CleanupArcList(size_t nBestSize, bool distinctNBest)
 
     // delete bad ones
     ArcList::iterator i = m_arcList->begin() + nBestSize;
-    while (i != m_arcList->end()) delete *i++;
+    while (i != m_arcList->end()) Release(*i++);
     m_arcList->erase(m_arcList->begin() + nBestSize, m_arcList->end());
   }
 
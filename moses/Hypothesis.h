@@ -44,6 +44,7 @@ namespace Moses
 class SquareMatrix;
 class StaticData;
 class TranslationOption;
+class TranslationOptionList;
 class Range;
 class Hypothesis;
 class FFState;
@@ -53,6 +54,8 @@ class Manager;
 struct ReportingOptions;
 
 typedef std::vector<Hypothesis*> ArcList;
+typedef ObjectPool<Hypothesis> HypothesisPool;
+typedef ObjectPool<ArcList> ArcListPool;
 
 /** Used to store a state in the beam search
     for the best translation. With its link back to the previous hypothesis
@@ -92,6 +95,15 @@ public:
   Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Bitmap &bitmap, int id);
   ~Hypothesis();
 
+  /*! allocate a hypothesis from the object pool of the sentence's manager.
+   *  The search uses these instead of new, so that all hypotheses of a sentence
+   *  are released at once when the manager is destroyed */
+  static Hypothesis *Create(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt, const Bitmap &bitmap);
+  static Hypothesis *Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Bitmap &bitmap);
+  /*! return a hypothesis created by Create() to its pool. The object is
+   *  destroyed when its memory is reused, or with the pool */
+  static void Release(Hypothesis *hypo);
+
   void PrintHypothesis() const;
 
   const InputType& GetInput() const {
@@ -122,6 +134,10 @@ public:
 
   void EvaluateWhenApplied(float estimatedScore);
 
+  /** let stateful feature functions prepare for extending this hypothesis
+   * with each of the given options, before any of them is evaluated */
+  void PrefetchWhenApplied(const TranslationOptionList &options) const;
+
   int GetId()const {
     return m_id;
   }
@@ -23,8 +23,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_LanguageModelKen_h
 
 #include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "lm/state.hh"
 #include "lm/word_index.hh"
 #include "util/mmap.hh"
 
@@ -37,12 +46,80 @@ namespace Moses {
 
 //class LanguageModel;
 class FFState;
+class TranslationOptionList;
 
 LanguageModel* ConstructKenLM(const std::string& line);
 
 //! This will also load. Returns a templated KenLM class
 LanguageModel* ConstructKenLM(const std::string& line, const std::string& file, FactorType factorType, util::LoadMethod load_method);
 
+/*
+ * Results of lm::ngram::RuleScore for the rules applied by chart and syntax
+ * decoding.  A rule is identified by its target words and the states of its
+ * non-terminals, so hypotheses built from the same rule over subderivations
+ * with the same boundary words share an entry.  Each decoding thread has its
+ * own memo, cleared after each sentence by decoders that report the end of a
+ * sentence.  The entries only depend on the model, so a memo kept longer is
+ * still correct.
+ */
+class KenChartMemo {
+public:
+    // Stand-ins for the items of a rule that are not words.
+    static const lm::WordIndex kNonTerminal = static_cast<lm::WordIndex>(-1);
+    static const lm::WordIndex kBeginSentence = static_cast<lm::WordIndex>(-2);
+
+    struct Key {
+        std::vector<lm::WordIndex> words;
+        // One per kNonTerminal in words.
+        std::vector<lm::ngram::ChartState> states;
+
+        bool operator==(const Key& other) const
+        {
+            return words == other.words && states == other.states;
+        }
+    };
+
+    struct Value {
+        lm::ngram::ChartState state;
+        float score;
+    };
+
+    // Holds at most max_size entries; 0 turns off memoization.
+    explicit KenChartMemo(std::size_t max_size) : m_maxSize(max_size), m_hits(0), m_misses(0) {}
+
+    // For the caller to build keys in without allocating.
+    Key& Scratch()
+    {
+        return m_scratch;
+    }
+
+    const Value* Find(const Key& key);
+
+    void Add(const Key& key, const Value& value);
+
+    std::size_t Hits() const
+    {
+        return m_hits;
+    }
+    std::size_t Misses() const
+    {
+        return m_misses;
+    }
+
+    // Forget all entries and counts.
+    void Clear();
+
+private:
+    struct KeyHasher {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    boost::unordered_map<Key, Value, KeyHasher> m_entries;
+    Key m_scratch;
+    const std::size_t m_maxSize;
+    std::size_t m_hits, m_misses;
+};
+
 /*
  * An implementation of single factor LM using Kenneth's code.
  */
@@ -57,6 +134,8 @@ public:
 
     virtual FFState* EvaluateWhenApplied(const Hypothesis& hypo, const FFState* ps, ScoreComponentCollection* out) const;
 
+    virtual void PrefetchWhenApplied(const Hypothesis& prev_hypo, const FFState* ps, const TranslationOptionList& options) const;
+
     virtual FFState* EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection* accumulator) const;
 
     virtual FFState* EvaluateWhenApplied(const Syntax::SHyperedge& hyperedge, int featureID, ScoreComponentCollection* accumulator) const;
@@ -66,9 +145,19 @@ public:
 
     virtual bool IsUseable(const FactorMask& mask) const;
 
+    virtual void SetParameter(const std::string& key, const std::string& value);
+
 protected:
+    virtual void CleanUpAfterSentenceProcessing(const InputType& source);
+
     boost::shared_ptr<Model> m_ngram;
 
+    // With load=replicate, one copy per NUMA node; m_ngram is the first.
+    std::vector<boost::shared_ptr<Model> > m_replicas;
+
+    // The copy to query from the calling thread.
+    const Model& GetModel() const;
+
     const Factor* m_beginSentenceFactor;
 
     FactorType m_factorType;
@@ -87,6 +176,22 @@ protected:
 
     std::vector<lm::WordIndex> m_lmIdLookup;
 
+    // Entries per thread in the chart decoding memo, see KenChartMemo.
+    std::size_t m_chartMemoSize;
+#ifdef WITH_THREADS
+    mutable boost::thread_specific_ptr<KenChartMemo> m_chartMemo;
+#else
+    mutable boost::scoped_ptr<KenChartMemo> m_chartMemo;
+#endif
+
+    KenChartMemo& GetChartMemo() const;
+
+    // Score a rule given as a memo key.
+    float ScoreRule(const KenChartMemo::Key& rule, lm::ngram::ChartState& state) const;
+
+    // Score a rule and fill in state, consulting the memo first.
+    float ScoreRuleMemo(const KenChartMemo::Key& rule, lm::ngram::ChartState& state) const;
+
 private:
     LanguageModelKen(const LanguageModelKen<Model>& copy_from);
 
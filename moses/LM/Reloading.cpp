@@ -100,6 +100,8 @@ LanguageModel *ConstructReloadingLM(const std::string &line, const std::string &
       return new ReloadingLanguageModel<lm::ngram::ArrayTrieModel>(line, file, factorType, lazy);
     case lm::ngram::QUANT_ARRAY_TRIE:
       return new ReloadingLanguageModel<lm::ngram::QuantArrayTrieModel>(line, file, factorType, lazy);
+    case lm::ngram::QUANT_PROBING:
+      return new ReloadingLanguageModel<lm::ngram::QuantProbingModel>(line, file, factorType, lazy);
     default:
       UTIL_THROW2("Unrecognized kenlm model type " << model_type);
     }
@@ -69,6 +69,8 @@ Manager::Manager(ttasksptr const& ttask)
   : BaseManager(ttask)
   , interrupted_flag(0)
   , m_hypoId(0)
+  , m_arcListPool("ArcList", 1024)
+  , m_hypoPool("Hypothesis", 4096)
 {
   boost::shared_ptr<InputType> source = ttask->GetSource();
   m_transOptColl = source->CreateTranslationOptionCollection(ttask);
@@ -130,7 +132,10 @@ void Manager::Decode()
   IFVERBOSE(1) {
     GetSentenceStats().StartTimeCollectOpts();
   }
+  Timer collectOptsTime;
+  collectOptsTime.start();
   m_transOptColl->CreateTranslationOptions();
+  m_timeCollectOpts = collectOptsTime.get_elapsed_time();
 
   // some reporting on how long this took
   IFVERBOSE(1) {
@@ -145,6 +150,7 @@ void Manager::Decode()
   Timer searchTime;
   searchTime.start();
   m_search->Decode();
+  m_timeSearch = searchTime.get_elapsed_time();
   VERBOSE(1, "Line " << m_source.GetTranslationId()
           << ": Search took " << searchTime << " seconds" << endl);
   IFVERBOSE(2) {
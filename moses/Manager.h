@@ -120,6 +120,11 @@ protected:
   std::auto_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
 
+  // per-sentence memory for the search. The arc list pool must outlive the
+  // hypothesis pool, since hypotheses return their arc lists on destruction
+  ArcListPool m_arcListPool;
+  HypothesisPool m_hypoPool;
+
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
     std::vector< const Hypothesis* >* pConnectedList) const;
@@ -167,6 +172,13 @@ public:
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
 
+  HypothesisPool &GetHypothesisPool() {
+    return m_hypoPool;
+  }
+  ArcListPool &GetArcListPool() {
+    return m_arcListPool;
+  }
+
   void OutputLatticeMBRNBest(std::ostream& out, const std::vector<LatticeMBRSolution>& solutions,long translationId) const;
   void OutputBestHypo(const std::vector<Moses::Word>&  mbrBestHypo, std::ostream& out) const;
   void OutputBestHypo(const Moses::TrellisPath &path, std::ostream &out) const;
@@ -108,6 +108,9 @@ Parameter::Parameter()
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"cpu-affinity-offset", "pin decoding thread i to core offset + i * increment (default: no pinning)");
+  AddParam(search_opts,"cpu-affinity-increment", "core increment between decoding threads when pinning (default 1)");
+  AddParam(search_opts,"parallel-translation-options", "spread the creation of translation options for a sentence over the decoding threads (default false)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -255,6 +258,7 @@ Parameter::Parameter()
   AddParam(misc_opts,"mira", "do mira training");
   AddParam(misc_opts,"description", "Source language, target language, description");
   AddParam(misc_opts,"no-cache", "Disable all phrase-table caching. Default = false (ie. enable caching)");
+  AddParam(misc_opts,"persistent-transopt-cache-size", "Reuse translation options of up to this many source phrases across sentences. Default = 0 (disabled)");
   AddParam(misc_opts,"default-non-term-for-empty-range-only", "Don't add [X] to all ranges, just ranges where there isn't a source non-term. Default = false (ie. add [X] everywhere)");
   AddParam(misc_opts,"s2t-parsing-algorithm", "Which S2T parsing algorithm to use. 0=recursive CYK+, 1=scope-3 (default = 0)");
 
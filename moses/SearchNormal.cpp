@@ -74,7 +74,7 @@ void SearchNormal::Decode()
 {
   // initial seed hypothesis: nothing translated, no words produced
   const Bitmap &initBitmap = m_bitmaps.GetInitialBitmap();
-  Hypothesis *hypo = new Hypothesis(m_manager, m_source, m_initialTransOpt, initBitmap, m_manager.GetNextHypoId());
+  Hypothesis *hypo = Hypothesis::Create(m_manager, m_source, m_initialTransOpt, initBitmap);
 
   m_hypoStackColl[0]->AddPrune(hypo);
 
@@ -109,14 +109,16 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
   // no limit of reordering: only check for overlap
   if (m_options.reordering.max_distortion < 0) {
 
-    for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ; ++startPos) {
+    // jump from gap to gap; an extension cannot run past the end of its gap
+    for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ;
+         startPos = hypoBitmap.GetNextGapPos(startPos + 1)) {
+      const size_t gapEnd = hypoBitmap.GetEdgeToTheRightOf(startPos);
       TranslationOptionList const* tol;
       size_t endPos = startPos;
       for (tol = m_transOptColl.GetTranslationOptionList(startPos, endPos);
-           tol && endPos < sourceSize;
+           tol && endPos <= gapEnd;
            tol = m_transOptColl.GetTranslationOptionList(startPos, ++endPos)) {
         if (tol->size() == 0
-            || hypoBitmap.Overlap(Range(startPos, endPos))
             || !ReoConstraint.Check(hypoBitmap, startPos, endPos)) {
           continue;
         }
@@ -131,10 +133,10 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
   // There are reordering limits. Make sure they are not violated.
 
   Range prevRange = hypothesis.GetCurrSourceWordsRange();
-  for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ; ++startPos) {
-
-    // don't bother expanding phrases if the first position is already taken
-    if(hypoBitmap.GetValue(startPos)) continue;
+  // only start in uncovered positions, and stay within the gap
+  for (size_t startPos = hypoFirstGapPos ; startPos < sourceSize ;
+       startPos = hypoBitmap.GetNextGapPos(startPos + 1)) {
+    const size_t gapEnd = hypoBitmap.GetEdgeToTheRightOf(startPos);
 
     size_t maxSize = sourceSize - startPos;
     size_t maxSizePhrase = m_options.search.max_phrase_length;
@@ -169,11 +171,10 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
     TranslationOptionList const* tol;
     size_t endPos = startPos;
     for (tol = m_transOptColl.GetTranslationOptionList(startPos, endPos);
-         tol && endPos < sourceSize;
+         tol && endPos <= gapEnd;
          tol = m_transOptColl.GetTranslationOptionList(startPos, ++endPos)) {
       Range extRange(startPos, endPos);
       if (tol->size() == 0
-          || hypoBitmap.Overlap(extRange)
           || !ReoConstraint.Check(hypoBitmap, startPos, endPos)
           || (isWordLattice && !m_source.IsCoveragePossible(extRange))) {
         continue;
@@ -258,6 +259,10 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
   const Range &nextRange = transOpt.GetSourceWordsRange();
   const Bitmap &nextBitmap = m_bitmaps.GetBitmap(sourceCompleted, nextRange);
 
+  // all extensions share the same context, so stateful features can fetch
+  // what they need for the whole list up front
+  hypothesis.PrefetchWhenApplied(*tol);
+
   TranslationOptionList::const_iterator iter;
   for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
     const TranslationOption &transOpt = **iter;
@@ -288,7 +293,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     IFVERBOSE(2) {
       stats.StartTimeBuildHyp();
     }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
+    newHypo = Hypothesis::Create(hypothesis, transOpt, bitmap);
     IFVERBOSE(2) {
       stats.StopTimeBuildHyp();
     }
@@ -339,7 +344,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     IFVERBOSE(2) {
       stats.StartTimeBuildHyp();
     }
-    newHypo = new Hypothesis(hypothesis, transOpt, bitmap, m_manager.GetNextHypoId());
+    newHypo = Hypothesis::Create(hypothesis, transOpt, bitmap);
     if (newHypo==NULL) return;
     IFVERBOSE(2) {
       stats.StopTimeBuildHyp();
@@ -350,7 +355,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
       IFVERBOSE(2) {
         stats.AddEarlyDiscarded();
       }
-      delete newHypo;
+      Hypothesis::Release(newHypo);
       return;
     }
 
@@ -40,6 +40,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "FactorCollection.h"
 #include "Timer.h"
 #include "TranslationOption.h"
+#include "TranslationOptionCache.h"
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
 #include "ScoreComponentCollection.h"
@@ -142,6 +143,14 @@ StaticData
 {
   const PARAM_VEC *params;
 
+  m_parameter->SetParameter(m_cpuAffinityOffset, "cpu-affinity-offset", -1);
+  m_parameter->SetParameter(m_cpuAffinityIncr, "cpu-affinity-increment", 1);
+  m_parameter->SetParameter(m_parallelTransOpts, "parallel-translation-options", false);
+
+  size_t transOptCacheSize;
+  m_parameter->SetParameter(transOptCacheSize, "persistent-transopt-cache-size", (size_t) 0);
+  TranslationOptionCache::Instance().SetMaxSize(transOptCacheSize);
+
   m_threadCount = 1;
   params = m_parameter->GetParam("threads");
   if (params && params->size()) {
@@ -214,6 +223,22 @@ bool StaticData::LoadData(Parameter *parameter)
 
   LoadDecodeGraphs();
 
+  // cached options would carry one sentence's lookups over to the next
+  if (TranslationOptionCache::Instance().IsEnabled()) {
+    for (size_t i = 0; i < m_decodeGraphs.size(); ++i) {
+      DecodeGraph::const_iterator step;
+      for (step = m_decodeGraphs[i]->begin(); step != m_decodeGraphs[i]->end(); ++step) {
+        const PhraseDictionary *pt = (*step)->GetPhraseDictionaryFeature();
+        if (pt && pt->IsContextDependent() && TranslationOptionCache::Instance().IsEnabled()) {
+          TRACE_ERR("Disabling persistent-transopt-cache-size: "
+                    << pt->GetScoreProducerDescription()
+                    << " depends on the sentence or its context" << endl);
+          TranslationOptionCache::Instance().SetMaxSize(0);
+        }
+      }
+    }
+  }
+
   // sanity check that there are no weights without an associated FF
   if (!CheckWeights()) return false;
 
@@ -250,10 +275,17 @@ bool StaticData::LoadData(Parameter *parameter)
   return true;
 }
 
+void StaticData::SetAllWeights(const ScoreComponentCollection& weights)
+{
+  m_allWeights = weights;
+  TranslationOptionCache::Instance().Invalidate();
+}
+
 void StaticData::SetWeight(const FeatureFunction* sp, float weight)
 {
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weight);
+  TranslationOptionCache::Instance().Invalidate();
 }
 
 void StaticData::SetWeights(const FeatureFunction* sp,
@@ -261,6 +293,7 @@ void StaticData::SetWeights(const FeatureFunction* sp,
 {
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weights);
+  TranslationOptionCache::Instance().Invalidate();
 }
 
 void StaticData::LoadNonTerminals()
@@ -111,6 +111,9 @@ protected:
   UnknownLHSList m_unknownLHS;
 
   int m_threadCount;
+  int m_cpuAffinityOffset;
+  int m_cpuAffinityIncr;
+  bool m_parallelTransOpts;
   // long m_startTranslationId;
 
   // alternate weight settings
@@ -208,9 +211,7 @@ public:
     return m_allWeights;
   }
 
-  void SetAllWeights(const ScoreComponentCollection& weights) {
-    m_allWeights = weights;
-  }
+  void SetAllWeights(const ScoreComponentCollection& weights);
 
   //Weight for a single-valued feature
   float GetWeight(const FeatureFunction* sp) const {
@@ -259,6 +260,19 @@ public:
     return m_threadCount;
   }
 
+  //! first core to pin decoding threads to, or -1 for no pinning
+  int CpuAffinityOffset() const {
+    return m_cpuAffinityOffset;
+  }
+  int CpuAffinityIncrement() const {
+    return m_cpuAffinityIncr;
+  }
+
+  //! build the translation options of a sentence on several pool threads
+  bool ParallelTranslationOptions() const {
+    return m_parallelTransOpts;
+  }
+
   void SetExecPath(const std::string &path);
   const std::string &GetBinDirectory() const;
 
@@ -0,0 +1,243 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "TranslationModel/TargetPhraseCache.h"
+#include "TranslationModel/CompactPT/TargetPhraseCollectionCache.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+typedef TargetPhraseCacheShards<TargetPhraseCacheShard> Shards;
+
+// keys that all land in the same shard, so that they share its budget
+vector<size_t> SameShardKeys(size_t count)
+{
+  vector<size_t> ret;
+  size_t shard = Shards::GetShardIndex(1);
+  for (size_t key = 1; ret.size() < count; ++key) {
+    if (Shards::GetShardIndex(key) == shard) ret.push_back(key);
+  }
+  return ret;
+}
+
+TargetPhraseCollection::shared_ptr NewCollection()
+{
+  return TargetPhraseCollection::shared_ptr(new TargetPhraseCollection);
+}
+
+// a shard holds three empty collections
+size_t EntryBytes()
+{
+  TargetPhraseCollection coll;
+  return TargetPhraseCache::EstimateBytes(&coll);
+}
+
+size_t MaxBytes()
+{
+  return Shards::kShards * 3 * EntryBytes();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(target_phrase_cache)
+
+BOOST_AUTO_TEST_CASE(evicts_least_recently_used)
+{
+  TargetPhraseCache cache(MaxBytes());
+  vector<size_t> keys = SameShardKeys(4);
+  TargetPhraseCollection::shared_ptr coll;
+
+  for (size_t i = 0; i < 3; ++i) cache.Add(keys[i], NewCollection());
+  BOOST_CHECK(cache.Find(keys[0], coll));
+
+  // keys[1] is now the least recently used
+  cache.Add(keys[3], NewCollection());
+  BOOST_CHECK(!cache.Find(keys[1], coll));
+  BOOST_CHECK(cache.Find(keys[0], coll));
+  BOOST_CHECK(cache.Find(keys[2], coll));
+  BOOST_CHECK(cache.Find(keys[3], coll));
+
+  TargetPhraseCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.evictions, 1);
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+  BOOST_CHECK_EQUAL(stats.hits, 4);
+  BOOST_CHECK_EQUAL(stats.misses, 1);
+}
+
+BOOST_AUTO_TEST_CASE(stays_within_budget)
+{
+  TargetPhraseCache cache(MaxBytes());
+  vector<size_t> keys = SameShardKeys(20);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    cache.Add(keys[i], NewCollection());
+    BOOST_CHECK(cache.GetStats().bytes <= 3 * EntryBytes());
+  }
+
+  TargetPhraseCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+  BOOST_CHECK_EQUAL(stats.bytes, 3 * EntryBytes());
+  BOOST_CHECK_EQUAL(stats.evictions, keys.size() - 3);
+
+  // the most recent ones are left
+  TargetPhraseCollection::shared_ptr coll;
+  BOOST_CHECK(cache.Find(keys.back(), coll));
+  BOOST_CHECK(!cache.Find(keys.front(), coll));
+}
+
+BOOST_AUTO_TEST_CASE(caches_missing_translations)
+{
+  TargetPhraseCache cache(MaxBytes());
+  TargetPhraseCollection::shared_ptr coll = NewCollection();
+  cache.Add(1, TargetPhraseCollection::shared_ptr());
+  BOOST_CHECK(cache.Find(1, coll));
+  BOOST_CHECK(!coll);
+}
+
+BOOST_AUTO_TEST_CASE(held_collection_survives_eviction)
+{
+  TargetPhraseCache cache(MaxBytes());
+  vector<size_t> keys = SameShardKeys(4);
+  TargetPhraseCollection::shared_ptr added = NewCollection();
+  cache.Add(keys[0], added);
+
+  TargetPhraseCollection::shared_ptr held;
+  BOOST_REQUIRE(cache.Find(keys[0], held));
+  BOOST_CHECK(held == added);
+  added.reset();
+
+  for (size_t i = 1; i < keys.size(); ++i) cache.Add(keys[i], NewCollection());
+  TargetPhraseCollection::shared_ptr coll;
+  BOOST_CHECK(!cache.Find(keys[0], coll));
+  BOOST_CHECK(held.unique());
+  BOOST_CHECK_EQUAL(held->GetSize(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+namespace
+{
+
+TargetPhraseVectorPtr NewVector()
+{
+  return TargetPhraseVectorPtr(new TargetPhraseVector);
+}
+
+// a shard holds three empty vectors
+size_t SlotBytes()
+{
+  return TargetPhraseCollectionCache::EstimateBytes(TargetPhraseVector());
+}
+
+size_t MaxSlotBytes()
+{
+  return Shards::kShards * 3 * SlotBytes();
+}
+
+bool Cached(TargetPhraseCollectionCache &cache, size_t sourceId)
+{
+  return cache.Retrieve(sourceId).first.get() != NULL;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(target_phrase_collection_cache)
+
+BOOST_AUTO_TEST_CASE(gives_referenced_entries_a_second_chance)
+{
+  TargetPhraseCollectionCache cache(MaxSlotBytes());
+  vector<size_t> keys = SameShardKeys(5);
+  for (size_t i = 0; i < 3; ++i) cache.Cache(keys[i], NewVector());
+  BOOST_CHECK(Cached(cache, keys[0]));
+
+  // the hand clears the bit of keys[0] and takes keys[1] instead
+  cache.Cache(keys[3], NewVector());
+  BOOST_CHECK(!Cached(cache, keys[1]));
+
+  // then keys[2], which was never used, although keys[0] is older
+  cache.Cache(keys[4], NewVector());
+  BOOST_CHECK(!Cached(cache, keys[2]));
+  BOOST_CHECK(Cached(cache, keys[0]));
+  BOOST_CHECK(Cached(cache, keys[3]));
+  BOOST_CHECK(Cached(cache, keys[4]));
+
+  TargetPhraseCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.evictions, 2);
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_first_collection)
+{
+  TargetPhraseCollectionCache cache(MaxSlotBytes());
+  TargetPhraseVectorPtr first = NewVector();
+  cache.Cache(1, first, 7);
+  cache.Cache(1, NewVector(), 8);
+  std::pair<TargetPhraseVectorPtr, size_t> found = cache.Retrieve(1);
+  BOOST_CHECK(found.first == first);
+  BOOST_CHECK_EQUAL(found.second, 7);
+}
+
+BOOST_AUTO_TEST_CASE(stays_within_slot_budget)
+{
+  TargetPhraseCollectionCache cache(MaxSlotBytes());
+  vector<size_t> keys = SameShardKeys(20);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    cache.Cache(keys[i], NewVector());
+    BOOST_CHECK(cache.GetStats().bytes <= 3 * SlotBytes());
+    // keep one entry in use; the hand must still find room
+    BOOST_CHECK(Cached(cache, keys[0]));
+  }
+
+  TargetPhraseCacheStats stats = cache.GetStats();
+  BOOST_CHECK_EQUAL(stats.entries, 3);
+  BOOST_CHECK_EQUAL(stats.bytes, 3 * SlotBytes());
+  BOOST_CHECK_EQUAL(stats.evictions, keys.size() - 3);
+  BOOST_CHECK(Cached(cache, keys.back()));
+}
+
+BOOST_AUTO_TEST_CASE(disabled_without_budget)
+{
+  TargetPhraseCollectionCache cache(0);
+  cache.Cache(1, NewVector());
+  BOOST_CHECK(!Cached(cache, 1));
+  BOOST_CHECK_EQUAL(cache.GetStats().entries, 0);
+}
+
+BOOST_AUTO_TEST_CASE(held_vector_survives_eviction)
+{
+  TargetPhraseCollectionCache cache(MaxSlotBytes());
+  vector<size_t> keys = SameShardKeys(6);
+  cache.Cache(keys[0], NewVector());
+  TargetPhraseVectorPtr held = cache.Retrieve(keys[0]).first;
+  BOOST_REQUIRE(held);
+
+  // referenced once, so it goes when the hand comes round again
+  for (size_t i = 1; i < keys.size(); ++i) cache.Cache(keys[i], NewVector());
+  BOOST_CHECK(!Cached(cache, keys[0]));
+  BOOST_CHECK(held.unique());
+  BOOST_CHECK(held->empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
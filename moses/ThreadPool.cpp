@@ -24,54 +24,220 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #ifdef WITH_THREADS
 
+#ifdef __linux
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace std;
 using namespace Moses;
 
 namespace Moses
 {
 
-ThreadPool::ThreadPool( size_t numThreads )
+namespace
+{
+// A SubmitAndWait() batch.  Its tasks stay here until claimed, either by a
+// BatchTask the pool runs or by the waiting thread, so the waiting thread
+// only ever runs tasks of its own batch.
+struct Batch {
+  std::deque<boost::shared_ptr<Task> > unclaimed;
+  size_t remaining; // not yet finished
+  boost::mutex mutex; // guards the members above
+  boost::condition_variable done;
+
+  explicit Batch(const std::vector<boost::shared_ptr<Task> > &tasks)
+    : unclaimed(tasks.begin(), tasks.end()), remaining(tasks.size()) {}
+
+  // run one unclaimed task; false if there was none left
+  bool RunOne() {
+    boost::shared_ptr<Task> task;
+    {
+      boost::mutex::scoped_lock lock(mutex);
+      if (unclaimed.empty()) return false;
+      task = unclaimed.front();
+      unclaimed.pop_front();
+    }
+    task->Run();
+    boost::mutex::scoped_lock lock(mutex);
+    if (--remaining == 0) {
+      done.notify_all();
+    }
+    return true;
+  }
+};
+
+// runs a task of a batch, if the waiting thread has not claimed them all
+class BatchTask : public Task
+{
+public:
+  explicit BatchTask(const boost::shared_ptr<Batch> &batch) : m_batch(batch) {}
+
+  virtual void Run() {
+    m_batch->RunOne();
+  }
+
+private:
+  boost::shared_ptr<Batch> m_batch;
+};
+}
+
+boost::thread_specific_ptr<ThreadPool::Worker> ThreadPool::s_worker(&ThreadPool::KeepWorker);
+
+ThreadPool::ThreadPool( size_t numThreads, int cpuAffinityOffset, int cpuAffinityIncr )
   : m_stopped(false), m_stopping(false), m_queueLimit(0)
+  , m_pending(0), m_active(0)
 {
+  if (numThreads == 0) numThreads = 1;
+  for (size_t i = 0; i < numThreads; ++i) {
+    m_workers.push_back(new Worker(*this, i));
+  }
+
+  int numCPU = boost::thread::hardware_concurrency();
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    int cpu = -1;
+    if (cpuAffinityOffset >= 0 && numCPU > 0) {
+      cpu = (cpuAffinityOffset + i * cpuAffinityIncr) % numCPU;
+    }
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute, this, i, cpu));
   }
 }
 
-void ThreadPool::Execute()
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
+  }
+}
+
+ThreadPool *ThreadPool::Current()
+{
+  Worker *worker = s_worker.get();
+  return worker ? &worker->pool : NULL;
+}
+
+ThreadPool::Worker *ThreadPool::CurrentWorker()
 {
+  Worker *worker = s_worker.get();
+  return (worker && &worker->pool == this) ? worker : NULL;
+}
+
+void ThreadPool::Execute(size_t index, int cpu)
+{
+#ifdef __linux
+  if (cpu >= 0) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)) {
+      std::cerr << "Unable to pin thread " << index << " to core " << cpu << std::endl;
+    }
+  }
+#endif
+  s_worker.reset(m_workers[index]);
+
   do {
-    boost::shared_ptr<Task> task;
     {
-      // Find a job to perform
+      // Wait for a job to perform
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      while (m_pending <= 0 && !m_stopped) {
         m_threadNeeded.wait(lock);
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
+      if (m_stopped) break;
     }
-    //Execute job
-    if (task) {
-      task->Run();
+    boost::shared_ptr<Task> task;
+    if (TakeTask(index, task)) {
+      RunTask(task);
     }
-    m_threadAvailable.notify_all();
   } while (!m_stopped);
+
+  s_worker.reset();
 }
 
-void ThreadPool::Submit(boost::shared_ptr<Task> task)
+bool ThreadPool::TakeTask(size_t index, boost::shared_ptr<Task> &task)
 {
+  {
+    Worker &own = *m_workers[index];
+    boost::mutex::scoped_lock lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+    }
+  }
+  if (!task) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_injected.empty()) {
+      task = m_injected.front();
+      m_injected.pop_front();
+    }
+  }
+  for (size_t i = 1; !task && i < m_workers.size(); ++i) {
+    Worker &victim = *m_workers[(index + i) % m_workers.size()];
+    boost::mutex::scoped_lock lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+    }
+  }
+  if (!task) return false;
+
   boost::mutex::scoped_lock lock(m_mutex);
-  if (m_stopping) {
-    throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+  --m_pending;
+  ++m_active;
+  return true;
+}
+
+void ThreadPool::RunTask(const boost::shared_ptr<Task> &task)
+{
+  task->Run();
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    --m_active;
+  }
+  m_threadAvailable.notify_all();
+}
+
+void ThreadPool::Submit(boost::shared_ptr<Task> task)
+{
+  Worker *self = CurrentWorker();
+  if (self) {
+    boost::mutex::scoped_lock lock(self->mutex);
+    self->tasks.push_back(task);
+  }
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!self) {
+      if (m_stopping) {
+        throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+      }
+      while (m_queueLimit > 0 && m_pending >= (long) m_queueLimit) {
+        m_threadAvailable.wait(lock);
+      }
+      m_injected.push_back(task);
+    }
+    ++m_pending;
   }
-  while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
-    m_threadAvailable.wait(lock);
+  m_threadNeeded.notify_one();
+}
+
+void ThreadPool::SubmitAndWait(const std::vector<boost::shared_ptr<Task> > &tasks)
+{
+  if (tasks.empty()) return;
+  boost::shared_ptr<Batch> batch(new Batch(tasks));
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    Submit(boost::shared_ptr<Task>(new BatchTask(batch)));
+  }
+
+  // a worker helps with its own batch only; the BatchTasks it leaves
+  // queued find nothing to do
+  if (CurrentWorker()) {
+    while (batch->RunOne()) {}
+  }
+  boost::mutex::scoped_lock lock(batch->mutex);
+  while (batch->remaining > 0) {
+    batch->done.wait(lock);
   }
-  m_tasks.push(task);
-  m_threadNeeded.notify_all();
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -84,8 +250,8 @@ void ThreadPool::Stop(bool processRemainingJobs)
   }
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
-    //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    //wait for queues to drain, including jobs submitted by running jobs.
+    while ((m_pending > 0 || m_active > 0) && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
   }
@@ -101,4 +267,3 @@ void ThreadPool::Stop(bool processRemainingJobs)
 
 }
 #endif //WITH_THREADS
-
@@ -22,8 +22,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_ThreadPool_h
 #define moses_ThreadPool_h
 
+#include <deque>
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #include <boost/shared_ptr.hpp>
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
 #ifdef BOOST_HAS_PTHREADS
@@ -58,23 +59,56 @@ public:
 
 #ifdef WITH_THREADS
 
+/** Work-stealing thread pool.
+ *
+ * Tasks submitted from outside the pool go into one shared FIFO queue, so
+ * they start in the order they were submitted. Every worker also has its
+ * own deque, which holds the tasks submitted by the tasks it runs. A worker
+ * takes its own tasks newest first, then the oldest outside task, and only
+ * then steals the oldest task of another worker, so that long and short
+ * jobs balance across threads.
+ *
+ * SubmitAndWait() tracks its tasks as a batch. A worker that waits for a
+ * batch runs only tasks of that batch, never unrelated work that could
+ * block it, and otherwise sleeps until the batch is done.
+ */
 class ThreadPool
 {
 public:
   /**
    * Construct a thread pool of a fixed size.
+   * If cpuAffinityOffset is non-negative, worker i is pinned to core
+   * cpuAffinityOffset + i * cpuAffinityIncr (modulo the number of cores).
    **/
-  explicit ThreadPool(size_t numThreads);
+  explicit ThreadPool(size_t numThreads, int cpuAffinityOffset = -1, int cpuAffinityIncr = 1);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
-   * Add a job to the threadpool.
+   * Add a job to the threadpool. Jobs from outside the pool are run in the
+   * order they are submitted.
+   * May also be called by a task running in the pool, in which case the
+   * job is queued on the calling worker, which runs its newest job first,
+   * and the queue limit does not apply.
    **/
   void Submit(boost::shared_ptr<Task> task);
 
+  /**
+   * Submit jobs and block until all of them have completed. When called
+   * from a task running in the pool, the calling worker runs jobs of this
+   * batch itself while it waits, so nested use cannot starve the pool.
+   **/
+  void SubmitAndWait(const std::vector<boost::shared_ptr<Task> > &tasks);
+
+  /**
+   * The pool whose worker is executing the calling thread, or NULL.
+   **/
+  static ThreadPool *Current();
+
+  size_t GetNumThreads() const {
+    return m_workers.size();
+  }
+
   /**
    * Wait until all queued jobs have completed, and shut down
    * the ThreadPool.
@@ -89,19 +123,46 @@ public:
   }
 
 private:
+  struct Worker {
+    Worker(ThreadPool &p, size_t i) : pool(p), index(i) {}
+    ThreadPool &pool;
+    size_t index;
+    std::deque<boost::shared_ptr<Task> > tasks;
+    boost::mutex mutex; // guards tasks
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t index, int cpu);
+
+  /**
+   * Take the newest task of the given worker, else the oldest task
+   * submitted from outside the pool, else steal the oldest task of
+   * another worker.
+   **/
+  bool TakeTask(size_t index, boost::shared_ptr<Task> &task);
 
-  std::queue<boost::shared_ptr<Task> > m_tasks;
+  void RunTask(const boost::shared_ptr<Task> &task);
+
+  Worker *CurrentWorker();
+
+  // cleanup function for s_worker: workers are owned by their pool
+  static void KeepWorker(Worker *) {}
+
+  std::vector<Worker*> m_workers;
   boost::thread_group m_threads;
-  boost::mutex m_mutex;
+  boost::mutex m_mutex; // guards the members below
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
   bool m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
+  long m_pending; /**< queued tasks. Briefly negative while a submit is in progress */
+  size_t m_active; /**< tasks being run */
+  std::deque<boost::shared_ptr<Task> > m_injected; /**< tasks submitted from outside the pool */
+
+  static boost::thread_specific_ptr<Worker> s_worker;
 };
 
 class TestTask : public Task
@@ -0,0 +1,112 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "ThreadPool.h"
+
+#ifdef WITH_THREADS
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+boost::mutex s_mutex;
+vector<int> s_finished;
+
+class RecordTask : public Task
+{
+public:
+  explicit RecordTask(int id) : m_id(id) {}
+
+  virtual void Run() {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    boost::mutex::scoped_lock lock(s_mutex);
+    s_finished.push_back(m_id);
+  }
+
+private:
+  int m_id;
+};
+
+// the id of the outer task running on this thread, if any
+boost::thread_specific_ptr<int> s_running;
+
+// stands for a sentence that splits its work with SubmitAndWait
+class OuterTask : public Task
+{
+public:
+  OuterTask(int id, ThreadPool &pool) : m_id(id), m_pool(pool) {}
+
+  virtual void Run() {
+    // another outer task must not run inside our SubmitAndWait
+    BOOST_CHECK(!s_running.get());
+    s_running.reset(new int(m_id));
+    vector<boost::shared_ptr<Task> > tasks;
+    for (int i = 0; i < 4; ++i) {
+      tasks.push_back(boost::shared_ptr<Task>(new RecordTask(1000 + i)));
+    }
+    m_pool.SubmitAndWait(tasks);
+    BOOST_CHECK_EQUAL(*s_running, m_id);
+    s_running.reset();
+    boost::mutex::scoped_lock lock(s_mutex);
+    s_finished.push_back(m_id);
+  }
+
+private:
+  int m_id;
+  ThreadPool &m_pool;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(external_tasks_run_in_order)
+{
+  s_finished.clear();
+  ThreadPool pool(1);
+  for (int i = 0; i < 20; ++i) {
+    pool.Submit(boost::shared_ptr<Task>(new RecordTask(i)));
+  }
+  pool.Stop(true);
+  BOOST_REQUIRE_EQUAL(s_finished.size(), 20);
+  for (int i = 0; i < 20; ++i) {
+    BOOST_CHECK_EQUAL(s_finished[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(submit_and_wait_runs_own_batch_only)
+{
+  s_finished.clear();
+  ThreadPool pool(3);
+  for (int i = 0; i < 30; ++i) {
+    pool.Submit(boost::shared_ptr<Task>(new OuterTask(i, pool)));
+  }
+  pool.Stop(true);
+  BOOST_CHECK_EQUAL(s_finished.size(), 30 * 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -247,7 +247,7 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
           if (iterCache == m_cache.end()) {
 
             OnDiskPt::TargetPhraseCollection::shared_ptr tpcollBerkeleyDb
-            = node->GetTargetPhraseCollection(m_dictionary.GetTableLimit(), m_dbWrapper);
+            = node->GetTargetPhraseCollection(m_dictionary.GetReadLimit(), m_dbWrapper);
 
             std::vector<float> weightT = staticData.GetWeights(&m_dictionary);
             targetPhraseCollection
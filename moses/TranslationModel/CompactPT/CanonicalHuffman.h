@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <boost/dynamic_bitset.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
 
 #include "ThrowingFwrite.h"
 
@@ -43,6 +44,21 @@ private:
   typedef boost::unordered_map<Data, boost::dynamic_bitset<> > EncodeMap;
   EncodeMap m_encodeMap;
 
+  // Decodes all codes of up to m_lookupBits bits with one lookup, indexed
+  // by the next bits of the stream with the first bit lowest. Entries for
+  // longer codes have length 0 and hold the code read so far, which is
+  // completed from the bits peeked with it.
+  struct LookupEntry {
+    unsigned int m_index : 26;
+    unsigned int m_length : 6;
+  };
+
+  static const size_t s_maxLookupBits = 12;
+  static const size_t s_maxPeekBits = 48;
+  size_t m_lookupBits;
+  size_t m_peekBits;
+  std::vector<LookupEntry> m_lookupTable;
+
   struct MinHeapSorter {
     std::vector<size_t>& m_vec;
 
@@ -157,6 +173,34 @@ private:
     }
   }
 
+  void CreateLookupTable() {
+    if(m_firstCodes.size() < 2 || m_symbols.size() >> 26)
+      return;
+
+    size_t maxLength = m_firstCodes.size() - 1;
+    m_lookupBits = std::min(maxLength, s_maxLookupBits);
+    m_peekBits = std::min(maxLength, s_maxPeekBits);
+    m_lookupTable.resize(size_t(1) << m_lookupBits);
+
+    for(size_t bits = 0; bits < m_lookupTable.size(); bits++) {
+      LookupEntry &entry = m_lookupTable[bits];
+      size_t intCode = bits & 1;
+      size_t len = 1;
+      while(len < m_lookupBits && intCode < m_firstCodes[len]) {
+        intCode = 2 * intCode + ((bits >> len) & 1);
+        len++;
+      }
+      size_t index = m_lengthIndex[len] + (intCode - m_firstCodes[len]);
+      if(intCode >= m_firstCodes[len] && index < m_symbols.size()) {
+        entry.m_index = index;
+        entry.m_length = len;
+      } else {
+        entry.m_index = intCode;
+        entry.m_length = 0;
+      }
+    }
+  }
+
   const boost::dynamic_bitset<>& Encode(Data data) const {
     typename EncodeMap::const_iterator it = m_encodeMap.find(data);
     UTIL_THROW_IF2(it == m_encodeMap.end(), "Cannot find symbol in encoding map");
@@ -172,16 +216,20 @@ private:
 public:
 
   template <class Iterator>
-  CanonicalHuffman(Iterator begin, Iterator end, bool forEncoding = true) {
+  CanonicalHuffman(Iterator begin, Iterator end, bool forEncoding = true)
+    : m_lookupBits(0), m_peekBits(0) {
     std::vector<size_t> lengths;
     CalcLengths(begin, end, lengths);
     CalcCodes(lengths);
 
     if(forEncoding)
       CreateCodeMap();
+    else
+      CreateLookupTable();
   }
 
-  CanonicalHuffman(std::FILE* pFile, bool forEncoding = false) {
+  CanonicalHuffman(std::FILE* pFile, bool forEncoding = false)
+    : m_lookupBits(0), m_peekBits(0) {
     Load(pFile);
 
     if(forEncoding)
@@ -195,7 +243,31 @@ public:
 
   template <class BitWrapper>
   Data Read(BitWrapper& bitWrapper) {
-    if(bitWrapper.TellFromEnd()) {
+    size_t bitsLeft = bitWrapper.TellFromEnd();
+    if(bitsLeft) {
+      if(m_lookupBits) {
+        size_t bits = bitWrapper.Peek(m_peekBits);
+        const LookupEntry &entry
+        = m_lookupTable[bits & ((size_t(1) << m_lookupBits) - 1)];
+        size_t len = entry.m_length;
+        size_t index = entry.m_index;
+        if(!len) {
+          size_t intCode = entry.m_index;
+          len = m_lookupBits;
+          while(len < m_peekBits && intCode < m_firstCodes[len]) {
+            intCode = 2 * intCode + ((bits >> len) & 1);
+            len++;
+          }
+          index = m_lengthIndex[len] + (intCode - m_firstCodes[len]);
+          if(intCode < m_firstCodes[len] || index >= m_symbols.size())
+            len = 0;
+        }
+        if(len && len <= bitsLeft) {
+          bitWrapper.Skip(len);
+          return m_symbols[index];
+        }
+      }
+
       size_t intCode = bitWrapper.Read();
       size_t len = 1;
       while(intCode < m_firstCodes[len]) {
@@ -224,6 +296,8 @@ public:
     m_lengthIndex.resize(size);
     read += std::fread(&m_lengthIndex[0], sizeof(size_t), size, pFile);
 
+    CreateLookupTable();
+
     return std::ftell(pFile) - start;
   }
 
@@ -252,29 +326,45 @@ class BitWrapper
 private:
   Container& m_data;
 
-  typename Container::iterator m_iterator;
-  typename Container::value_type m_currentValue;
+  typedef typename boost::make_unsigned<typename Container::value_type>::type
+  UnsignedValue;
+
+  static const size_t m_valueBits = sizeof(UnsignedValue) * 8;
+  static const size_t m_windowValues = sizeof(size_t) / sizeof(UnsignedValue);
 
-  size_t m_valueBits;
   typename Container::value_type m_mask;
   size_t m_bitPos;
 
 public:
 
   BitWrapper(Container &data)
-    : m_data(data), m_iterator(m_data.begin()), m_currentValue(0),
-      m_valueBits(sizeof(typename Container::value_type) * 8),
-      m_mask(1), m_bitPos(0) { }
+    : m_data(data), m_mask(1), m_bitPos(0) { }
 
   bool Read() {
-    if(m_bitPos % m_valueBits == 0) {
-      if(m_iterator != m_data.end())
-        m_currentValue = *m_iterator++;
-    } else
-      m_currentValue = m_currentValue >> 1;
-
+    size_t index = m_bitPos / m_valueBits;
+    bool bit = index < m_data.size()
+               && ((UnsignedValue(m_data[index]) >> (m_bitPos % m_valueBits)) & 1);
     m_bitPos++;
-    return (m_currentValue & m_mask);
+    return bit;
+  }
+
+  // The next bits without consuming them, the first bit lowest. Bits past
+  // the end are zero.
+  size_t Peek(size_t bits) const {
+    size_t index = m_bitPos / m_valueBits;
+    size_t window = 0;
+    if(index + m_windowValues <= m_data.size()) {
+      for(size_t i = 0; i < m_windowValues; i++)
+        window |= size_t(UnsignedValue(m_data[index + i])) << (i * m_valueBits);
+    } else {
+      for(size_t i = 0; index + i < m_data.size(); i++)
+        window |= size_t(UnsignedValue(m_data[index + i])) << (i * m_valueBits);
+    }
+    return (window >> (m_bitPos % m_valueBits)) & ((size_t(1) << bits) - 1);
+  }
+
+  void Skip(size_t bits) {
+    m_bitPos += bits;
   }
 
   void Put(bool bit) {
@@ -299,9 +389,6 @@ public:
 
   void Seek(size_t bitPos) {
     m_bitPos = bitPos;
-    m_iterator = m_data.begin() + int((m_bitPos-1)/m_valueBits);
-    m_currentValue = (*m_iterator) >> ((m_bitPos-1) % m_valueBits);
-    m_iterator++;
   }
 
   void SeekFromEnd(size_t bitPosFromEnd) {
@@ -310,8 +397,6 @@ public:
   }
 
   void Reset() {
-    m_iterator = m_data.begin();
-    m_currentValue = 0;
     m_bitPos = 0;
   }
 
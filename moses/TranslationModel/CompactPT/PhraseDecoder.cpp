@@ -40,6 +40,7 @@ PhraseDecoder::PhraseDecoder(
     m_containsAlignmentInfo(true), m_maxRank(0),
     m_symbolTree(0), m_multipleScoreTrees(false),
     m_scoreTrees(1), m_alignTree(0),
+    m_decodingCache(phraseDictionary.m_decodingCacheBytes),
     m_phraseDictionary(phraseDictionary), m_input(input), m_output(output),
     // m_weight(weight),
     m_separator(" ||| ")
@@ -190,7 +191,7 @@ std::string PhraseDecoder::MakeSourceKey(std::string &source)
   return source + m_separator;
 }
 
-TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &sourcePhrase, bool topLevel, bool eval)
+TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &sourcePhrase, bool topLevel, bool eval, size_t limit)
 {
 
   // Not using TargetPhraseCollection avoiding "new" operator
@@ -198,9 +199,16 @@ TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &
   TargetPhraseVectorPtr tpv(new TargetPhraseVector());
   size_t bitsLeft = 0;
 
+  // Retrieve source phrase identifier
+  std::string sourcePhraseString = sourcePhrase.GetStringRep(*m_input);
+  size_t sourcePhraseId = m_phraseDictionary.m_hash[MakeSourceKey(sourcePhraseString)];
+
+  if(sourcePhraseId == m_phraseDictionary.m_hash.GetSize())
+    return TargetPhraseVectorPtr();
+
   if(m_coding == PREnc) {
     std::pair<TargetPhraseVectorPtr, size_t> cachedPhraseColl
-    = m_decodingCache.Retrieve(sourcePhrase);
+    = m_decodingCache.Retrieve(sourcePhraseId);
 
     // Has been cached and is complete or does not need to be completed
     if(cachedPhraseColl.first != NULL && (!topLevel || cachedPhraseColl.second == 0))
@@ -216,34 +224,29 @@ TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &
     }
   }
 
-  // Retrieve source phrase identifier
-  std::string sourcePhraseString = sourcePhrase.GetStringRep(*m_input);
-  size_t sourcePhraseId = m_phraseDictionary.m_hash[MakeSourceKey(sourcePhraseString)];
-
-  if(sourcePhraseId != m_phraseDictionary.m_hash.GetSize()) {
-    // Retrieve compressed and encoded target phrase collection
-    std::string encodedPhraseCollection;
-    if(m_phraseDictionary.m_inMemory)
-      encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMemory[sourcePhraseId].str();
-    else
-      encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMapped[sourcePhraseId].str();
+  // Retrieve compressed and encoded target phrase collection
+  std::string encodedPhraseCollection;
+  if(m_phraseDictionary.m_inMemory)
+    encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMemory[sourcePhraseId].str();
+  else
+    encodedPhraseCollection = m_phraseDictionary.m_targetPhrasesMapped[sourcePhraseId].str();
 
-    BitWrapper<> encodedBitStream(encodedPhraseCollection);
-    if(m_coding == PREnc && bitsLeft)
-      encodedBitStream.SeekFromEnd(bitsLeft);
+  BitWrapper<> encodedBitStream(encodedPhraseCollection);
+  if(m_coding == PREnc && bitsLeft)
+    encodedBitStream.SeekFromEnd(bitsLeft);
 
-    // Decompress and decode target phrase collection
-    TargetPhraseVectorPtr decodedPhraseColl =
-      DecodeCollection(tpv, encodedBitStream, sourcePhrase, topLevel, eval);
+  // Decompress and decode target phrase collection
+  TargetPhraseVectorPtr decodedPhraseColl =
+    DecodeCollection(tpv, encodedBitStream, sourcePhrase, sourcePhraseId,
+                     topLevel, eval, limit);
 
-    return decodedPhraseColl;
-  } else
-    return TargetPhraseVectorPtr();
+  return decodedPhraseColl;
 }
 
 TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
   TargetPhraseVectorPtr tpv, BitWrapper<> &encodedBitStream,
-  const Phrase &sourcePhrase, bool topLevel, bool eval)
+  const Phrase &sourcePhrase, size_t sourcePhraseId, bool topLevel, bool eval,
+  size_t limit)
 {
 
   bool extending = tpv->size();
@@ -435,6 +438,13 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
           break;
       }
 
+      // Collections stored best first only need their first limit phrases.
+      // The PREnc cache must still hold the m_maxRank phrases that other
+      // collections may point to.
+      if(topLevel && limit && tpv->size() >= limit
+          && (m_coding != PREnc || (m_maxRank && limit >= m_maxRank)))
+        break;
+
       if(encodedBitStream.TellFromEnd() <= 8)
         break;
 
@@ -444,15 +454,10 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
 
   if(m_coding == PREnc && !extending) {
     bitsLeft = bitsLeft > 8 ? bitsLeft : 0;
-    m_decodingCache.Cache(sourcePhrase, tpv, bitsLeft, m_maxRank);
+    m_decodingCache.Cache(sourcePhraseId, tpv, bitsLeft, m_maxRank);
   }
 
   return tpv;
 }
 
-void PhraseDecoder::PruneCache()
-{
-  m_decodingCache.Prune();
-}
-
 }
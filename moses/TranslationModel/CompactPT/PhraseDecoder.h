@@ -128,15 +128,19 @@ public:
   size_t Load(std::FILE* in);
 
   TargetPhraseVectorPtr CreateTargetPhraseCollection(const Phrase &sourcePhrase,
-      bool topLevel = false, bool eval = true);
+      bool topLevel = false, bool eval = true, size_t limit = 0);
 
   TargetPhraseVectorPtr DecodeCollection(TargetPhraseVectorPtr tpv,
                                          BitWrapper<> &encodedBitStream,
                                          const Phrase &sourcePhrase,
+                                         size_t sourcePhraseId,
                                          bool topLevel,
-                                         bool eval);
+                                         bool eval,
+                                         size_t limit = 0);
 
-  void PruneCache();
+  TargetPhraseCacheStats GetCacheStats() const {
+    return m_decodingCache.GetStats();
+  }
 };
 
 }
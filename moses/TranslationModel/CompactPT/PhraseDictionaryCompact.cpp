@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include <string>
+#include <cstring>
 #include <iterator>
 #include <queue>
 #include <algorithm>
@@ -29,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/thread/tss.hpp>
 
 #include "PhraseDictionaryCompact.h"
+#include "PhraseTableCreator.h"
 #include "moses/FactorCollection.h"
 #include "moses/Word.h"
 #include "moses/Util.h"
@@ -50,12 +52,22 @@ PhraseDictionaryCompact::PhraseDictionaryCompact(const std::string &line)
   :PhraseDictionary(line, true)
   ,m_inMemory(true)//(s_inMemoryByDefault)
   ,m_useAlignmentInfo(true)
+  ,m_decodingCacheBytes(64 * 1024 * 1024)
   ,m_hash(10, 16)
   ,m_phraseDecoder(0)
 {
   ReadParameters();
 }
 
+void PhraseDictionaryCompact::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "decoding-cache-bytes") {
+    m_decodingCacheBytes = Scan<size_t>(value);
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 void PhraseDictionaryCompact::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
@@ -75,6 +87,8 @@ void PhraseDictionaryCompact::Load(AllOptions::ptr const& opts)
 
   std::FILE* pFile = std::fopen(tFilePath.c_str() , "r");
 
+  LoadSortWeights(pFile);
+
   size_t indexSize;
   //if(m_inMemory)
   // Load source phrase index into memory
@@ -97,6 +111,27 @@ void PhraseDictionaryCompact::Load(AllOptions::ptr const& opts)
                  "Not successfully loaded");
 }
 
+void PhraseDictionaryCompact::LoadSortWeights(std::FILE* pFile)
+{
+  // Tables built with sorted collections end in the weights, their count
+  // and a tag. Older tables have no such trailer.
+  m_sortWeights.clear();
+  char tag[8];
+  size_t size = 0;
+  long trailer = sizeof(size_t) + sizeof(tag);
+  if(std::fseek(pFile, -trailer, SEEK_END) == 0
+      && std::fread(&size, sizeof(size_t), 1, pFile) == 1
+      && std::fread(tag, 1, sizeof(tag), pFile) == sizeof(tag)
+      && std::memcmp(tag, PhraseTableCreator::m_sortWeightsTag, sizeof(tag)) == 0
+      && size == m_numScoreComponents) {
+    m_sortWeights.resize(size);
+    std::fseek(pFile, -(long)(trailer + size * sizeof(float)), SEEK_END);
+    if(std::fread(&m_sortWeights[0], sizeof(float), size, pFile) != size)
+      m_sortWeights.clear();
+  }
+  std::fseek(pFile, 0, SEEK_SET);
+}
+
 TargetPhraseCollection::shared_ptr
 PhraseDictionaryCompact::
 GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &sourcePhrase) const
@@ -108,9 +143,13 @@ GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &sourcePhrase) const
   if(sourcePhrase.GetSize() > m_phraseDecoder->GetMaxSourcePhraseLength())
     return ret;
 
+  // If the collections were sorted by the weights in use, the best phrases
+  // come first and decoding can stop at the table limit
+  size_t limit = StoredOrderMatchesWeights(m_sortWeights) ? m_tableLimit : 0;
+
   // Retrieve target phrase collection from phrase table
   TargetPhraseVectorPtr decodedPhraseColl
-  = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, true);
+  = m_phraseDecoder->CreateTargetPhraseCollection(sourcePhrase, true, true, limit);
 
   if(decodedPhraseColl != NULL && decodedPhraseColl->size()) {
     TargetPhraseVectorPtr tpv(new TargetPhraseVector(*decodedPhraseColl));
@@ -120,7 +159,8 @@ GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &sourcePhrase) const
     TargetPhraseVector::iterator nth =
       (m_tableLimit == 0 || tpv->size() < m_tableLimit) ?
       tpv->end() : tpv->begin() + m_tableLimit;
-    NTH_ELEMENT4(tpv->begin(), nth, tpv->end(), CompareTargetPhrase());
+    if(!limit)
+      NTH_ELEMENT4(tpv->begin(), nth, tpv->end(), CompareTargetPhrase());
     for(TargetPhraseVector::iterator it = tpv->begin(); it != nth; it++) {
       TargetPhrase *tp = new TargetPhrase(*it);
       phraseColl->Add(tp);
@@ -151,8 +191,13 @@ GetTargetPhraseCollectionRaw(const Phrase &sourcePhrase) const
 PhraseDictionaryCompact::
 ~PhraseDictionaryCompact()
 {
-  if(m_phraseDecoder)
+  if(m_phraseDecoder) {
+    if(m_phraseDecoder->m_coding == PhraseDecoder::PREnc) {
+      VERBOSE(1, GetScoreProducerDescription() << " decoding cache: "
+              << m_phraseDecoder->GetCacheStats() << endl);
+    }
     delete m_phraseDecoder;
+  }
 }
 
 void
@@ -176,7 +221,6 @@ CleanUpAfterSentenceProcessing(const InputType &source)
   if(!m_sentenceCache.get())
     m_sentenceCache.reset(new PhraseCache());
 
-  m_phraseDecoder->PruneCache();
   m_sentenceCache->clear();
 
   ReduceCache();
@@ -51,6 +51,7 @@ protected:
   static bool s_inMemoryByDefault;
   bool m_inMemory;
   bool m_useAlignmentInfo;
+  size_t m_decodingCacheBytes;
 
   typedef std::vector<TargetPhraseCollection::shared_ptr > PhraseCache;
   typedef boost::thread_specific_ptr<PhraseCache> SentenceCache;
@@ -62,6 +63,11 @@ protected:
   StringVector<unsigned char, size_t, MmapAllocator>  m_targetPhrasesMapped;
   StringVector<unsigned char, size_t, std::allocator> m_targetPhrasesMemory;
 
+  // Weights the collections were sorted by when the table was built, if any
+  std::vector<float> m_sortWeights;
+
+  void LoadSortWeights(std::FILE* pFile);
+
 public:
   PhraseDictionaryCompact(const std::string &line);
 
@@ -69,6 +75,8 @@ public:
 
   void Load(AllOptions::ptr const& opts);
 
+  void SetParameter(const std::string& key, const std::string& value);
+
   TargetPhraseCollection::shared_ptr  GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &source) const;
   TargetPhraseVectorPtr GetTargetPhraseCollectionRaw(const Phrase &source) const;
 
@@ -39,6 +39,7 @@ bool operator<(const PackedItem &pi1, const PackedItem &pi2)
 
 std::string PhraseTableCreator::m_phraseStopSymbol = "__SPECIAL_STOP_SYMBOL__";
 std::string PhraseTableCreator::m_separator = "|||";
+const char PhraseTableCreator::m_sortWeightsTag[9] = "SortWgt1";
 
 PhraseTableCreator::PhraseTableCreator(std::string inPath,
                                        std::string outPath,
@@ -52,7 +53,8 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
                                        bool multipleScoreTrees,
                                        size_t quantize,
                                        size_t maxRank,
-                                       bool warnMe
+                                       bool warnMe,
+                                       const std::vector<float> &sortWeights
 #ifdef WITH_THREADS
                                        , size_t threads
 #endif
@@ -64,6 +66,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_useAlignmentInfo(useAlignmentInfo),
     m_multipleScoreTrees(multipleScoreTrees),
     m_quantize(quantize), m_maxRank(maxRank),
+    m_sortWeights(sortWeights),
 #ifdef WITH_THREADS
     m_threads(threads),
     m_srcHash(m_orderBits, m_fingerPrintBits, 1),
@@ -82,7 +85,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
 
   size_t cur_pass = 1;
   size_t all_passes = 2;
-  if(m_coding == PREnc)
+  if(SortsCollections())
     all_passes = 3;
 
   m_scoreCounters.resize(m_multipleScoreTrees ? m_numScoreComponent : 1);
@@ -100,7 +103,8 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     else
       path = ".";
     LoadLexicalTable(path + "/lex.f2e");
-  } else if(m_coding == PREnc) {
+  }
+  if(SortsCollections()) {
     std::cerr << "Pass " << cur_pass << "/" << all_passes << ": Creating hash function for rank assignment" << std::endl;
     cur_pass++;
     CreateRankHash();
@@ -172,6 +176,12 @@ void PhraseTableCreator::PrintInfo()
       std::cerr << m_maxRank << std::endl;
   }
   std::cerr << "\tNumber of score components in phrase table: " << m_numScoreComponent << std::endl;
+  if(!m_sortWeights.empty()) {
+    std::cerr << "\tTarget phrases stored best first by weights:";
+    for(size_t i = 0; i < m_sortWeights.size(); i++)
+      std::cerr << " " << m_sortWeights[i];
+    std::cerr << std::endl;
+  }
   std::cerr << "\tSingle Huffman code set for score components: " << (m_multipleScoreTrees ? "no" : "yes") << std::endl;
   std::cerr << "\tUsing score quantization: ";
   if(m_quantize)
@@ -246,6 +256,19 @@ void PhraseTableCreator::Save()
 
   // Save compressed target phrase collections
   m_compressedTargetPhrases->save(m_outFile);
+
+  // Save the ranking of the collections. PREnc ranks by a single score.
+  if(SortsCollections()) {
+    std::vector<float> sortWeights = m_sortWeights;
+    if(sortWeights.empty()) {
+      sortWeights.resize(m_numScoreComponent, 0);
+      sortWeights[m_sortScoreIndex] = 1;
+    }
+    size_t size = sortWeights.size();
+    ThrowingFwrite(&sortWeights[0], sizeof(float), size, m_outFile);
+    ThrowingFwrite(&size, sizeof(size_t), 1, m_outFile);
+    ThrowingFwrite(m_sortWeightsTag, 1, 8, m_outFile);
+  }
 }
 
 void PhraseTableCreator::LoadLexicalTable(std::string filePath)
@@ -942,7 +965,7 @@ void PhraseTableCreator::FlushEncodedQueue(bool force)
     }
 
     m_lastFlushedSourcePhrase = pi.GetSrc();
-    if(m_coding == PREnc) {
+    if(SortsCollections()) {
       if(m_lastCollection.size() <= pi.GetRank())
         m_lastCollection.resize(pi.GetRank() + 1);
       m_lastCollection[pi.GetRank()] = pi.GetTrg();
@@ -1054,14 +1077,14 @@ void RankingTask::operator()()
       for(std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); it++)
         *it = Moses::Trim(*it);
 
-      if(tokens.size() < 4) {
+      if(tokens.size() < 3) {
         std::stringstream strme;
         strme << "Error: It seems the following line has a wrong format:" << std::endl;
         strme << "Line " << i << ": " << lines[i] << std::endl;
         UTIL_THROW2(strme.str());
       }
 
-      if(tokens[3].size() <= 1 && m_creator.m_coding != PhraseTableCreator::None) {
+      if(tokens.size() > 3 && tokens[3].size() <= 1 && m_creator.m_coding != PhraseTableCreator::None) {
         std::stringstream strme;
         strme << "Error: It seems the following line contains no alignment information, " << std::endl;
         strme << "but you are using ";
@@ -1081,7 +1104,9 @@ void RankingTask::operator()()
         UTIL_THROW2(strme.str());
       }
 
-      float sortScore = scores[m_creator.m_sortScoreIndex];
+      float sortScore = m_creator.m_sortWeights.empty()
+                        ? scores[m_creator.m_sortScoreIndex]
+                        : CalcSortScore(&scores[0], m_creator.m_sortWeights);
 
       std::string key1 = m_creator.MakeSourceKey(tokens[0]);
       std::string key2 = m_creator.MakeSourceTargetKey(tokens[0], tokens[1]);
@@ -1173,7 +1198,7 @@ void EncodingTask::operator()()
       }
 
       size_t ownRank = 0;
-      if(m_creator.m_coding == PhraseTableCreator::PREnc)
+      if(m_creator.SortsCollections())
         ownRank = m_creator.m_ranks[lineNum + i];
 
       std::string encodedLine = m_creator.EncodeLine(tokens, ownRank);
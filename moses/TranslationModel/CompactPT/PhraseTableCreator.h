@@ -180,6 +180,11 @@ class PhraseTableCreator
 public:
   enum Coding { None, REnc, PREnc };
 
+  // Ends a table whose collections are stored best first. It follows the
+  // sort weights and their number, at the very end of the file so that
+  // older tables load as before.
+  static const char m_sortWeightsTag[9];
+
 private:
   std::string m_inPath;
   std::string m_outPath;
@@ -199,6 +204,10 @@ private:
   size_t m_quantize;
   size_t m_maxRank;
 
+  // if set, collections are ranked by CalcSortScore() under these instead of
+  // by the score at m_sortScoreIndex
+  std::vector<float> m_sortWeights;
+
   static std::string m_phraseStopSymbol;
   static std::string m_separator;
 
@@ -324,6 +333,12 @@ private:
   void AddEncodedLine(PackedItem& pi);
   void FlushEncodedQueue(bool force = false);
 
+  // Whether collections are stored in rank order. PREnc needs it, other
+  // encodings do it when given sort weights.
+  bool SortsCollections() const {
+    return m_coding == PREnc || !m_sortWeights.empty();
+  }
+
   std::string CompressEncodedCollection(std::string encodedCollection);
   void AddCompressedCollection(PackedItem& pi);
   void FlushCompressedQueue(bool force = false);
@@ -342,7 +357,8 @@ public:
                      bool multipleScoreTrees = true,
                      size_t quantize = 0,
                      size_t maxRank = 100,
-                     bool warnMe = true
+                     bool warnMe = true,
+                     const std::vector<float> &sortWeights = std::vector<float>()
 #ifdef WITH_THREADS
                                    , size_t threads = 2
 #endif
@@ -19,14 +19,105 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+
 #include "TargetPhraseCollectionCache.h"
 
 namespace Moses
 {
 
+TargetPhraseCollectionCache::TargetPhraseCollectionCache(size_t maxBytes)
+  : m_shards(maxBytes)
+{
+}
+
+void TargetPhraseCollectionCache::Cache(size_t sourceId,
+                                        TargetPhraseVectorPtr tpv,
+                                        size_t bitsLeft, size_t maxRank)
+{
+  size_t maxShardBytes = m_shards.GetMaxShardBytes();
+  if(!maxShardBytes)
+    return;
+
+  if(maxRank && tpv->size() > maxRank)
+    tpv.reset(new TargetPhraseVector(tpv->begin(), tpv->begin() + maxRank));
+  size_t bytes = EstimateBytes(*tpv);
+
+  // declared before the lock so that evicted collections are released
+  // after it has been dropped
+  std::vector<TargetPhraseVectorPtr> evicted;
+
+  Shard &shard = m_shards.Get(sourceId);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.lock);
+#endif
+  // another thread may have decoded the same collection
+  if(shard.index.find(sourceId) != shard.index.end())
+    return;
 
-boost::thread_specific_ptr<TargetPhraseCollectionCache::CacheMap>
-TargetPhraseCollectionCache::m_phraseCache;
+  // sweep until the new entry fits, but never evict it for its own size
+  while(shard.bytes + bytes > maxShardBytes && !shard.index.empty()) {
+    if(shard.hand >= shard.slots.size())
+      shard.hand = 0;
+    Slot &slot = shard.slots[shard.hand];
+    if(slot.m_tpv && slot.m_referenced) {
+      slot.m_referenced = false;
+    } else if(slot.m_tpv) {
+      shard.bytes -= slot.m_bytes;
+      shard.index.erase(slot.m_sourceId);
+      evicted.push_back(slot.m_tpv);
+      slot.m_tpv.reset();
+      shard.freeSlots.push_back(shard.hand);
+      shard.evictions++;
+    }
+    shard.hand++;
+  }
 
+  size_t pos;
+  if(shard.freeSlots.empty()) {
+    pos = shard.slots.size();
+    shard.slots.push_back(Slot());
+  } else {
+    pos = shard.freeSlots.back();
+    shard.freeSlots.pop_back();
+  }
+
+  // new entries start unreferenced, so that collections used only once
+  // are the first to go
+  Slot &slot = shard.slots[pos];
+  slot.m_sourceId = sourceId;
+  slot.m_bytes = bytes;
+  slot.m_bitsLeft = bitsLeft;
+  slot.m_referenced = false;
+  slot.m_tpv = tpv;
+  shard.index[sourceId] = pos;
+  shard.bytes += bytes;
+}
+
+std::pair<TargetPhraseVectorPtr, size_t>
+TargetPhraseCollectionCache::Retrieve(size_t sourceId)
+{
+  Shard &shard = m_shards.Get(sourceId);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.lock);
+#endif
+  boost::unordered_map<size_t, size_t>::const_iterator it
+  = shard.index.find(sourceId);
+  if(it == shard.index.end()) {
+    shard.misses++;
+    return std::make_pair(TargetPhraseVectorPtr(), 0);
+  }
+  shard.hits++;
+  Slot &slot = shard.slots[it->second];
+  slot.m_referenced = true;
+  return std::make_pair(slot.m_tpv, slot.m_bitsLeft);
 }
 
+size_t TargetPhraseCollectionCache::EstimateBytes(const TargetPhraseVector &tpv)
+{
+  // bookkeeping for the slot and index bucket
+  size_t ret = sizeof(Slot) + sizeof(TargetPhraseVector) + 4 * sizeof(void*);
+  for(TargetPhraseVector::const_iterator it = tpv.begin(); it != tpv.end(); it++)
+    ret += TargetPhraseCache::EstimateBytes(*it);
+  return ret;
+}
+}
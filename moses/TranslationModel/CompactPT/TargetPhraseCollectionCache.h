@@ -22,15 +22,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_TargetPhraseCollectionCache_h
 #define moses_TargetPhraseCollectionCache_h
 
-#include <map>
-#include <set>
 #include <vector>
 
-#include <boost/thread/tss.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
-#include "moses/Phrase.h"
-#include "moses/TargetPhraseCollection.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TranslationModel/TargetPhraseCache.h"
 
 namespace Moses
 {
@@ -39,125 +37,63 @@ namespace Moses
 typedef std::vector<TargetPhrase> TargetPhraseVector;
 typedef boost::shared_ptr<TargetPhraseVector> TargetPhraseVectorPtr;
 
-/** Implementation of Persistent Cache **/
+/** Decoded target phrase collections shared by all threads of a compact
+ * phrase table, keyed by the source phrase's id in its BlockHashIndex.
+ * Shards and the byte budget are those of TargetPhraseCacheShards.  Each
+ * shard evicts with the CLOCK algorithm: a hit only sets the entry's
+ * reference bit, and the hand gives referenced entries a second chance
+ * while it sweeps for space.
+ *
+ * Collections are handed out as shared_ptr copies and must not be
+ * modified once cached.
+ */
 class TargetPhraseCollectionCache
 {
-private:
-  size_t m_max;
-  float m_tolerance;
-
-  struct LastUsed {
-    clock_t m_clock;
-    TargetPhraseVectorPtr m_tpv;
-    size_t m_bitsLeft;
-
-    LastUsed() : m_clock(0), m_bitsLeft(0) {}
-
-    LastUsed(clock_t clock, TargetPhraseVectorPtr tpv, size_t bitsLeft = 0)
-      : m_clock(clock), m_tpv(tpv), m_bitsLeft(bitsLeft) {}
-  };
-
-  typedef std::map<Phrase, LastUsed> CacheMap;
-  static boost::thread_specific_ptr<CacheMap> m_phraseCache;
-
 public:
+  explicit TargetPhraseCollectionCache(size_t maxBytes);
 
-  typedef CacheMap::iterator iterator;
-  typedef CacheMap::const_iterator const_iterator;
-
-  TargetPhraseCollectionCache(size_t max = 5000, float tolerance = 0.2)
-    : m_max(max), m_tolerance(tolerance) {
-  }
+  /** cache the collection of sourceId unless it is cached already.
+   * bitsLeft marks where decoding of an incomplete collection stopped.
+   * Only the first maxRank phrases are kept if maxRank is set. */
+  void Cache(size_t sourceId, TargetPhraseVectorPtr tpv,
+             size_t bitsLeft = 0, size_t maxRank = 0);
 
-  iterator Begin() {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    return m_phraseCache->begin();
-  }
+  /** the cached collection of sourceId and its bitsLeft, or a null
+   * collection on a miss */
+  std::pair<TargetPhraseVectorPtr, size_t> Retrieve(size_t sourceId);
 
-  const_iterator Begin() const {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    return m_phraseCache->begin();
+  TargetPhraseCacheStats GetStats() const {
+    return m_shards.GetStats();
   }
 
-  iterator End() {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    return m_phraseCache->end();
-  }
+  //! approximate heap footprint of a collection and its phrases
+  static size_t EstimateBytes(const TargetPhraseVector &tpv);
 
-  const_iterator End() const {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    return m_phraseCache->end();
-  }
+private:
+  struct Slot {
+    size_t m_sourceId;
+    size_t m_bytes;
+    size_t m_bitsLeft;
+    bool m_referenced;
+    TargetPhraseVectorPtr m_tpv;
 
-  /** retrieve translations for source phrase from persistent cache **/
-  void Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
-             size_t bitsLeft = 0, size_t maxRank = 0) {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    // check if source phrase is already in cache
-    iterator it = m_phraseCache->find(sourcePhrase);
-    if(it != m_phraseCache->end())
-      // if found, just update clock
-      it->second.m_clock = clock();
-    else {
-      // else, add to cache
-      if(maxRank && tpv->size() > maxRank) {
-        TargetPhraseVectorPtr tpv_temp(new TargetPhraseVector());
-        tpv_temp->resize(maxRank);
-        std::copy(tpv->begin(), tpv->begin() + maxRank, tpv_temp->begin());
-        (*m_phraseCache)[sourcePhrase] = LastUsed(clock(), tpv_temp, bitsLeft);
-      } else
-        (*m_phraseCache)[sourcePhrase] = LastUsed(clock(), tpv, bitsLeft);
-    }
-  }
+    Slot() : m_sourceId(0), m_bytes(0), m_bitsLeft(0), m_referenced(false) {}
+  };
 
-  std::pair<TargetPhraseVectorPtr, size_t> Retrieve(const Phrase &sourcePhrase) {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    iterator it = m_phraseCache->find(sourcePhrase);
-    if(it != m_phraseCache->end()) {
-      LastUsed &lu = it->second;
-      lu.m_clock = clock();
-      return std::make_pair(lu.m_tpv, lu.m_bitsLeft);
-    } else
-      return std::make_pair(TargetPhraseVectorPtr(), 0);
-  }
+  struct Shard : public TargetPhraseCacheShard {
+    std::vector<Slot> slots;
+    std::vector<size_t> freeSlots;
+    boost::unordered_map<size_t, size_t> index;
+    size_t hand;
 
-  // if cache full, reduce
-  void Prune() {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    if(m_phraseCache->size() > m_max * (1 + m_tolerance)) {
-      typedef std::set<std::pair<clock_t, Phrase> > Cands;
-      Cands cands;
-      for(CacheMap::iterator it = m_phraseCache->begin();
-          it != m_phraseCache->end(); it++) {
-        LastUsed &lu = it->second;
-        cands.insert(std::make_pair(lu.m_clock, it->first));
-      }
-
-      for(Cands::iterator it = cands.begin(); it != cands.end(); it++) {
-        const Phrase& p = it->second;
-        m_phraseCache->erase(p);
-
-        if(m_phraseCache->size() < (m_max * (1 - m_tolerance)))
-          break;
-      }
+    Shard() : hand(0) {}
+    size_t Entries() const {
+      return index.size();
     }
-  }
-
-  void CleanUp() {
-    if(!m_phraseCache.get())
-      m_phraseCache.reset(new CacheMap());
-    m_phraseCache->clear();
-  }
+  };
 
+  TargetPhraseCacheShards<Shard> m_shards;
 };
-
 }
 
 #endif
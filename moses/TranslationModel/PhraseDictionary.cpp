@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cmath>
 #include <queue>
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/StaticData.h"
@@ -44,6 +45,14 @@ PhraseDictionary::PhraseDictionary(const std::string &line, bool registerNow)
   s_staticColl.push_back(this);
 }
 
+PhraseDictionary::~PhraseDictionary()
+{
+  if (m_sharedCache) {
+    VERBOSE(1, GetScoreProducerDescription() << " shared cache: "
+            << m_sharedCache->GetStats() << endl);
+  }
+}
+
 bool
 PhraseDictionary::
 ProvidesPrefixCheck() const
@@ -56,25 +65,16 @@ PhraseDictionary::
 GetTargetPhraseCollectionLEGACY(const Phrase& src) const
 {
   TargetPhraseCollection::shared_ptr ret;
-  typedef std::pair<TargetPhraseCollection::shared_ptr , clock_t> entry;
-  if (m_maxCacheSize) {
-    CacheColl &cache = GetCache();
-
+  if (m_maxCacheSize || m_sharedCache) {
     size_t hash = hash_value(src);
 
-    CacheColl::iterator iter;
-    iter = cache.find(hash);
-
-    if (iter == cache.end()) {
+    if (!FindInCache(hash, ret)) {
       // not in cache, need to look up from phrase table
       ret = GetTargetPhraseCollectionNonCacheLEGACY(src);
       if (ret) { // make a copy
         ret.reset(new TargetPhraseCollection(*ret));
       }
-      cache[hash] = entry(ret, clock());
-    } else { // in cache. just use it
-      iter->second.second = clock();
-      ret = iter->second.first;
+      AddToCache(hash, ret);
     }
   } else {
     // don't use cache. look up from phrase table
@@ -105,6 +105,9 @@ SetParameter(const std::string& key, const std::string& value)
 {
   if (key == "cache-size") {
     m_maxCacheSize = Scan<size_t>(value);
+  } else if (key == "cache-bytes") {
+    size_t maxBytes = Scan<size_t>(value);
+    m_sharedCache.reset(maxBytes ? new TargetPhraseCache(maxBytes) : NULL);
   } else if (key == "path") {
     m_filePath = value;
   } else if (key == "table-limit") {
@@ -167,6 +170,9 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 // reduce presistent cache by half of maximum size
 void PhraseDictionary::ReduceCache() const
 {
+  // the shared cache evicts as it goes
+  if (m_sharedCache) return;
+
   Timer reduceCacheTime;
   reduceCacheTime.start();
   CacheColl &cache = GetCache();
@@ -211,6 +217,31 @@ GetCache() const
   return *cache;
 }
 
+bool
+PhraseDictionary::
+FindInCache(size_t hash, TargetPhraseCollection::shared_ptr &ret) const
+{
+  if (m_sharedCache) return m_sharedCache->Find(hash, ret);
+
+  CacheColl &cache = GetCache();
+  CacheColl::iterator iter = cache.find(hash);
+  if (iter == cache.end()) return false;
+  iter->second.second = clock();
+  ret = iter->second.first;
+  return true;
+}
+
+void
+PhraseDictionary::
+AddToCache(size_t hash, const TargetPhraseCollection::shared_ptr &coll) const
+{
+  if (m_sharedCache) {
+    m_sharedCache->Add(hash, coll);
+  } else {
+    GetCache()[hash] = CacheCollEntry(coll, clock());
+  }
+}
+
 bool PhraseDictionary::SatisfyBackoff(const InputPath &inputPath) const
 {
   const Phrase &sourcePhrase = inputPath.GetPhrase();
@@ -244,5 +275,38 @@ bool PhraseDictionary::SatisfyBackoff(const InputPath &inputPath) const
   return true;
 }
 
+bool PhraseDictionary::StoredOrderMatchesWeights(const std::vector<float> &sortWeights) const
+{
+  if (sortWeights.empty()) {
+    return false;
+  }
+  std::vector<float> weights = StaticData::Instance().GetWeights(this);
+  if (weights.size() != sortWeights.size()) {
+    return false;
+  }
+
+  // scale by the largest stored weight, then every weight must agree
+  size_t largest = 0;
+  for (size_t i = 1; i < sortWeights.size(); ++i) {
+    if (std::fabs(sortWeights[i]) > std::fabs(sortWeights[largest])) {
+      largest = i;
+    }
+  }
+  if (sortWeights[largest] == 0) {
+    return false;
+  }
+  float scale = weights[largest] / sortWeights[largest];
+  if (!(scale > 0)) {
+    return false;
+  }
+  for (size_t i = 0; i < weights.size(); ++i) {
+    float expected = scale * sortWeights[i];
+    if (std::fabs(weights[i] - expected) > 1e-4 * (std::fabs(weights[i]) + std::fabs(expected))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 } // namespace
 
@@ -31,11 +31,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <vector>
 #include <string>
 #include <boost/unordered_map.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #ifdef WITH_THREADS
 #include <boost/thread/tss.hpp>
 #else
-#include <boost/scoped_ptr.hpp>
 #include <ctime>
 #endif
 
@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/InputPath.h"
 #include "moses/FF/DecodeFeature.h"
 #include "moses/ContextScope.h"
+#include "moses/TranslationModel/TargetPhraseCache.h"
 
 namespace Moses
 {
@@ -77,8 +78,7 @@ public:
 
   PhraseDictionary(const std::string &line, bool registerNow);
 
-  virtual ~PhraseDictionary() {
-  }
+  virtual ~PhraseDictionary();
 
   //! table limit number.
   size_t GetTableLimit() const {
@@ -131,6 +131,12 @@ public:
   virtual void CleanUpAfterSentenceProcessing(const InputType& source) {
   }
 
+  //! whether lookups can differ between sentences, because the table is
+  //! built per sentence, depends on the context or is updated while decoding
+  virtual bool IsContextDependent() const {
+    return false;
+  }
+
   //! Create a sentence-specific manager for SCFG rule lookup.
   virtual ChartRuleLookupManager *CreateRuleLookupManager(
     const ChartParser &,
@@ -168,9 +174,20 @@ protected:
 
   bool SatisfyBackoff(const InputPath &inputPath) const;
 
+  //! Binary tables may store each collection best first by CalcSortScore()
+  //! under weights fixed when the table was built. True if the current
+  //! weights of this table are a positive multiple of those, so that the
+  //! first m_tableLimit phrases can be read instead of pruning them all.
+  //! Empty sortWeights means the table isn't sorted.
+  bool StoredOrderMatchesWeights(const std::vector<float> &sortWeights) const;
+
   // cache
   size_t m_maxCacheSize; // 0 = no caching
 
+  // opt-in cache shared by all threads, bounded in bytes. Replaces the
+  // per-thread cache when set
+  boost::scoped_ptr<TargetPhraseCache> m_sharedCache;
+
 #ifdef WITH_THREADS
   //reader-writer lock
   mutable boost::thread_specific_ptr<CacheColl> m_cache;
@@ -186,6 +203,10 @@ protected:
 
 protected:
   CacheColl &GetCache() const;
+
+  //! look up hash in the shared cache if there is one, else this thread's
+  bool FindInCache(size_t hash, TargetPhraseCollection::shared_ptr &ret) const;
+  void AddToCache(size_t hash, const TargetPhraseCollection::shared_ptr &coll) const;
   size_t m_id;
 
 };
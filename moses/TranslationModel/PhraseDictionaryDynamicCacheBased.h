@@ -129,6 +129,9 @@ public:
   void SetParameter(const std::string& key, const std::string& value);
 
   void InitializeForInput(ttasksptr const& ttask);
+  bool IsContextDependent() const {
+    return true;
+  }
 
   //  virtual void InitializeForInput(InputType const&) {
   //    /* Don't do anything source specific here as this object is shared between threads.*/
@@ -142,6 +142,14 @@ void PhraseDictionaryGroup::InitializeForInput(const ttasksptr& ttask)
   // Member models are registered as FFs and should already be initialized
 }
 
+bool PhraseDictionaryGroup::IsContextDependent() const
+{
+  BOOST_FOREACH(const PhraseDictionary* pd, m_memberPDs) {
+    if (pd->IsContextDependent()) return true;
+  }
+  return false;
+}
+
 void PhraseDictionaryGroup::GetTargetPhraseCollectionBatch(
   const ttasksptr& ttask, const InputPathList& inputPathQueue) const
 {
@@ -80,6 +80,7 @@ public:
   TargetPhraseCollection::shared_ptr  GetTargetPhraseCollectionLEGACY(
     const ttasksptr& ttask, const Phrase& src) const;
   void InitializeForInput(ttasksptr const& ttask);
+  bool IsContextDependent() const;
   ChartRuleLookupManager* CreateRuleLookupManager(const ChartParser&,
       const ChartCellCollectionBase&, std::size_t);
   void SetParameter(const std::string& key, const std::string& value);
@@ -21,6 +21,9 @@ public:
   void Load(AllOptions::ptr const& opts);
 
   void InitializeForInput(ttasksptr const& ttask);
+  bool IsContextDependent() const {
+    return true;
+  }
 
   // for phrase-based model
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
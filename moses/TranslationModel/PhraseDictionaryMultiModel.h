@@ -112,6 +112,11 @@ public:
     // between threads.
   }
 
+  // the interpolation weights can be set per sentence
+  bool IsContextDependent() const {
+    return true;
+  }
+
   ChartRuleLookupManager*
   CreateRuleLookupManager(const ChartParser &, const ChartCellCollectionBase&,
                           std::size_t);
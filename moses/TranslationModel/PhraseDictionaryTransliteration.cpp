@@ -62,15 +62,10 @@ GetTargetPhraseCollection(InputPath &inputPath) const
   const Phrase &sourcePhrase = inputPath.GetPhrase();
   size_t hash = hash_value(sourcePhrase);
 
-  CacheColl &cache = GetCache();
-
-  CacheColl::iterator iter;
-  iter = cache.find(hash);
-
-  if (iter != cache.end()) {
+  TargetPhraseCollection::shared_ptr cached;
+  if (FindInCache(hash, cached)) {
     // already in cache
-    TargetPhraseCollection::shared_ptr tpColl = iter->second.first;
-    inputPath.SetTargetPhrases(*this, tpColl, NULL);
+    inputPath.SetTargetPhrases(*this, cached, NULL);
   } else {
     // TRANSLITERATE
     const util::temp_file inFile;
@@ -100,7 +95,7 @@ GetTargetPhraseCollection(InputPath &inputPath) const
       TargetPhrase *tp = *iter;
       tpColl->Add(tp);
     }
-    cache[hash] = CacheCollEntry(tpColl, clock());
+    AddToCache(hash, tpColl);
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
 }
@@ -13,6 +13,7 @@ namespace Moses
 ProbingPT::ProbingPT(const std::string &line)
   : PhraseDictionary(line,true)
   ,m_engine(NULL)
+  ,m_loadMethod(util::LAZY)
 {
   ReadParameters();
 
@@ -25,12 +26,21 @@ ProbingPT::~ProbingPT()
   delete m_engine;
 }
 
+void ProbingPT::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "load") {
+    m_loadMethod = util::ParseLoadMethod(value);
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 void ProbingPT::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
   SetFeaturesToApply();
 
-  m_engine = new QueryEngine(m_filePath.c_str());
+  m_engine = new QueryEngine(m_filePath.c_str(), m_loadMethod);
 
   m_unkId = 456456546456;
 
@@ -56,10 +66,10 @@ void ProbingPT::Load(AllOptions::ptr const& opts)
     const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
 
     unsigned int probingId = iter->first;
-
-    TargetVocabMap::value_type entry(factor, probingId);
-    m_vocabMap.insert(entry);
-
+    if (probingId >= m_targetFactors.size()) {
+      m_targetFactors.resize(probingId + 1, NULL);
+    }
+    m_targetFactors[probingId] = factor;
   }
 }
 
@@ -70,8 +80,6 @@ void ProbingPT::InitializeForInput(ttasksptr const& ttask)
 
 void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
-  CacheColl &cache = GetCache();
-
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
     InputPath &inputPath = **iter;
@@ -85,8 +93,7 @@ void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQue
 
     // add target phrase to phrase-table cache
     size_t hash = hash_value(sourcePhrase);
-    std::pair<TargetPhraseCollection::shared_ptr , clock_t> value(tpColl, clock());
-    cache[hash] = value;
+    AddToCache(hash, tpColl);
 
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
@@ -125,18 +132,19 @@ TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &s
     return tpColl;
   }
 
-  std::pair<bool, std::vector<target_text> > query_result;
+  // Target phrases stored best first under the current weights only need
+  // to be read up to the table limit
+  size_t readLimit = StoredOrderMatchesWeights(m_engine->getSortWeights()) ? m_tableLimit : 0;
 
-  //Actual lookup
-  query_result = m_engine->query(probingSource);
-
-  if (query_result.first) {
-    //m_engine->printTargetInfo(query_result.second);
+  //Actual lookup. The target phrases are decoded one at a time from the
+  //mapped table, so only the Moses target phrases are allocated.
+  QueryResult query_result;
+  if (m_engine->query(probingSource, query_result)) {
     tpColl.reset(new TargetPhraseCollection());
 
-    const std::vector<target_text> &probingTargetPhrases = query_result.second;
-    for (size_t i = 0; i < probingTargetPhrases.size(); ++i) {
-      const target_text &probingTargetPhrase = probingTargetPhrases[i];
+    target_view probingTargetPhrase;
+    while ((!readLimit || tpColl->GetSize() < readLimit)
+           && query_result.next(probingTargetPhrase)) {
       TargetPhrase *tp = CreateTargetPhrase(sourcePhrase, probingTargetPhrase);
 
       tpColl->Add(tp);
@@ -148,10 +156,10 @@ TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &s
   return tpColl;
 }
 
-TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const
+TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const target_view &probingTargetPhrase) const
 {
-  const std::vector<unsigned int> &probingPhrase = probingTargetPhrase.target_phrase;
-  size_t size = probingPhrase.size();
+  const unsigned int *probingPhrase = probingTargetPhrase.target_phrase;
+  size_t size = probingTargetPhrase.target_phrase_size;
 
   TargetPhrase *tp = new TargetPhrase(this);
 
@@ -166,8 +174,8 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
   }
 
   // score for this phrase table
-  vector<float> scores = probingTargetPhrase.prob;
-  std::transform(scores.begin(), scores.end(), scores.begin(),TransformScore);
+  vector<float> scores(probingTargetPhrase.prob_size);
+  std::transform(probingTargetPhrase.prob, probingTargetPhrase.prob + probingTargetPhrase.prob_size, scores.begin(), TransformScore);
   tp->GetScoreBreakdown().PlusEquals(this, scores);
 
   // alignment
@@ -187,10 +195,8 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
 
 const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
 {
-  TargetVocabMap::right_map::const_iterator iter;
-  iter = m_vocabMap.right.find(probingId);
-  if (iter != m_vocabMap.right.end()) {
-    return iter->second;
+  if (probingId < m_targetFactors.size()) {
+    return m_targetFactors[probingId];
   } else {
     // not in mapping. Must be UNK
     return NULL;
@@ -3,9 +3,10 @@
 
 #include <boost/bimap.hpp>
 #include "../PhraseDictionary.h"
+#include "util/mmap.hh"
 
 class QueryEngine;
-class target_text;
+struct target_view;
 
 namespace Moses
 {
@@ -23,6 +24,8 @@ public:
 
   void Load(AllOptions::ptr const& opts);
 
+  void SetParameter(const std::string& key, const std::string& value);
+
   void InitializeForInput(ttasksptr const& ttask);
 
   // for phrase-based model
@@ -39,15 +42,16 @@ public:
 
 protected:
   QueryEngine *m_engine;
+  util::LoadMethod m_loadMethod;
 
   typedef boost::bimap<const Factor *, uint64_t> SourceVocabMap;
   mutable SourceVocabMap m_sourceVocabMap;
 
-  typedef boost::bimap<const Factor *, unsigned int> TargetVocabMap;
-  mutable TargetVocabMap m_vocabMap;
+  // indexed by the probing target word id, which are dense from 1
+  std::vector<const Factor *> m_targetFactors;
 
   TargetPhraseCollection::shared_ptr CreateTargetPhrase(const Phrase &sourcePhrase) const;
-  TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const;
+  TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase, const target_view &probingTargetPhrase) const;
   const Factor *GetTargetFactor(uint64_t probingId) const;
   uint64_t GetSourceProbingId(const Factor *factor) const;
 
@@ -8,7 +8,9 @@ Huffman::Huffman (const char * filepath)
   //Init uniq_lines to zero;
   uniq_lines = 0;
 
-  line_text prev_line; //Check for unique lines.
+  //Check for unique lines. Copied, because the line it came from doesn't
+  //outlive the next read.
+  std::string prev_source;
   int num_lines = 0 ;
 
   while (true) {
@@ -26,11 +28,11 @@ Huffman::Huffman (const char * filepath)
       break;
     }
 
-    if (new_line.source_phrase == prev_line.source_phrase) {
+    if (uniq_lines && new_line.source_phrase == StringPiece(prev_source)) {
       continue;
     } else {
       uniq_lines++;
-      prev_line = new_line;
+      prev_source.assign(new_line.source_phrase.data(), new_line.source_phrase.size());
     }
   }
 
@@ -87,6 +87,9 @@ public:
   const std::map<unsigned int, std::vector<unsigned char> > get_word_all1_lookup_map() const {
     return lookup_word_all1;
   }
+  const std::vector<unsigned char> &get_word_all1(unsigned int id) const {
+    return lookup_word_all1.find(id)->second;
+  }
 
   inline std::string getTargetWordFromID(unsigned int id);
 
@@ -27,6 +27,16 @@ struct target_text {
   std::vector<unsigned char> word_all1;
 };
 
+//A target phrase decoded in place from the binary table. The pointers are
+//only valid until the next target phrase is decoded.
+struct target_view {
+  const unsigned int * target_phrase;
+  size_t target_phrase_size;
+  const float * prob;
+  size_t prob_size;
+  unsigned int word_all1_id; //Look up with HuffmanDecoder::get_word_all1
+};
+
 //Ask if it's better to have it receive a pointer to a line_text struct
 line_text splitLine(StringPiece textin);
 
@@ -1,29 +1,8 @@
 #include "quering.hh"
+#include <cstring> //memcpy
+#include <sstream>
 
-unsigned char * read_binary_file(const char * filename, size_t filesize)
-{
-  //Get filesize
-  int fd;
-  unsigned char * map;
-
-  fd = open(filename, O_RDONLY);
-
-  if (fd == -1) {
-    perror("Error opening file for reading");
-    exit(EXIT_FAILURE);
-  }
-
-  map = (unsigned char *)mmap(0, filesize, PROT_READ, MAP_SHARED, fd, 0);
-  if (map == MAP_FAILED) {
-    close(fd);
-    perror("Error mmapping the file");
-    exit(EXIT_FAILURE);
-  }
-
-  return map;
-}
-
-QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
+QueryEngine::QueryEngine(const char * filepath, util::LoadMethod load_method) : decoder(filepath)
 {
 
   //Create filepaths
@@ -61,18 +40,27 @@ QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
     is_reordering = true;
     std::cerr << "WARNING. REORDERING TABLES NOT SUPPORTED YET." << std::endl;
   }
+  //Weights the target phrases were sorted by, if any
+  if (getline(config, line)) {
+    std::istringstream weights(line);
+    float weight;
+    while (weights >> weight) {
+      sort_weights.push_back(weight);
+    }
+  }
   config.close();
 
-  //Mmap binary table
-  struct stat filestatus;
-  stat(path_to_data_bin.c_str(), &filestatus);
-  binary_filesize = filestatus.st_size;
-  binary_mmaped = read_binary_file(path_to_data_bin.c_str(), binary_filesize);
+  //Map binary table
+  util::scoped_fd binary_fd(util::OpenReadOrThrow(path_to_data_bin.c_str()));
+  binary_filesize = util::SizeOrThrow(binary_fd.get());
+  util::MapRead(load_method, binary_fd.get(), 0, binary_filesize, binary_mem);
+  binary_mmaped = static_cast<unsigned char *>(binary_mem.get());
 
   //Read hashtable
   table_filesize = Table::Size(tablesize, 1.2);
-  mem = readTable(path_to_hashtable.c_str(), table_filesize);
-  Table table_init(mem, table_filesize);
+  util::scoped_fd table_fd(util::OpenReadOrThrow(path_to_hashtable.c_str()));
+  util::MapRead(load_method, table_fd.get(), 0, table_filesize, table_mem);
+  Table table_init(table_mem.get(), table_filesize);
   table = table_init;
 
   std::cerr << "Initialized successfully! " << std::endl;
@@ -80,88 +68,109 @@ QueryEngine::QueryEngine(const char * filepath) : decoder(filepath)
 
 QueryEngine::~QueryEngine()
 {
-  //Clear mmap content from memory.
-  munmap(binary_mmaped, binary_filesize);
-  munmap(mem, table_filesize);
+}
+
+namespace
+{
 
+//Variable byte decodes one number and moves it past it.
+inline unsigned int vbyte_decode(const unsigned char *&it)
+{
+  unsigned int retvalue = 0;
+  unsigned char shift = 0;
+  while (*it & 0x80) {
+    retvalue |= (*it++ & 0x7f) << shift;
+    shift += 7;
+  }
+  return retvalue | (*it++ << shift);
 }
 
-std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64_t> source_phrase)
+uint64_t source_key(const std::vector<uint64_t> &source_phrase)
 {
-  bool found;
-  std::vector<target_text> translation_entries;
-  const Entry * entry;
   //TOO SLOW
   //uint64_t key = util::MurmurHashNative(&source_phrase[0], source_phrase.size());
   uint64_t key = 0;
-  for (int i = 0; i < source_phrase.size(); i++) {
+  for (size_t i = 0; i < source_phrase.size(); i++) {
     key += (source_phrase[i] << i);
   }
+  return key;
+}
 
+} // namespace
 
-  found = table.Find(key, entry);
-
-  if (found) {
-    //The phrase that was searched for was found! We need to get the translation entries.
-    //We will read the largest entry in bytes and then filter the unnecesarry with functions
-    //from line_splitter
-    uint64_t initial_index = entry -> GetValue();
-    unsigned int bytes_toread = entry -> bytes_toread;
-
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
-    }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
+void QueryResult::reset(const unsigned char * begin, const unsigned char * finish, int scores_per_phrase)
+{
+  current = begin;
+  end = finish;
+  num_scores = scores_per_phrase;
+}
 
+bool QueryResult::next(target_view &out)
+{
+  //Each target phrase is: word ids, 0, exactly num_scores scores (which may
+  //be 0 themselves), 0, alignment id, 0.
+  if (current >= end) {
+    return false;
   }
+  words.clear();
+  for (unsigned int id; current < end && (id = vbyte_decode(current)) != 0; ) {
+    words.push_back(id);
+  }
+  scores.resize(num_scores);
+  for (int i = 0; i < num_scores && current < end; i++) {
+    unsigned int bits = vbyte_decode(current);
+    memcpy(&scores[i], &bits, sizeof(float));
+  }
+  //The zero after the scores, the alignment and the closing zero
+  if (end - current < 3) {
+    //Truncated entry, which full_decode_line used to drop as well.
+    current = end;
+    return false;
+  }
+  vbyte_decode(current);
+  out.word_all1_id = vbyte_decode(current);
+  vbyte_decode(current);
+
+  out.target_phrase = words.empty() ? NULL : &words[0];
+  out.target_phrase_size = words.size();
+  out.prob = scores.empty() ? NULL : &scores[0];
+  out.prob_size = scores.size();
+  return true;
+}
 
-  std::pair<bool, std::vector<target_text> > output (found, translation_entries);
-
-  return output;
+bool QueryEngine::query(const std::vector<uint64_t> &source_phrase, QueryResult &result) const
+{
+  const Entry * entry;
+  if (!table.Find(source_key(source_phrase), entry)) {
+    return false;
+  }
+  const unsigned char * begin = binary_mmaped + entry -> GetValue();
+  result.reset(begin, begin + entry -> bytes_toread, num_scores);
+  return true;
+}
 
+target_text QueryEngine::decode(const target_view &view) const
+{
+  target_text ret;
+  ret.target_phrase.assign(view.target_phrase, view.target_phrase + view.target_phrase_size);
+  ret.prob.assign(view.prob, view.prob + view.prob_size);
+  ret.word_all1 = decoder.get_word_all1(view.word_all1_id);
+  return ret;
 }
 
 std::pair<bool, std::vector<target_text> > QueryEngine::query(StringPiece source_phrase)
 {
-  bool found;
   std::vector<target_text> translation_entries;
-  const Entry * entry;
   //Convert source frase to VID
   std::vector<uint64_t> source_phrase_vid = getVocabIDs(source_phrase);
-  //TOO SLOW
-  //uint64_t key = util::MurmurHashNative(&source_phrase_vid[0], source_phrase_vid.size());
-  uint64_t key = 0;
-  for (int i = 0; i < source_phrase_vid.size(); i++) {
-    key += (source_phrase_vid[i] << i);
-  }
-
-  found = table.Find(key, entry);
-
 
+  QueryResult result;
+  bool found = query(source_phrase_vid, result);
   if (found) {
-    //The phrase that was searched for was found! We need to get the translation entries.
-    //We will read the largest entry in bytes and then filter the unnecesarry with functions
-    //from line_splitter
-    uint64_t initial_index = entry -> GetValue();
-    unsigned int bytes_toread = entry -> bytes_toread;
-    //At the end of the file we can't readd + largest_entry cause we get a segfault.
-    std::cerr << "Entry size is bytes is: " << bytes_toread << std::endl;
-
-    //ASK HIEU FOR MORE EFFICIENT WAY TO DO THIS!
-    std::vector<unsigned char> encoded_text; //Assign to the vector the relevant portion of the array.
-    encoded_text.reserve(bytes_toread);
-    for (int i = 0; i < bytes_toread; i++) {
-      encoded_text.push_back(binary_mmaped[i+initial_index]);
+    target_view view;
+    while (result.next(view)) {
+      translation_entries.push_back(decode(view));
     }
-
-    //Get only the translation entries necessary
-    translation_entries = decoder.full_decode_line(encoded_text, num_scores);
-
   }
 
   std::pair<bool, std::vector<target_text> > output (found, translation_entries);
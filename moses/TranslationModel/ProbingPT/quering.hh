@@ -6,19 +6,40 @@
 #include <sys/stat.h> //For finding size of file
 #include "vocabid.hh"
 #include <algorithm> //toLower
+#include "util/file.hh"
+#include "util/mmap.hh"
 #define API_VERSION 3
 
+//The target phrases of one source phrase, decoded one at a time straight from
+//the mapped binary table instead of being copied out and decoded up front.
+class QueryResult
+{
+  const unsigned char * current;
+  const unsigned char * end;
+  int num_scores;
+
+  //Scratch space reused by every target phrase
+  std::vector<unsigned int> words;
+  std::vector<float> scores;
+
+public:
+  QueryResult() : current(NULL), end(NULL), num_scores(0) {}
+  void reset(const unsigned char * begin, const unsigned char * finish, int scores_per_phrase);
+
+  //Decodes the next target phrase. Returns false when there are no more.
+  bool next(target_view &out);
+};
 
-char * read_binary_file(char * filename);
 
 class QueryEngine
 {
+  util::scoped_memory binary_mem;
   unsigned char * binary_mmaped; //The binari phrase table file
   std::map<unsigned int, std::string> vocabids;
   std::map<uint64_t, std::string> source_vocabids;
 
   Table table;
-  char *mem; //Memory for the table, necessary so that we can correctly destroy the object
+  util::scoped_memory table_mem; //Memory for the table
 
   HuffmanDecoder decoder;
 
@@ -26,11 +47,15 @@ class QueryEngine
   size_t table_filesize;
   int num_scores;
   bool is_reordering;
+  std::vector<float> sort_weights; //Empty unless the target phrases are stored best first
 public:
-  QueryEngine (const char *);
+  QueryEngine (const char *, util::LoadMethod load_method = util::LAZY);
   ~QueryEngine();
   std::pair<bool, std::vector<target_text> > query(StringPiece source_phrase);
-  std::pair<bool, std::vector<target_text> > query(std::vector<uint64_t> source_phrase);
+  //Points result at the target phrases of source_phrase without copying them.
+  //Safe to call from several threads at once.
+  bool query(const std::vector<uint64_t> &source_phrase, QueryResult &result) const;
+  target_text decode(const target_view &view) const;
   void printTargetInfo(std::vector<target_text> target_phrases);
   const std::map<unsigned int, std::string> getVocab() const {
     return decoder.get_target_lookup_map();
@@ -40,6 +65,10 @@ public:
     return source_vocabids;
   }
 
+  const std::vector<float> &getSortWeights() const {
+    return sort_weights;
+  }
+
 };
 
 
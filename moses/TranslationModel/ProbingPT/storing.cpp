@@ -1,4 +1,7 @@
 #include "storing.hh"
+#include "moses/Util.h"
+
+#include <algorithm>
 
 BinaryFileWriter::BinaryFileWriter (std::string basepath) : os ((basepath + "/binfile.dat").c_str(), std::ios::binary)
 {
@@ -38,8 +41,52 @@ BinaryFileWriter::~BinaryFileWriter ()
   binfile.clear();
 }
 
+namespace
+{
+
+//An encoded target phrase waiting for the rest of its source phrase
+struct pending_line {
+  float score;
+  std::vector<unsigned char> encoded;
+};
+
+struct pending_line_better {
+  bool operator()(const pending_line &left, const pending_line &right) const {
+    return left.score > right.score;
+  }
+};
+
+uint64_t source_key(StringPiece source_phrase)
+{
+  //The key is the sum of hashes of individual words bitshifted by their position in the phrase.
+  //Probably not entirerly correct, but fast and seems to work fine in practise.
+  uint64_t key = 0;
+  std::vector<uint64_t> vocabid_source = getVocabIDs(source_phrase);
+  for (size_t i = 0; i < vocabid_source.size(); i++) {
+    key += (vocabid_source[i] << i);
+  }
+  return key;
+}
+
+float sort_score(StringPiece prob, const std::vector<float> &sort_weights)
+{
+  std::vector<float> scores;
+  for (util::TokenIter<util::SingleCharacter> probit(prob, util::SingleCharacter(' ')); probit; probit++) {
+    //Same conversion as Huffman::encode_line
+    scores.push_back((float)atof(probit->data()));
+  }
+  if (scores.size() != sort_weights.size()) {
+    std::cerr << "Expected " << sort_weights.size() << " scores to sort by, found " << scores.size() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return Moses::CalcSortScore(&scores[0], sort_weights);
+}
+
+} // namespace
+
 void createProbingPT(const char * phrasetable_path, const char * target_path,
-                     const char * num_scores, const char * is_reordering)
+                     const char * num_scores, const char * is_reordering,
+                     const std::vector<float> &sort_weights)
 {
   //Get basepath and create directory if missing
   std::string basepath(target_path);
@@ -68,80 +115,65 @@ void createProbingPT(const char * phrasetable_path, const char * target_path,
 
   BinaryFileWriter binfile(basepath); //Init the binary file writer.
 
-  line_text prev_line; //Check if the source phrase of the previous line is the same
+  //The source phrase of the target phrases in pending. Copied, because
+  //the line it came from doesn't outlive the next read.
+  std::string prev_source;
+  bool first_line = true;
+  std::vector<pending_line> pending;
 
   //Keep track of the size of each group of target phrases
   uint64_t entrystartidx = 0;
-  //uint64_t line_num = 0;
-
 
   //Read everything and processs
   while(true) {
+    bool finished = false;
+    line_text line;
     try {
       //Process line read
-      line_text line;
       line = splitLine(filein.ReadLine());
-      //Add source phrases to vocabularyIDs
-      add_to_map(&source_vocabids, line.source_phrase);
-
-      if ((binfile.dist_from_start + binfile.extra_counter) == 0) {
-        prev_line = line; //For the first iteration assume the previous line is
-      } //The same as this one.
-
-      if (line.source_phrase != prev_line.source_phrase) {
-
-        //Create a new entry even
-
-        //Create an entry for the previous source phrase:
-        Entry pesho;
-        pesho.value = entrystartidx;
-        //The key is the sum of hashes of individual words bitshifted by their position in the phrase.
-        //Probably not entirerly correct, but fast and seems to work fine in practise.
-        pesho.key = 0;
-        std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-        for (int i = 0; i < vocabid_source.size(); i++) {
-          pesho.key += (vocabid_source[i] << i);
-        }
-        pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
-
-        //Put into table
-        table.Insert(pesho);
-
-        entrystartidx = binfile.dist_from_start + binfile.extra_counter; //Designate start idx for new entry
-
-        //Encode a line and write it to disk.
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
-
-        //Set prevLine
-        prev_line = line;
-
-      } else {
-        //If we still have the same line, just append to it:
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
-      }
-
     } catch (util::EndOfFileException e) {
       std::cerr << "Reading phrase table finished, writing remaining files to disk." << std::endl;
-      binfile.flush();
+      finished = true;
+    }
+
+    if (!first_line && (finished || line.source_phrase != StringPiece(prev_source))) {
+      //All target phrases of the previous source phrase are in, write them
+      if (!sort_weights.empty()) {
+        std::stable_sort(pending.begin(), pending.end(), pending_line_better());
+      }
+      for (std::vector<pending_line>::iterator it = pending.begin(); it != pending.end(); ++it) {
+        binfile.write(&it->encoded);
+      }
+      pending.clear();
 
-      //After the final entry is constructed we need to add it to the phrase_table
       //Create an entry for the previous source phrase:
       Entry pesho;
       pesho.value = entrystartidx;
-      //The key is the sum of hashes of individual words. Probably not entirerly correct, but fast
-      pesho.key = 0;
-      std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-      for (int i = 0; i < vocabid_source.size(); i++) {
-        pesho.key += (vocabid_source[i] << i);
-      }
+      pesho.key = source_key(prev_source);
       pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
+
       //Put into table
       table.Insert(pesho);
 
+      entrystartidx = binfile.dist_from_start + binfile.extra_counter; //Designate start idx for new entry
+    }
+
+    if (finished) {
+      binfile.flush();
       break;
     }
+
+    //Add source phrases to vocabularyIDs
+    add_to_map(&source_vocabids, line.source_phrase);
+    if (first_line || line.source_phrase != StringPiece(prev_source)) {
+      prev_source.assign(line.source_phrase.data(), line.source_phrase.size());
+      first_line = false;
+    }
+
+    //Encode a line and keep it until its source phrase is complete.
+    pending.push_back(pending_line());
+    pending.back().score = sort_weights.empty() ? 0.0 : sort_score(line.prob, sort_weights);
+    pending.back().encoded = huffmanEncoder.full_encode_line(line);
   }
 
   serialize_table(mem, size, (basepath + "/probing_hash.dat").c_str());
@@ -157,5 +189,12 @@ void createProbingPT(const char * phrasetable_path, const char * target_path,
   configfile << uniq_entries << '\n';
   configfile << num_scores << '\n';
   configfile << is_reordering << '\n';
+  //Optional: the weights the target phrases are sorted by
+  if (!sort_weights.empty()) {
+    for (size_t i = 0; i < sort_weights.size(); ++i) {
+      configfile << (i ? " " : "") << sort_weights[i];
+    }
+    configfile << '\n';
+  }
   configfile.close();
 }
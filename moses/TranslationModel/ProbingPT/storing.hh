@@ -14,8 +14,12 @@
 #include "vocabid.hh"
 #define API_VERSION 3
 
+//If sort_weights is not empty, the target phrases of each source phrase are
+//stored best first by their weighted log score so that the decoder can stop
+//reading at the table limit.
 void createProbingPT(const char * phrasetable_path, const char * target_path,
-                     const char * num_scores, const char * is_reordering);
+                     const char * num_scores, const char * is_reordering,
+                     const std::vector<float> &sort_weights = std::vector<float>());
 
 class BinaryFileWriter
 {
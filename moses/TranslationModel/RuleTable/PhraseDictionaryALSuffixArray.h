@@ -25,6 +25,9 @@ public:
   PhraseDictionaryALSuffixArray(const std::string &line);
   void Load(AllOptions::ptr const& opts);
   void InitializeForInput(ttasksptr const& ttask);
+  bool IsContextDependent() const {
+    return true;
+  }
   void CleanUpAfterSentenceProcessing(const InputType& source);
 
 protected:
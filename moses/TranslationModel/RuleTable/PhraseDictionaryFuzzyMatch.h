@@ -53,6 +53,9 @@ public:
     const ChartCellCollectionBase &,
     std::size_t);
   void InitializeForInput(ttasksptr const& ttask);
+  bool IsContextDependent() const {
+    return true;
+  }
   void CleanUpAfterSentenceProcessing(const InputType& source);
 
   void SetParameter(const std::string& key, const std::string& value);
@@ -29,11 +29,7 @@
 #include "OnDiskPt/Word.h"
 #include "OnDiskPt/PhraseNode.h"
 
-#ifdef WITH_THREADS
-#include <boost/thread/tss.hpp>
-#else
 #include <boost/scoped_ptr.hpp>
-#endif
 
 namespace Moses
 {
@@ -51,11 +47,9 @@ class PhraseDictionaryOnDisk : public PhraseDictionary
   friend class ChartRuleLookupManagerOnDisk;
 
 protected:
-#ifdef WITH_THREADS
-  boost::thread_specific_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
-#else
+  // Loaded once and read by all threads.  The wrapper maps the table, so
+  // lookups don't share a file position.
   boost::scoped_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
-#endif
 
   size_t m_maxSpanDefault, m_maxSpanLabelled;
 
@@ -65,6 +59,12 @@ protected:
   void GetTargetPhraseCollectionBatch(InputPath &inputPath) const;
 
 public:
+  //! How many rules of a collection to read. Collections are stored best
+  //! first, so this is the table limit unless the table was sorted by
+  //! weights other than the current ones: then all rules are read and
+  //! sorted again.
+  size_t GetReadLimit() const;
+
   PhraseDictionaryOnDisk(const std::string &line);
   ~PhraseDictionaryOnDisk();
   void Load(AllOptions::ptr const& opts);
@@ -0,0 +1,133 @@
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "moses/TranslationModel/TargetPhraseCache.h"
+#include "moses/TargetPhrase.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TargetPhraseCache::TargetPhraseCache(size_t maxBytes)
+  : m_shards(maxBytes)
+{
+}
+
+bool
+TargetPhraseCache::
+Find(size_t hash, TargetPhraseCollection::shared_ptr &ret)
+{
+  Shard &shard = m_shards.Get(hash);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.lock);
+#endif
+  Index::iterator found = shard.index.find(hash);
+  if (found == shard.index.end()) {
+    ++shard.misses;
+    return false;
+  }
+  ++shard.hits;
+  // move to the front; splice keeps the stored iterator valid
+  shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+  ret = found->second->coll;
+  return true;
+}
+
+void
+TargetPhraseCache::
+Add(size_t hash, const TargetPhraseCollection::shared_ptr &coll)
+{
+  Entry entry;
+  entry.hash = hash;
+  entry.bytes = EstimateBytes(coll.get());
+  entry.coll = coll;
+
+  // declared before the lock so that evicted collections, which can be slow
+  // to delete, are released after it has been dropped
+  std::list<Entry> evicted;
+
+  Shard &shard = m_shards.Get(hash);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.lock);
+#endif
+  Index::iterator found = shard.index.find(hash);
+  if (found != shard.index.end()) {
+    // another thread got there first, or the caller is replacing the entry
+    shard.bytes -= found->second->bytes;
+    evicted.splice(evicted.end(), shard.lru, found->second);
+    shard.index.erase(found);
+  }
+
+  shard.lru.push_front(entry);
+  shard.index[hash] = shard.lru.begin();
+  shard.bytes += entry.bytes;
+
+  // never evict the entry just added, even if it alone exceeds the budget
+  while (shard.bytes > m_shards.GetMaxShardBytes() && shard.lru.size() > 1) {
+    LRUList::iterator last = --shard.lru.end();
+    shard.bytes -= last->bytes;
+    shard.index.erase(last->hash);
+    evicted.splice(evicted.end(), shard.lru, last);
+    ++shard.evictions;
+  }
+}
+
+size_t
+TargetPhraseCache::
+EstimateBytes(const TargetPhraseCollection *coll)
+{
+  // bookkeeping for the list node and index bucket
+  size_t ret = sizeof(Entry) + 4 * sizeof(void*);
+  if (coll == NULL) return ret;
+
+  ret += sizeof(TargetPhraseCollection)
+         + coll->GetSize() * sizeof(const TargetPhrase*);
+  TargetPhraseCollection::const_iterator iter;
+  for (iter = coll->begin(); iter != coll->end(); ++iter) {
+    ret += EstimateBytes(**iter);
+  }
+  return ret;
+}
+
+size_t
+TargetPhraseCache::
+EstimateBytes(const TargetPhrase &tp)
+{
+  return sizeof(TargetPhrase)
+         + tp.GetSize() * sizeof(Word)
+         + tp.GetScoreBreakdown().Size() * sizeof(FValue);
+}
+
+std::ostream& operator<<(std::ostream& out, const TargetPhraseCacheStats& stats)
+{
+  size_t lookups = stats.hits + stats.misses;
+  out << "hits=" << stats.hits
+      << " misses=" << stats.misses
+      << " evictions=" << stats.evictions
+      << " entries=" << stats.entries
+      << " bytes=" << stats.bytes;
+  if (lookups) {
+    out << " hit-rate=" << (100.0 * stats.hits / lookups) << "%";
+  }
+  return out;
+}
+
+}
@@ -0,0 +1,163 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <iostream>
+#include <list>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "moses/TargetPhraseCollection.h"
+
+namespace Moses
+{
+
+struct TargetPhraseCacheStats {
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+  size_t entries;
+  size_t bytes;
+};
+
+std::ostream& operator<<(std::ostream& out, const TargetPhraseCacheStats& stats);
+
+/** Counters and lock of one cache shard.  A cache's shard type derives from
+ * this, adds its entries and reports their number with Entries(). */
+struct TargetPhraseCacheShard {
+  size_t bytes;
+  size_t hits, misses, evictions;
+#ifdef WITH_THREADS
+  mutable boost::mutex lock;
+#endif
+  TargetPhraseCacheShard() : bytes(0), hits(0), misses(0), evictions(0) {}
+};
+
+/** The shards of a cache shared by all decoding threads.  The capacity is a
+ * byte budget, split evenly over independently locked shards so that threads
+ * rarely contend.  Callers lock the shard of a key themselves and keep its
+ * counters; how a shard evicts is up to them.
+ */
+template <class Shard>
+class TargetPhraseCacheShards
+{
+public:
+  static const size_t kShardBits = 5;
+  static const size_t kShards = 1 << kShardBits;
+
+  explicit TargetPhraseCacheShards(size_t maxBytes)
+    : m_maxShardBytes(maxBytes / kShards) {
+  }
+
+  //! the shard holding key, in [0, kShards)
+  static size_t GetShardIndex(size_t key) {
+    // keys may be file offsets or neighbouring ids, so mix before taking
+    // the top bits
+    uint64_t mixed = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+    return mixed >> (64 - kShardBits);
+  }
+
+  Shard &Get(size_t key) {
+    return m_shards[GetShardIndex(key)];
+  }
+
+  size_t GetMaxShardBytes() const {
+    return m_maxShardBytes;
+  }
+
+  TargetPhraseCacheStats GetStats() const {
+    TargetPhraseCacheStats ret = TargetPhraseCacheStats();
+    for (size_t i = 0; i < kShards; ++i) {
+      const Shard &shard = m_shards[i];
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(shard.lock);
+#endif
+      ret.hits += shard.hits;
+      ret.misses += shard.misses;
+      ret.evictions += shard.evictions;
+      ret.entries += shard.Entries();
+      ret.bytes += shard.bytes;
+    }
+    return ret;
+  }
+
+private:
+  Shard m_shards[kShards];
+  size_t m_maxShardBytes;
+};
+
+/** LRU cache of target phrase collections shared by all decoding threads.
+ * Keys are source phrase hashes, as in the per-thread CacheColl of
+ * PhraseDictionary.  See TargetPhraseCacheShards for how the byte budget
+ * is split.
+ *
+ * Collections are handed out as shared_ptr copies, so an entry evicted while
+ * another thread still uses it stays alive until that thread lets go.
+ * Cached collections must not be modified after they are added.
+ */
+class TargetPhraseCache
+{
+public:
+  explicit TargetPhraseCache(size_t maxBytes);
+
+  /** look up hash; returns false on a miss.  A hit may yield a null
+   * collection, which records that the source phrase has no translations */
+  bool Find(size_t hash, TargetPhraseCollection::shared_ptr &ret);
+
+  //! add or replace the collection for hash, evicting old entries as needed
+  void Add(size_t hash, const TargetPhraseCollection::shared_ptr &coll);
+
+  TargetPhraseCacheStats GetStats() const {
+    return m_shards.GetStats();
+  }
+
+  //! approximate heap footprint of a collection and its phrases
+  static size_t EstimateBytes(const TargetPhraseCollection *coll);
+
+  //! approximate heap footprint of one phrase, for caches of other containers
+  static size_t EstimateBytes(const TargetPhrase &tp);
+
+protected:
+  struct Entry {
+    size_t hash;
+    size_t bytes;
+    TargetPhraseCollection::shared_ptr coll;
+  };
+  // most recently used at the front
+  typedef std::list<Entry> LRUList;
+  typedef boost::unordered_map<size_t, LRUList::iterator> Index;
+
+  struct Shard : public TargetPhraseCacheShard {
+    LRUList lru;
+    Index index;
+    size_t Entries() const {
+      return lru.size();
+    }
+  };
+
+  TargetPhraseCacheShards<Shard> m_shards;
+};
+
+}
@@ -256,6 +256,7 @@ namespace Moses
 
     // task setup and takedown functions
     void InitializeForInput(ttasksptr const& ttask);
+    bool IsContextDependent() const { return true; }
     // void CleanUpAfterSentenceProcessing(const InputType& source);
     void CleanUpAfterSentenceProcessing(ttasksptr const& ttask);
 
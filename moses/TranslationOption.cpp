@@ -48,6 +48,15 @@ TranslationOption::TranslationOption(const Range &range
 {
 }
 
+TranslationOption::TranslationOption(const Range &range
+                                     , const TranslationOption &copy)
+  : m_targetPhrase(copy.m_targetPhrase)
+  , m_inputPath(NULL)
+  , m_sourceWordsRange(range)
+  , m_futureScore(copy.m_futureScore)
+{
+}
+
 bool TranslationOption::IsCompatible(const Phrase& phrase, const std::vector<FactorType>& featuresToCheck) const
 {
   if (featuresToCheck.size() == 1) {
@@ -94,6 +94,11 @@ public:
   TranslationOption(const Range &range
                     , const TargetPhrase &targetPhrase);
 
+  /** copy of an option moved to another source range, without input path.
+   * Used to reuse options across sentences */
+  TranslationOption(const Range &range
+                    , const TranslationOption &copy);
+
   /** returns true if all feature types in featuresToCheck are compatible between the two phrases */
   bool IsCompatible(const Phrase& phrase, const std::vector<FactorType>& featuresToCheck) const;
 
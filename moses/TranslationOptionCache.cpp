@@ -0,0 +1,157 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include "TranslationOptionCache.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TranslationOptionCache TranslationOptionCache::s_instance;
+
+TranslationOptionCache::TranslationOptionCache()
+  : m_maxSize(0)
+  , m_generation(0)
+  , m_hits(0)
+  , m_misses(0)
+  , m_invalidations(0)
+{
+}
+
+size_t
+TranslationOptionCache::KeyHasher::
+operator()(const Key &key) const
+{
+  size_t seed = hash_value(key.source);
+  boost::hash_combine(seed, key.graphInd);
+  return seed;
+}
+
+void
+TranslationOptionCache::
+SetMaxSize(size_t maxSize)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_lock);
+#endif
+  m_maxSize = maxSize;
+  while (m_lru.size() > m_maxSize) {
+    m_index.erase(m_lru.back().first);
+    m_lru.pop_back();
+  }
+}
+
+TranslationOptionCache::OptionsPtr
+TranslationOptionCache::
+Find(size_t graphInd, const Phrase &source, size_t &generation)
+{
+  Key key;
+  key.graphInd = graphInd;
+  key.source = source;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_lock);
+#endif
+  generation = m_generation;
+  Index::iterator found = m_index.find(key);
+  if (found == m_index.end()) {
+    ++m_misses;
+    return OptionsPtr();
+  }
+  ++m_hits;
+  m_lru.splice(m_lru.begin(), m_lru, found->second);
+  return found->second->second;
+}
+
+void
+TranslationOptionCache::
+Add(size_t graphInd, const Phrase &source, const OptionsPtr &options, size_t generation)
+{
+  Key key;
+  key.graphInd = graphInd;
+  key.source = source;
+
+  // released after the lock, see TargetPhraseCache::Add
+  LRUList evicted;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_lock);
+#endif
+  if (generation != m_generation || m_maxSize == 0) return;
+
+  Index::iterator found = m_index.find(key);
+  if (found != m_index.end()) {
+    // another thread translated the same phrase at the same time
+    m_lru.splice(m_lru.begin(), m_lru, found->second);
+    return;
+  }
+
+  m_lru.push_front(make_pair(key, options));
+  m_index[key] = m_lru.begin();
+  while (m_lru.size() > m_maxSize) {
+    LRUList::iterator last = --m_lru.end();
+    m_index.erase(last->first);
+    evicted.splice(evicted.end(), m_lru, last);
+  }
+}
+
+void
+TranslationOptionCache::
+Invalidate()
+{
+  LRUList evicted;
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_lock);
+#endif
+  ++m_generation;
+  if (m_lru.empty()) return;
+  ++m_invalidations;
+  m_index.clear();
+  evicted.swap(m_lru);
+}
+
+TranslationOptionCacheStats
+TranslationOptionCache::
+GetStats() const
+{
+  TranslationOptionCacheStats ret;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_lock);
+#endif
+  ret.hits = m_hits;
+  ret.misses = m_misses;
+  ret.invalidations = m_invalidations;
+  ret.entries = m_lru.size();
+  return ret;
+}
+
+std::ostream& operator<<(std::ostream& out, const TranslationOptionCacheStats& stats)
+{
+  out << "Translation option cache: hits=" << stats.hits
+      << " misses=" << stats.misses
+      << " invalidations=" << stats.invalidations
+      << " entries=" << stats.entries;
+  return out;
+}
+
+}
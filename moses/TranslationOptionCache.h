@@ -0,0 +1,127 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TranslationOptionCache_h
+#define moses_TranslationOptionCache_h
+
+#include <iostream>
+#include <list>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "Phrase.h"
+#include "TranslationOption.h"
+
+namespace Moses
+{
+
+struct TranslationOptionCacheStats {
+  size_t hits;
+  size_t misses;
+  size_t invalidations;
+  size_t entries;
+};
+
+std::ostream& operator<<(std::ostream& out, const TranslationOptionCacheStats& stats);
+
+/** Process-wide cache of the translation options built for a source phrase
+ * by one decoding graph, reused by TranslationOptionCollection across
+ * sentences.
+ *
+ * Entries hold the options as they come out of the decoding steps, with
+ * the isolated scores and future score of their target phrases but before
+ * anything that depends on the rest of the sentence (input scores, XML
+ * markup, source context, pruning).  Their ranges start at 0 and are moved
+ * to the span being translated on retrieval.  Text input looks spans up
+ * here before its phrase table lookups (see
+ * TranslationOptionCollection::FetchCachedOptions()), so a hit also saves
+ * the lookup and the scoring of the target phrases.
+ *
+ * Cached options are only correct while the weights and phrase tables stay
+ * as they were.  StaticData calls Invalidate() when weights are set.  Tables
+ * whose content can change after loading, per sentence or through the
+ * server, report PhraseDictionary::IsContextDependent(), and StaticData
+ * disables the cache when a decoding graph uses one.
+ */
+class TranslationOptionCache
+{
+public:
+  typedef boost::ptr_vector<TranslationOption> Options;
+  typedef boost::shared_ptr<const Options> OptionsPtr;
+
+  static TranslationOptionCache& Instance() {
+    return s_instance;
+  }
+
+  //! maximum number of source phrases held; 0 disables the cache
+  void SetMaxSize(size_t maxSize);
+
+  bool IsEnabled() const {
+    return m_maxSize != 0;
+  }
+
+  /** returns the options for source in decoding graph graphInd, or null on
+   * a miss.  generation must be passed back to Add() for the same key */
+  OptionsPtr Find(size_t graphInd, const Phrase &source, size_t &generation);
+
+  //! ignored if the cache was invalidated since the matching Find()
+  void Add(size_t graphInd, const Phrase &source, const OptionsPtr &options, size_t generation);
+
+  //! drop all entries, after feature weights changed
+  void Invalidate();
+
+  TranslationOptionCacheStats GetStats() const;
+
+protected:
+  static TranslationOptionCache s_instance;
+
+  struct Key {
+    size_t graphInd;
+    Phrase source;
+    bool operator==(const Key &other) const {
+      return graphInd == other.graphInd && source == other.source;
+    }
+  };
+  struct KeyHasher {
+    size_t operator()(const Key &key) const;
+  };
+  typedef std::list<std::pair<Key, OptionsPtr> > LRUList;
+  typedef boost::unordered_map<Key, LRUList::iterator, KeyHasher> Index;
+
+  LRUList m_lru; // most recently used at the front
+  Index m_index;
+  size_t m_maxSize;
+  size_t m_generation;
+  size_t m_hits, m_misses, m_invalidations;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_lock;
+#endif
+
+  TranslationOptionCache();
+};
+
+}
+
+#endif
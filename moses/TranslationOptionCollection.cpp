@@ -39,6 +39,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/LexicalReordering/LexicalReordering.h"
 #include "moses/FF/InputFeature.h"
 #include "TranslationTask.h"
+#include "TranslationOptionCache.h"
+#include "ThreadPool.h"
 #include "util/exception.hh"
 
 #include <boost/foreach.hpp>
@@ -47,6 +49,42 @@ using namespace std;
 namespace Moses
 {
 
+/** Runs CreateTranslationOptionsForStart() on a pool thread. Exceptions are
+ * kept and rethrown by the thread that waits for the batch */
+class TranslationOptionCollection::CreateForStartTask : public Task
+{
+public:
+  CreateForStartTask(TranslationOptionCollection &coll,
+                     const DecodeGraph &decodeGraph,
+                     size_t graphInd, size_t startPos)
+    : m_coll(coll), m_decodeGraph(decodeGraph)
+    , m_graphInd(graphInd), m_startPos(startPos), m_failed(false) {
+  }
+
+  void Run() {
+    try {
+      m_coll.CreateTranslationOptionsForStart(m_decodeGraph, m_graphInd, m_startPos);
+    } catch (const std::exception &e) {
+      m_failed = true;
+      m_error = e.what();
+    }
+  }
+
+  bool Failed() const {
+    return m_failed;
+  }
+  const std::string &GetError() const {
+    return m_error;
+  }
+
+private:
+  TranslationOptionCollection &m_coll;
+  const DecodeGraph &m_decodeGraph;
+  size_t m_graphInd, m_startPos;
+  bool m_failed;
+  std::string m_error;
+};
+
 /** constructor; since translation options are indexed by coverage span, the
  * corresponding data structure is initialized here This fn should be
  * called by inherited classe */
@@ -61,6 +99,10 @@ TranslationOptionCollection(ttasksptr const& ttask,
   , m_max_phrase_length(ttask->options()->search.max_phrase_length)
   , max_partial_trans_opt(ttask->options()->search.max_partial_trans_opt)
 {
+  // alternate weight settings change the scores from sentence to sentence
+  m_usePersistentCache = TranslationOptionCache::Instance().IsEnabled()
+                         && !StaticData::Instance().GetHasAlternateWeightSettings();
+
   // create 2-d vector
   size_t size = src.GetSize();
   for (size_t sPos = 0 ; sPos < size ; ++sPos) {
@@ -345,28 +387,43 @@ CreateTranslationOptions()
   // length of the sentence
   const size_t size = m_source.GetSize();
 
+  // spans with different start positions fill different lists, so they can
+  // be built concurrently; each list still gets its options in serial order
+#ifdef WITH_THREADS
+  ThreadPool *pool = NULL;
+  if (StaticData::Instance().ParallelTranslationOptions()
+      && CanCreateTranslationOptionsInParallel() && size > 1) {
+    pool = ThreadPool::Current();
+    if (pool && pool->GetNumThreads() < 2) pool = NULL;
+  }
+#endif
+
   // loop over all decoding graphs, each generates translation options
   for (size_t gidx = 0 ; gidx < decodeGraphList.size() ; gidx++) {
     if (decodeGraphList.size() > 1)
       VERBOSE(3,"Creating translation options from decoding graph " << gidx << endl);
 
     const DecodeGraph& dg = *decodeGraphList[gidx];
-    size_t backoff = dg.GetBackoff();
+#ifdef WITH_THREADS
+    if (pool) {
+      // graphs stay in order: backoff looks at what earlier graphs produced
+      std::vector<boost::shared_ptr<CreateForStartTask> > tasks;
+      std::vector<boost::shared_ptr<Task> > batch;
+      for (size_t sPos = 0 ; sPos < size; sPos++) {
+        tasks.push_back(boost::shared_ptr<CreateForStartTask>(
+                          new CreateForStartTask(*this, dg, gidx, sPos)));
+        batch.push_back(tasks.back());
+      }
+      pool->SubmitAndWait(batch);
+      BOOST_FOREACH(boost::shared_ptr<CreateForStartTask> const& task, tasks) {
+        UTIL_THROW_IF2(task->Failed(), task->GetError());
+      }
+      continue;
+    }
+#endif
     // iterate over spans
     for (size_t sPos = 0 ; sPos < size; sPos++) {
-      size_t maxSize = size - sPos; // don't go over end of sentence
-      // size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-      maxSize = std::min(maxSize, m_max_phrase_length);
-
-      for (size_t ePos = sPos ; ePos < sPos + maxSize ; ePos++) {
-        if (gidx && backoff &&
-            (ePos-sPos+1 <= backoff || // size exceeds backoff limit (HUH? UG) or ...
-             m_collection[sPos][ePos-sPos].size() > 0)) {
-          VERBOSE(3,"No backoff to graph " << gidx << " for span [" << sPos << ";" << ePos << "]" << endl);
-          continue;
-        }
-        CreateTranslationOptionsForRange(dg, sPos, ePos, true, gidx);
-      }
+      CreateTranslationOptionsForStart(dg, gidx, sPos);
     }
   }
   ProcessUnknownWord();
@@ -378,6 +435,25 @@ CreateTranslationOptions()
   CacheLexReordering(); // Cached lex reodering costs
 }
 
+void
+TranslationOptionCollection::
+CreateTranslationOptionsForStart(const DecodeGraph &dg, size_t gidx, size_t sPos)
+{
+  size_t backoff = dg.GetBackoff();
+  size_t maxSize = m_source.GetSize() - sPos; // don't go over end of sentence
+  // size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
+  maxSize = std::min(maxSize, m_max_phrase_length);
+
+  for (size_t ePos = sPos ; ePos < sPos + maxSize ; ePos++) {
+    if (gidx && backoff &&
+        (ePos-sPos+1 <= backoff || // size exceeds backoff limit (HUH? UG) or ...
+         m_collection[sPos][ePos-sPos].size() > 0)) {
+      VERBOSE(3,"No backoff to graph " << gidx << " for span [" << sPos << ";" << ePos << "]" << endl);
+      continue;
+    }
+    CreateTranslationOptionsForRange(dg, sPos, ePos, true, gidx);
+  }
+}
 
 bool
 TranslationOptionCollection::
@@ -388,6 +464,34 @@ CreateTranslationOptionsForRange
   typedef DecodeStepTranslation Tstep;
   typedef DecodeStepGeneration Gstep;
   XmlInputType xml_policy = m_ttask.lock()->options()->input.xml_policy;
+
+  // options that depend only on the source phrase can come from, or go to,
+  // the persistent cache
+  TranslationOptionCache &cache = TranslationOptionCache::Instance();
+  boost::shared_ptr<TranslationOptionCache::Options> cachedOptions;
+  size_t cacheGeneration = 0;
+  if (m_usePersistentCache && adhereTableLimit
+      && CanUsePersistentCache(sPos, ePos, inputPath)) {
+    TranslationOptionCache::OptionsPtr cached;
+    if (sPos < m_fetchedOptions.size()
+        && ePos - sPos < m_fetchedOptions[sPos].size()
+        && gidx < m_fetchedOptions[sPos][ePos - sPos].size()) {
+      cached = m_fetchedOptions[sPos][ePos - sPos][gidx];
+    } else {
+      cached = cache.Find(gidx, inputPath.GetPhrase(), cacheGeneration);
+    }
+    if (cached) {
+      Range range(sPos, ePos);
+      BOOST_FOREACH(TranslationOption const& proto, *cached) {
+        TranslationOption *transOpt = new TranslationOption(range, proto);
+        transOpt->SetInputPath(inputPath);
+        Add(transOpt);
+      }
+      return true;
+    }
+    cachedOptions.reset(new TranslationOptionCache::Options);
+  }
+
   if ((xml_policy != XmlExclusive)
       || !HasXmlOptionsOverlappingRange(sPos,ePos)) {
 
@@ -450,6 +554,9 @@ CreateTranslationOptionsForRange
       if (xml_policy != XmlConstraint ||
           !ViolatesXmlOptionsConstraint(sPos,ePos,transOpt)) {
         Add(transOpt);
+        if (cachedOptions) {
+          cachedOptions->push_back(new TranslationOption(Range(0, ePos - sPos), *transOpt));
+        }
       }
     }
     lastPartialTranslOptColl.DetachAll();
@@ -458,6 +565,10 @@ CreateTranslationOptionsForRange
     // TRACE_ERR( "Early translation options pruned: " << totalEarlyPruned << endl);
   } // if ((xml_policy != XmlExclusive) || !HasXmlOptionsOverlappingRange(sPos,ePos))
 
+  if (cachedOptions) {
+    cache.Add(gidx, inputPath.GetPhrase(), cachedOptions, cacheGeneration);
+  }
+
   if (gidx == 0 && xml_policy != XmlPassThrough
       && HasXmlOptionsOverlappingRange(sPos,ePos)) {
     CreateXmlOptionsForRange(sPos, ePos);
@@ -646,9 +757,93 @@ GetTranslationOptionList(size_t sPos, size_t ePos) const
   return idx < tol.size() ? &tol[idx] : NULL;
 }
 
+bool
+TranslationOptionCollection::
+CanUsePersistentCache(size_t sPos, size_t ePos, const InputPath &inputPath) const
+{
+  return inputPath.GetInputScore() == NULL
+         && !HasXmlOptionsOverlappingRange(sPos, ePos);
+}
+
+void
+TranslationOptionCollection::
+FetchCachedOptions(InputPathList &lookups)
+{
+  lookups.clear();
+  m_fetchedOptions.clear();
+  if (!m_usePersistentCache) {
+    lookups = m_inputPathQueue;
+    return;
+  }
+
+  const vector <DecodeGraph*> &decodeGraphList
+  = StaticData::Instance().GetDecodeGraphs();
+  TranslationOptionCache &cache = TranslationOptionCache::Instance();
+
+  // the input path of each span
+  vector< vector<InputPath*> > paths(m_collection.size());
+  for (size_t sPos = 0; sPos < m_collection.size(); ++sPos) {
+    paths[sPos].resize(m_collection[sPos].size(), NULL);
+  }
+  BOOST_FOREACH(InputPath *path, m_inputPathQueue) {
+    const Range &range = path->GetWordsRange();
+    size_t sPos = range.GetStartPos();
+    size_t length = range.GetNumWordsCovered();
+    if (length && sPos < paths.size() && length <= paths[sPos].size()) {
+      paths[sPos][length - 1] = path;
+    }
+  }
+
+  // Phrase tables may find a span's entry through the node of its prefix,
+  // so only the longest spans of each start position can do without a
+  // lookup, down to the first one that is not cached.  Single words are
+  // always looked up: unknown word handling retries them without the table
+  // limit.
+  vector< vector<bool> > fetched(paths.size());
+  m_fetchedOptions.resize(paths.size());
+  for (size_t sPos = 0; sPos < paths.size(); ++sPos) {
+    fetched[sPos].resize(paths[sPos].size(), false);
+    m_fetchedOptions[sPos].resize(paths[sPos].size());
+    for (size_t length = paths[sPos].size(); length > 1; --length) {
+      InputPath *path = paths[sPos][length - 1];
+      if (!path || !CanUsePersistentCache(sPos, sPos + length - 1, *path)) break;
+
+      vector<TranslationOptionCache::OptionsPtr> options;
+      for (size_t gidx = 0; gidx < decodeGraphList.size(); ++gidx) {
+        size_t generation;
+        TranslationOptionCache::OptionsPtr cached
+        = cache.Find(gidx, path->GetPhrase(), generation);
+        if (!cached) break;
+        options.push_back(cached);
+      }
+      if (options.size() < decodeGraphList.size()) break;
+      m_fetchedOptions[sPos][length - 1].swap(options);
+      fetched[sPos][length - 1] = true;
+    }
+  }
+
+  BOOST_FOREACH(InputPath *path, m_inputPathQueue) {
+    const Range &range = path->GetWordsRange();
+    size_t sPos = range.GetStartPos();
+    size_t length = range.GetNumWordsCovered();
+    if (length && sPos < fetched.size() && length <= fetched[sPos].size()
+        && fetched[sPos][length - 1]) {
+      continue;
+    }
+    lookups.push_back(path);
+  }
+}
+
 void
 TranslationOptionCollection::
 GetTargetPhraseCollectionBatch()
+{
+  GetTargetPhraseCollectionBatch(m_inputPathQueue);
+}
+
+void
+TranslationOptionCollection::
+GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue)
 {
   typedef DecodeStepTranslation Tstep;
   const vector <DecodeGraph*> &dgl = StaticData::Instance().GetDecodeGraphs();
@@ -658,7 +853,7 @@ GetTargetPhraseCollectionBatch()
       const Tstep* tstep = dynamic_cast<const Tstep *>(*i);
       if (tstep) {
         const PhraseDictionary &pdict = *tstep->GetPhraseDictionaryFeature();
-        pdict.GetTargetPhraseCollectionBatch(m_ttask.lock(), m_inputPathQueue);
+        pdict.GetTargetPhraseCollectionBatch(m_ttask.lock(), inputPathQueue);
       }
     }
   }
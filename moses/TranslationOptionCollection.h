@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "TranslationOption.h"
 #include "TranslationOptionList.h"
+#include "TranslationOptionCache.h"
 #include "SquareMatrix.h"
 #include "Bitmap.h"
 #include "PartialTranslOptColl.h"
@@ -75,6 +76,10 @@ protected:
   size_t max_partial_trans_opt;
   std::vector<const Phrase*> m_unksrcs;
   InputPathList m_inputPathQueue;
+  bool m_usePersistentCache; /*< reuse options from earlier sentences, see TranslationOptionCache */
+  /** options taken from the persistent cache before the phrase table lookups,
+   * by start position, span length - 1 and decoding graph; see FetchCachedOptions() */
+  std::vector< std::vector< std::vector<TranslationOptionCache::OptionsPtr> > > m_fetchedOptions;
 
   TranslationOptionCollection(ttasksptr const& ttask, InputType const& src);
 
@@ -114,6 +119,15 @@ protected:
   void CacheLexReordering();
 
   void GetTargetPhraseCollectionBatch();
+  void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue);
+
+  //! whether the options of a span only depend on its source phrase
+  bool CanUsePersistentCache(size_t startPos, size_t endPos, const InputPath &inputPath) const;
+
+  /** take the options of spans cached for every decoding graph from the
+   * persistent cache, and return the input paths that still need phrase
+   * table lookups in lookups */
+  void FetchCachedOptions(InputPathList &lookups);
 
   bool CreateTranslationOptionsForRange(
     const DecodeGraph &decodeGraph
@@ -123,6 +137,19 @@ protected:
     , size_t graphInd
     , InputPath &inputPath);
 
+  //! create the options of all spans that start at startPos
+  void CreateTranslationOptionsForStart(const DecodeGraph &decodeGraph
+                                        , size_t graphInd
+                                        , size_t startPos);
+
+  /** whether spans with different start positions may be filled
+   * concurrently. Only safe if phrase table lookups happened beforehand */
+  virtual bool CanCreateTranslationOptionsInParallel() const {
+    return false;
+  }
+
+  class CreateForStartTask;
+
   void SetInputScore(const InputPath &inputPath, PartialTranslOptColl &oldPtoc);
 
 public:
@@ -167,7 +167,10 @@ InputPath &TranslationOptionCollectionText::GetInputPath(size_t startPos, size_t
 
 void TranslationOptionCollectionText::CreateTranslationOptions()
 {
-  GetTargetPhraseCollectionBatch();
+  // spans answered by the persistent cache need no phrase table lookup
+  InputPathList lookups;
+  FetchCachedOptions(lookups);
+  GetTargetPhraseCollectionBatch(lookups);
   TranslationOptionCollection::CreateTranslationOptions();
 }
 
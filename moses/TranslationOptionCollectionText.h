@@ -57,6 +57,11 @@ public:
 
   void CreateTranslationOptions();
 
+  //! lookups are batched up front in CreateTranslationOptions()
+  bool CanCreateTranslationOptionsInParallel() const {
+    return true;
+  }
+
   bool CreateTranslationOptionsForRange(const DecodeGraph &decodeStepList
                                         , size_t startPosition
                                         , size_t endPosition
@@ -75,7 +75,7 @@ TranslationTask
 TranslationTask
 ::TranslationTask(boost::shared_ptr<InputType> const& source,
                   boost::shared_ptr<IOWrapper> const& ioWrapper)
-  : m_source(source) , m_ioWrapper(ioWrapper)
+  : m_source(source) , m_ioWrapper(ioWrapper), m_times()
 {
   m_options = source->options();
 }
@@ -164,6 +164,7 @@ void TranslationTask::Run()
                  << " input and iowrapper.");
 
   const size_t translationId = m_source->GetTranslationId();
+  m_times = TranslationTaskTimes();
 
 
   // report wall time spent on translation
@@ -186,18 +187,28 @@ void TranslationTask::Run()
   initTime.start();
 
   boost::shared_ptr<BaseManager> manager = SetupManager(m_options->search.algo);
+  m_times.setup = initTime.get_elapsed_time();
 
   VERBOSE(1, "Line " << translationId << ": Initialize search took "
           << initTime << " seconds total" << endl);
 
+  Timer decodeTime;
+  decodeTime.start();
   manager->Decode();
+  m_times.collectOpts = manager->GetTimeCollectOpts();
+  m_times.search = manager->GetTimeSearch();
+  if (m_times.collectOpts == 0 && m_times.search == 0)
+    m_times.search = decodeTime.get_elapsed_time();
 
   // new: stop here if m_ioWrapper is NULL. This means that the
   // owner of the TranslationTask will take care of the output
   // oh, and by the way, all the output should be handled by the
   // output wrapper along the lines of *m_iwWrapper << *manager;
   // Just sayin' ...
-  if (m_ioWrapper == NULL) return;
+  if (m_ioWrapper == NULL) {
+    m_times.total = translationTime.get_elapsed_time();
+    return;
+  }
 
   // we are done with search, let's look what we got
   OutputCollector* ocoll;
@@ -226,7 +237,8 @@ void TranslationTask::Run()
 
   additionalReportingTime.stop();
 
-  additionalReportingTime.start();
+  Timer nbestTime;
+  nbestTime.start();
 
   // output n-best list
   manager->OutputNBest(io->GetNBestOutputCollector());
@@ -234,6 +246,9 @@ void TranslationTask::Run()
   //lattice samples
   manager->OutputLatticeSamples(io->GetLatticeSamplesCollector());
 
+  m_times.nbest = nbestTime.get_elapsed_time();
+  additionalReportingTime.start();
+
   // detailed translation reporting
   ocoll = io->GetDetailedTranslationCollector();
   manager->OutputDetailedTranslationReport(ocoll);
@@ -248,6 +263,9 @@ void TranslationTask::Run()
 
   // report additional statistics
   manager->CalcDecoderStatistics();
+  additionalReportingTime.stop();
+  m_times.output = additionalReportingTime.get_elapsed_time();
+  m_times.total = translationTime.get_elapsed_time();
   VERBOSE(1, "Line " << translationId << ": Additional reporting took "
           << additionalReportingTime << " seconds total" << endl);
   VERBOSE(1, "Line " << translationId << ": Translation took "
@@ -28,6 +28,16 @@ namespace Moses
 class InputType;
 class OutputCollector;
 
+/** wall time, in seconds, of the stages of TranslationTask::Run() */
+struct TranslationTaskTimes {
+  double setup;        //!< creating the manager
+  double collectOpts;  //!< translation options, if the manager reports them
+  double search;       //!< search, or all of decoding if it does not
+  double output;       //!< best translation and reports other than n-best
+  double nbest;        //!< n-best list and lattice samples
+  double total;
+};
+
 
 /** Translates a sentence.
   * - calls the search (Manager)
@@ -48,7 +58,7 @@ protected:
   boost::weak_ptr<TranslationTask> m_self; // weak ptr to myself
   boost::shared_ptr<ContextScope> m_scope; // sores local info
   // pointer to ContextScope, which stores context-specific information
-  TranslationTask() { } ;
+  TranslationTask() : m_times() { } ;
   TranslationTask(boost::shared_ptr<Moses::InputType> const& source,
                   boost::shared_ptr<Moses::IOWrapper> const& ioWrapper);
   // Yes, the constructor is protected.
@@ -136,9 +146,15 @@ public:
 
   AllOptions::ptr const& options() const;
 
+  //! stage timings of the last Run()
+  TranslationTaskTimes const& GetTimes() const {
+    return m_times;
+  }
+
 protected:
   boost::shared_ptr<Moses::InputType> m_source;
   boost::shared_ptr<Moses::IOWrapper> m_ioWrapper;
+  TranslationTaskTimes m_times;
 
   void interpret_dlt();
 };
@@ -412,6 +412,18 @@ inline float CalcTranslationScore(const std::vector<float> &probVector,
   return rv;
 }
 
+/** weighted sum of floored log probs. The table creation tools can store
+ * target phrases best first by this score, see
+ * PhraseDictionary::StoredOrderMatchesWeights()
+ */
+inline float CalcSortScore(const float *probs, const std::vector<float> &weights)
+{
+  float rv = 0.0;
+  for (size_t i = 0; i < weights.size(); ++i)
+    rv += FloorScore(TransformScore(probs[i])) * weights[i];
+  return rv;
+}
+
 /** declaration of ToString() function to go in header for each class.
  *	This function, as well as the operator<< fn for each class, is
  *	for debugging purposes only. The output format is likely to change from
@@ -147,6 +147,39 @@ BOOST_AUTO_TEST_CASE(positions)
 
 }
 
+BOOST_AUTO_TEST_CASE(multiword)
+{
+  // spans several 64-bit words, and a sentence too long for inline storage
+  size_t sizes[] = {64, 130, 300};
+  for (size_t s = 0; s < 3; ++s) {
+    size_t size = sizes[s];
+    Bitmap wbm(size);
+    Bitmap wbm2(wbm, Range(0, 62));
+    Bitmap wbm3(wbm2, Range(63, 63));
+    BOOST_CHECK_EQUAL(wbm3.GetNumWordsCovered(), 64);
+    BOOST_CHECK_EQUAL(wbm3.GetFirstGapPos(), size == 64 ? NOT_FOUND : 64);
+    BOOST_CHECK_EQUAL(wbm3.GetLastPos(), 63);
+
+    Bitmap wbm4(wbm, Range(size - 3, size - 1));
+    BOOST_CHECK_EQUAL(wbm4.GetFirstGapPos(), 0);
+    BOOST_CHECK_EQUAL(wbm4.GetNextGapPos(size - 3), NOT_FOUND);
+    BOOST_CHECK_EQUAL(wbm4.GetLastGapPos(), size - 4);
+    BOOST_CHECK_EQUAL(wbm4.GetEdgeToTheRightOf(0), size - 4);
+    BOOST_CHECK_EQUAL(wbm4.GetEdgeToTheLeftOf(size - 4), 0);
+    BOOST_CHECK_EQUAL(wbm4.GetEdgeToTheLeftOf(size - 1), size - 1);
+    BOOST_CHECK(wbm4.Overlap(Range(1, size - 3)));
+    BOOST_CHECK(!wbm4.Overlap(Range(1, size - 4)));
+
+    Bitmap wbm5(wbm4);
+    BOOST_CHECK(wbm5 == wbm4);
+    BOOST_CHECK_EQUAL(wbm5.hash(), wbm4.hash());
+    wbm5.SetValue(size / 2, true);
+    BOOST_CHECK(wbm5 != wbm4);
+    BOOST_CHECK_EQUAL(wbm5.GetNextGapPos(size / 2), size / 2 + 1);
+    BOOST_CHECK_EQUAL(wbm5.GetEdgeToTheRightOf(0), size / 2 - 1);
+    BOOST_CHECK_EQUAL(wbm5.GetEdgeToTheLeftOf(size - 4), size / 2 + 1);
+  }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -112,5 +112,6 @@ template PartialEdge EdgeGenerator::Pop(Context<lm::ngram::TrieModel> &context);
 template PartialEdge EdgeGenerator::Pop(Context<lm::ngram::QuantTrieModel> &context);
 template PartialEdge EdgeGenerator::Pop(Context<lm::ngram::ArrayTrieModel> &context);
 template PartialEdge EdgeGenerator::Pop(Context<lm::ngram::QuantArrayTrieModel> &context);
+template PartialEdge EdgeGenerator::Pop(Context<lm::ngram::QuantProbingModel> &context);
 
 } // namespace search
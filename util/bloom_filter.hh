@@ -0,0 +1,84 @@
+#ifndef UTIL_BLOOM_FILTER_H
+#define UTIL_BLOOM_FILTER_H
+
+#include <algorithm>
+#include <cstddef>
+
+#include <stdint.h>
+
+namespace util {
+
+/* Blocked Bloom filter over 64-bit keys that are already hashes.  All the
+ * bits for a key are in one 64-bit word, so a query touches one word.  Like
+ * ProbingHashTable, memory is managed by the caller so that the filter can be
+ * stored in a file; it must start zeroed.
+ */
+class BloomFilter {
+  public:
+    // Bytes needed for entries keys at bits per key.
+    static uint64_t Size(uint64_t entries, uint8_t bits) {
+      if (!bits) return 0;
+      return ((std::max<uint64_t>(entries, 1) * bits + 63) / 64) * sizeof(uint64_t);
+    }
+
+    // Must be assigned to later.
+    BloomFilter() : words_(NULL), count_(0), probes_(0) {}
+
+    BloomFilter(void *start, std::size_t allocated, uint8_t bits)
+      : words_(static_cast<uint64_t*>(start)),
+        count_(allocated / sizeof(uint64_t)),
+        // About bits * ln 2 probes, but each takes 6 bits of one hash.
+        probes_(std::min<unsigned int>(std::max<unsigned int>(bits * 69 / 100, 1), 8)) {}
+
+    // Whether a filter is present.
+    bool Active() const { return count_ != 0; }
+
+    void Insert(uint64_t key) {
+      words_[Word(key)] |= Mask(key);
+    }
+
+    // False if key was certainly not inserted.
+    bool MayContain(uint64_t key) const {
+      uint64_t mask = Mask(key);
+      return (words_[Word(key)] & mask) == mask;
+    }
+
+    void Prefetch(uint64_t key) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(words_ + Word(key));
+#endif
+    }
+
+  private:
+    // Keys often share low bits with the hash table index, so remix them.
+    static uint64_t Mix(uint64_t key) {
+      key ^= key >> 33;
+      key *= 0xff51afd7ed558ccdULL;
+      key ^= key >> 33;
+      return key;
+    }
+
+    // Scale the top 32 bits to [0, count_) without dividing.  Filters are
+    // limited to 2^32 words.
+    std::size_t Word(uint64_t key) const {
+      return static_cast<std::size_t>(((Mix(key) >> 32) * static_cast<uint64_t>(count_)) >> 32);
+    }
+
+    // Bits within the word come from the low half of the same hash.
+    uint64_t Mask(uint64_t key) const {
+      uint64_t bits = Mix(key) * 0x9e3779b97f4a7c15ULL;
+      uint64_t mask = 0;
+      for (unsigned int i = 0; i < probes_; ++i, bits <<= 6) {
+        mask |= static_cast<uint64_t>(1) << (bits >> 58);
+      }
+      return mask;
+    }
+
+    uint64_t *words_;
+    std::size_t count_;
+    unsigned int probes_;
+};
+
+} // namespace util
+
+#endif // UTIL_BLOOM_FILTER_H
@@ -224,6 +224,22 @@ const char *FilePiece::FindDelimiterOrEOF(const bool *delim)  {
   }
 }
 
+void FilePiece::Seek(uint64_t offset) {
+  UTIL_THROW_IF(!Seekable(), Exception, "Cannot seek in " << file_name_ << " because it is not mapped");
+  UTIL_THROW_IF(offset > total_size_, Exception, "Cannot seek to " << offset << " past the end of " << file_name_);
+  if (offset >= mapped_offset_ && offset <= mapped_offset_ + (position_end_ - data_.begin())) {
+    position_ = data_.begin() + (offset - mapped_offset_);
+    return;
+  }
+  // With nothing mapped, Shift maps from mapped_offset_.
+  data_.reset();
+  position_ = NULL;
+  position_end_ = NULL;
+  mapped_offset_ = offset;
+  at_end_ = false;
+  Shift();
+}
+
 void FilePiece::Shift() {
   if (at_end_) {
     progress_.Finished();
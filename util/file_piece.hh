@@ -125,6 +125,13 @@ class FilePiece {
 
     const std::string &FileName() const { return file_name_; }
 
+    // Whether the file is being mapped, as opposed to read from a stream or
+    // decompressed.  Only then can Seek be used.
+    bool Seekable() const { return !fallback_to_read_; }
+
+    // Continue reading from an absolute offset in the file.
+    void Seek(uint64_t offset);
+
   private:
     void InitializeNoRead(const char *name, std::size_t min_buffer);
     // Calls InitializeNoRead, so don't call both.
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <iostream>
 #include <cstdio>
+#include <vector>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -53,6 +54,31 @@ BOOST_AUTO_TEST_CASE(MMapReadLine) {
   BOOST_CHECK_THROW(test.get(), EndOfFileException);
 }
 
+/* Seek both within the mapped window and past it. */
+BOOST_AUTO_TEST_CASE(MMapSeek) {
+  std::fstream ref(FileLocation().c_str(), std::ios::in);
+  std::vector<std::string> lines;
+  std::vector<uint64_t> offsets;
+  std::string ref_line;
+  uint64_t offset = 0;
+  while (getline(ref, ref_line)) {
+    lines.push_back(ref_line);
+    offsets.push_back(offset);
+    offset += ref_line.size() + 1;
+  }
+  BOOST_REQUIRE(lines.size() > 2);
+  FilePiece test(FileLocation().c_str(), NULL, 1);
+  BOOST_CHECK(test.Seekable());
+  for (std::size_t i = lines.size() - 1; i > 0; i /= 2) {
+    test.Seek(offsets[i]);
+    BOOST_CHECK_EQUAL(offsets[i], test.Offset());
+    BOOST_CHECK_EQUAL(lines[i], test.ReadLine());
+  }
+  test.Seek(offsets[1]);
+  BOOST_CHECK_EQUAL(lines[1], test.ReadLine());
+  BOOST_CHECK_EQUAL(lines[2], test.ReadLine());
+}
+
 #if !defined(_WIN32) && !defined(_WIN64) && !defined(__APPLE__)
 /* Apple isn't happy with the popen, fileno, dup.  And I don't want to
  * reimplement popen.  This is an issue with the test.
@@ -9,7 +9,12 @@
 #include "util/parallel_read.hh"
 #include "util/scoped.hh"
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <cassert>
 #include <fcntl.h>
@@ -25,6 +30,11 @@
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
 namespace util {
 
 std::size_t SizePage() {
@@ -295,7 +305,7 @@ void HugeRealloc(std::size_t to, bool zero_new, scoped_memory &mem) {
   }
 }
 
-void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out) {
+void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out, std::size_t numa_node) {
   switch (method) {
     case LAZY:
       out.reset(MapOrThrow(size, false, kFileFlags, false, fd, offset), size, scoped_memory::MMAP_ALLOCATED);
@@ -318,9 +328,148 @@ void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scope
       HugeMalloc(size, false, out);
       ParallelRead(fd, out.get(), size, offset);
       break;
+    case INTERLEAVE_READ:
+    case NODE_READ:
+      HugeMalloc(size, false, out);
+      // Small allocations come from malloc and share pages with other data.
+      if (out.source() != scoped_memory::MALLOC_ALLOCATED) {
+        if (method == INTERLEAVE_READ) {
+          InterleaveNUMA(out.get(), size);
+        } else {
+          BindNUMA(out.get(), size, numa_node);
+        }
+      }
+      SeekOrThrow(fd, offset);
+      ReadOrThrow(fd, out.get(), size);
+      break;
+  }
+}
+
+LoadMethod ParseLoadMethod(const std::string &name) {
+  if (name == "lazy") return LAZY;
+  if (name == "populate_or_lazy") return POPULATE_OR_LAZY;
+  if (name == "populate_or_read" || name == "populate") return POPULATE_OR_READ;
+  if (name == "read") return READ;
+  if (name == "parallel_read" || name == "parallel") return PARALLEL_READ;
+  if (name == "interleave") return INTERLEAVE_READ;
+  UTIL_THROW_IF(name == "replicate", Exception, "Load method replicate keeps a copy per NUMA node and is only supported by KenLM language models; use interleave here");
+  UTIL_THROW(Exception, "Unknown load method " << name);
+}
+
+#ifdef __linux__
+namespace {
+
+// Parse a sysfs list such as "0-3,8,10-11".  Empty if the file is missing.
+std::vector<std::size_t> ReadSysList(const std::string &file) {
+  std::vector<std::size_t> ret;
+  std::ifstream in(file.c_str());
+  std::string line;
+  if (!std::getline(in, line)) return ret;
+  const char *i = line.c_str();
+  while (*i) {
+    char *end;
+    std::size_t from = std::strtoul(i, &end, 10);
+    if (end == i) break;
+    std::size_t to = from;
+    if (*end == '-') {
+      i = end + 1;
+      to = std::strtoul(i, &end, 10);
+    }
+    for (std::size_t n = from; n <= to; ++n) ret.push_back(n);
+    i = (*end == ',') ? end + 1 : end;
   }
+  return ret;
+}
+
+class NUMATopology {
+  public:
+    NUMATopology() : nodes_(ReadSysList("/sys/devices/system/node/online")) {
+      for (std::size_t n = 0; n < nodes_.size(); ++n) {
+        std::vector<std::size_t> cpus(ReadSysList("/sys/devices/system/node/node" + Number(nodes_[n]) + "/cpulist"));
+        for (std::vector<std::size_t>::const_iterator c = cpus.begin(); c != cpus.end(); ++c) {
+          if (*c >= cpu_to_node_.size()) cpu_to_node_.resize(*c + 1, 0);
+          cpu_to_node_[*c] = n;
+        }
+      }
+    }
+
+    std::size_t Count() const { return std::max<std::size_t>(1, nodes_.size()); }
+
+    std::size_t NodeOfCPU(int cpu) const {
+      return (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_to_node_.size()) ? cpu_to_node_[cpu] : 0;
+    }
+
+    // Memory policy to apply to [start, start + size) over the nodes with
+    // these indices.
+    bool Apply(void *start, std::size_t size, int mode, std::size_t node_begin, std::size_t node_end) const {
+#ifdef SYS_mbind
+      if (nodes_.size() <= 1) return false;
+      const std::size_t kBits = 8 * sizeof(unsigned long);
+      std::vector<unsigned long> mask(nodes_.back() / kBits + 1, 0);
+      for (std::size_t n = node_begin; n < node_end; ++n) {
+        mask[nodes_[n] / kBits] |= 1UL << (nodes_[n] % kBits);
+      }
+      // mbind wants page-aligned ranges.
+      uintptr_t base = reinterpret_cast<uintptr_t>(start);
+      uintptr_t aligned = base & ~static_cast<uintptr_t>(SizePage() - 1);
+      // The kernel reads maxnode - 1 bits of the mask, so pass one more.
+      return !syscall(SYS_mbind, aligned, size + (base - aligned), mode, &mask[0], mask.size() * kBits + 1, 0);
+#else
+      return false;
+#endif
+    }
+
+  private:
+    static std::string Number(std::size_t value) {
+      char buf[24];
+      snprintf(buf, sizeof(buf), "%lu", static_cast<unsigned long>(value));
+      return buf;
+    }
+
+    std::vector<std::size_t> nodes_;
+    std::vector<std::size_t> cpu_to_node_;
+};
+
+const NUMATopology &Topology() {
+  static const NUMATopology topology;
+  return topology;
+}
+
+// From linux/mempolicy.h, which is not always installed.
+const int kMPolBind = 2;
+const int kMPolInterleave = 3;
+
+} // namespace
+
+std::size_t NUMANodeCount() {
+  return Topology().Count();
 }
 
+std::size_t CurrentNUMANode() {
+  return Topology().NodeOfCPU(sched_getcpu());
+}
+
+bool InterleaveNUMA(void *start, std::size_t size) {
+  return Topology().Apply(start, size, kMPolInterleave, 0, Topology().Count());
+}
+
+bool BindNUMA(void *start, std::size_t size, std::size_t node) {
+  if (node >= Topology().Count()) return false;
+  return Topology().Apply(start, size, kMPolBind, node, node + 1);
+}
+
+#else // __linux__
+
+std::size_t NUMANodeCount() { return 1; }
+
+std::size_t CurrentNUMANode() { return 0; }
+
+bool InterleaveNUMA(void * /*start*/, std::size_t /*size*/) { return false; }
+
+bool BindNUMA(void * /*start*/, std::size_t /*size*/, std::size_t /*node*/) { return false; }
+
+#endif // __linux__
+
 void *MapZeroedWrite(int fd, std::size_t size) {
   ResizeOrThrow(fd, 0);
   ResizeOrThrow(fd, size);
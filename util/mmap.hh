@@ -4,6 +4,7 @@
 
 #include <cstddef>
 #include <limits>
+#include <string>
 
 #include <stdint.h>
 #include <sys/types.h>
@@ -139,9 +140,40 @@ typedef enum {
   READ,
   // malloc and read in parallel (recommended for Lustre)
   PARALLEL_READ,
+  // malloc and read with the pages spread round-robin over all NUMA nodes, so
+  // that threads on every node see the same average latency.
+  INTERLEAVE_READ,
+  // malloc and read with the pages on the NUMA node passed to MapRead, e.g.
+  // to keep a copy of a model on each node.
+  NODE_READ,
 } LoadMethod;
 
-void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out);
+/* The methods that malloc and read take huge pages (see HugeMalloc) where
+ * available.  Methods that mmap the file use the page cache and normal pages.
+ * numa_node is only used by NODE_READ.
+ */
+void MapRead(LoadMethod method, int fd, uint64_t offset, std::size_t size, scoped_memory &out, std::size_t numa_node = 0);
+
+// Parse the lowercase name of a load method: lazy, populate_or_lazy,
+// populate_or_read (or populate), read, parallel_read (or parallel), or
+// interleave, as spelt by query -l.
+// replicate needs a copy per node, so callers that support it (the Moses KenLM
+// feature) handle it themselves; here it throws.
+LoadMethod ParseLoadMethod(const std::string &name);
+
+/* NUMA placement.  Nodes are numbered from 0 to NUMANodeCount() - 1 in the
+ * order the kernel lists them.  Without NUMA support there is one node and
+ * placement does nothing.  Placement applies to pages that have not been
+ * touched yet and is only a hint: it returns false if the kernel refused.
+ */
+std::size_t NUMANodeCount();
+
+// Node of the CPU the calling thread is running on.
+std::size_t CurrentNUMANode();
+
+bool InterleaveNUMA(void *start, std::size_t size);
+
+bool BindNUMA(void *start, std::size_t size, std::size_t node);
 
 // Open file name with mmap of size bytes, all of which are initially zero.
 void *MapZeroedWrite(int fd, std::size_t size);
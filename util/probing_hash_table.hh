@@ -143,6 +143,13 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       return mod_.Ideal(begin_, hash_(key));
     }
 
+    // Hint that key will be looked up soon by pulling its ideal bucket into cache.
+    void Prefetch(const Key key) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(&*Ideal(key));
+#endif
+    }
+
     template <class T> MutableIterator Insert(const T &t) {
 #ifdef DEBUG
       assert(initialized_);
@@ -3,6 +3,7 @@
 #include "util/exception.hh"
 
 #include <fstream>
+#include <limits>
 #include <ostream>
 #include <sstream>
 #include <set>
@@ -157,6 +158,29 @@ uint64_t RSSMax() {
 #endif
 }
 
+uint64_t RSSPeak() {
+#if defined(__linux__)
+  // VmHWM is the high water mark that ResetRSSPeak clears.
+  std::ifstream status("/proc/self/status", std::ios::in);
+  std::string header;
+  uint64_t kb;
+  while (status >> header) {
+    if (header == "VmHWM:" && (status >> kb)) return kb * 1024;
+    status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+#endif
+  return RSSMax();
+}
+
+void ResetRSSPeak() {
+#if defined(__linux__)
+  // Writing 5 resets the high water mark (Linux 4.0 and later).  Failure just
+  // means the peak covers more time.
+  std::ofstream clear("/proc/self/clear_refs", std::ios::out);
+  clear << "5" << std::flush;
+#endif
+}
+
 void PrintUsage(std::ostream &out) {
 #if !defined(_WIN32) && !defined(_WIN64)
   // Linux doesn't set memory usage in getrusage :-(
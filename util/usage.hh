@@ -15,6 +15,11 @@ double CPUTime();
 // Resident usage in bytes.
 uint64_t RSSMax();
 
+// Peak resident usage in bytes since the last ResetRSSPeak.  Where the peak
+// can't be reset (anything but Linux), this is the same as RSSMax.
+uint64_t RSSPeak();
+void ResetRSSPeak();
+
 void PrintUsage(std::ostream &to);
 
 // Determine how much physical memory there is.  Return 0 on failure.